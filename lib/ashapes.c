@@ -7,12 +7,23 @@
 int ashaper_count = 0;
 AShape_t* ashapers = NULL;
 
+// the window is pulled in from each note edge by this fraction of scaling
+// so inputs that land in it are guaranteed to quantize to the current note
+// (ie. the floor & index math can't round across the edge). edge cases take the full path
+#define WINDOW_GUARD (1.0/65536.0)
+
+static void window_clear( AShape_t* self )
+{
+    self->win_lo = 1.0; // empty window forces a lookup
+    self->win_hi = 0.0;
+}
+
 void AShaper_init( int channels )
 {
-    ashaper_count = channels;
     ashapers = malloc( sizeof( AShape_t ) * channels );
     if( !ashapers ){ printf("ashapers malloc failed\n"); return; }
-    for( int j=0; j<ASHAPER_CHANNELS; j++ ){
+    ashaper_count = channels;
+    for( int j=0; j<ashaper_count; j++ ){
         ashapers[j].index  = j;
         for( int d=0; d<MAX_DIV_LIST_LEN; d++ ){
             ashapers[j].divlist[d] = d; // ascending vals to 24
@@ -22,15 +33,25 @@ void AShaper_init( int channels )
         ashapers[j].scaling = 1.0;
         ashapers[j].active  = false;
         ashapers[j].state   = 0.0;
+        ashapers[j].dirty   = true;
+        ashapers[j].hysteresis = 0.0;
+        window_clear( &ashapers[j] );
+        ashapers[j].note   = 0;
+        ashapers[j].octave = 0;
+        ashapers[j].note_action = NULL;
+        ashapers[j].sent_note   = 0;
+        ashapers[j].sent_octave = 0;
+        ashapers[j].holdoff     = 0;
     }
 }
 
 void AShaper_unset_scale( int index )
 {
-    if( index < 0 || index >= ASHAPER_CHANNELS ){ return; }
+    if( index < 0 || index >= ashaper_count ){ return; }
     AShape_t* self = &ashapers[index]; // safe pointer
 
     self->active = false;
+    self->dirty  = true;
 }
 
 void AShaper_set_scale( int    index
@@ -40,10 +61,11 @@ void AShaper_set_scale( int    index
                       , float  scaling
                       )
 {
-    if( index < 0 || index >= ASHAPER_CHANNELS ){ return; }
+    if( index < 0 || index >= ashaper_count ){ return; }
     AShape_t* self = &ashapers[index]; // safe pointer
 
     self->active = true;
+    self->dirty  = true;
 
     self->dlLen = (dlLen > 24 ) ? 24 : dlLen;
     if( self->dlLen == 0 ){ // if empty list, assume chromatic
@@ -64,45 +86,117 @@ void AShaper_set_scale( int    index
 
     // pushes values up so capture window is centred on output window
     self->offset = 0.5 * self->scaling / self->modulo;
+
+    for( int i=0; i<(self->dlLen); i++ ){
+        self->note_map[i] = self->divlist[i] / self->modulo;
+    }
+    self->note_width = self->scaling / (float)self->dlLen;
+    window_clear( self );
+}
+
+void AShaper_set_hysteresis( int index, float volts )
+{
+    if( index < 0 || index >= ashaper_count ){ return; }
+    AShape_t* self = &ashapers[index]; // safe pointer
+
+    self->hysteresis = (volts < 0.0) ? 0.0 : volts;
+    window_clear( self );
+}
+
+void AShaper_set_note_action( int index, AShaper_note_action_t action )
+{
+    if( index < 0 || index >= ashaper_count ){ return; }
+    AShape_t* self = &ashapers[index]; // safe pointer
+
+    self->note_action = action;
+    self->sent_note   = self->note; // only report changes from here
+    self->sent_octave = self->octave;
 }
 
 float AShaper_get_state( int index )
 {
-    if( index < 0 || index >= ASHAPER_CHANNELS ){ return 0.0; }
+    if( index < 0 || index >= ashaper_count ){ return 0.0; }
     AShape_t* self = &ashapers[index]; // safe pointer
 
     return self->state;
 }
 
-// TODO optimization
+bool AShaper_is_dirty( int index )
+{
+    if( index < 0 || index >= ashaper_count ){ return false; }
+    AShape_t* self = &ashapers[index]; // safe pointer
+
+    // a note event waiting on the holdoff needs AShaper_v to keep running
+    bool pending = self->note_action && self->active
+                && ( self->note != self->sent_note || self->octave != self->sent_octave );
+    return self->dirty || pending;
+}
+
+// full quantization of one sample. also saves the window for the chosen note
+// only runs when the input leaves the window, so the divide is off the per-sample path.
+// samp * (1/scaling) would round differently for scalings like 1.2V, & near an octave
+// edge floorf() could then pick the neighbouring octave to the old per-sample code
+static float lookup( AShape_t* self, float samp )
+{
+    float n_samp = samp/self->scaling; // samp normalized to [0,1.0)
+
+    float divs = floorf(n_samp);
+    float phase = n_samp - divs; // [0,1.0)
+
+    int note = (int)(phase * self->dlLen); // map phase to num of note choices
+    if( note >= self->dlLen ){ note = self->dlLen - 1; } // phase rounded up to 1.0 for tiny negative inputs
+
+    float base = self->scaling * divs + self->note_width * (float)note;
+    float pad  = self->hysteresis - self->scaling * WINDOW_GUARD;
+    self->win_lo = base - pad;
+    self->win_hi = base + self->note_width + pad;
+
+    self->quantized = self->scaling * (divs + self->note_map[note]);
+    self->note   = note;
+    self->octave = (int)divs;
+    return self->quantized;
+}
+
+// called once per processed block, so only the block's final note is reported
+static void note_event( AShape_t* self )
+{
+    if( self->holdoff > 0 ){ self->holdoff--; return; }
+    if( self->note == self->sent_note && self->octave == self->sent_octave ){ return; }
+    self->sent_note   = self->note;
+    self->sent_octave = self->octave;
+    self->holdoff     = NOTE_HOLDOFF;
+    (*self->note_action)( self->index, self->note, self->octave, self->quantized );
+}
+
 float* AShaper_v( int     index
                 , float*  out
                 , int     size
                 )
 {
-    if( index < 0 || index >= ASHAPER_CHANNELS ){ return out; }
+    if( index < 0 || index >= ashaper_count ){ return out; }
     AShape_t* self = &ashapers[index]; // safe pointer
 
+    self->dirty = false;
     if( !self->active ){ // shaper inactive so just return
         self->state = out[size-1]; // save latest value
         return out;
     }
 
+    // inputs rarely leave a note within a block, so most samples are a compare
+    float lo = self->win_lo;
+    float hi = self->win_hi;
+    float q  = self->quantized;
     float* out2 = out;
     for( int i=0; i<size; i++ ){
         float samp = *out2 + self->offset; // apply shift for centering and transpose
-
-        float n_samp = samp/self->scaling; // samp normalized to [0,1.0)
-
-        float divs = floorf(n_samp);
-        float phase = n_samp - divs; // [0,1.0)
-
-        int note = (int)(phase * self->dlLen); // map phase to num of note choices
-        float note_map = self->divlist[note]; // apply lookup table
-        note_map /= self->modulo; // remap via num of options
-
-        *out2++ = self->scaling * (divs + note_map);
+        if( samp < lo || samp >= hi ){ // left the window
+            q  = lookup( self, samp );
+            lo = self->win_lo;
+            hi = self->win_hi;
+        }
+        *out2++ = q;
     }
     self->state = out[size-1]; // save last value
+    if( self->note_action ){ note_event( self ); }
     return out;
 }
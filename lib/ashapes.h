@@ -4,7 +4,11 @@
 
 #define MAX_DIV_LIST_LEN 24
 
-#define ASHAPER_CHANNELS 4
+// minimum processed blocks between note events. ~5ms at 48kHz / 32
+#define NOTE_HOLDOFF 8
+
+// called from the DSP with the note just reached, so the event can carry it
+typedef void (*AShaper_note_action_t)( int index, int note, int octave, float volts );
 
 typedef struct{
     int    index;
@@ -15,6 +19,26 @@ typedef struct{
     float  offset;
     bool   active;
     float  state;
+    bool   dirty; // scale changed since last processed block
+
+    // precomputed in set_scale
+    float  note_map[MAX_DIV_LIST_LEN]; // divlist / modulo
+    float  note_width; // scaling / dlLen. input span of one note
+
+    // input window (after offset) that maps to the current note
+    // padded by hysteresis, so the quantized output is reused while inside it
+    float  hysteresis;
+    float  win_lo;
+    float  win_hi;
+    float  quantized;
+    int    note;   // index into divlist of the current output
+    int    octave; // count of scale repeats
+
+    // note-change events. off when note_action is NULL
+    AShaper_note_action_t note_action;
+    int    sent_note;   // last note reported
+    int    sent_octave;
+    int    holdoff;     // processed blocks until another event may be sent
 } AShape_t;
 
 void AShaper_init( int channels );
@@ -26,7 +50,13 @@ void AShaper_set_scale( int    index
                       , float  modulo
                       , float  scaling
                       );
+// input must move this many volts beyond a note's window to change note
+void AShaper_set_hysteresis( int index, float volts );
+// action is called (from the DSP) when the quantized note changes. NULL disables
+// events are rate-limited & the final note of a fast slew is always reported
+void AShaper_set_note_action( int index, AShaper_note_action_t action );
 float AShaper_get_state( int index );
+bool AShaper_is_dirty( int index );
 
 float* AShaper_v( int     index
                 , float*  out
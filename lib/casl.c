@@ -2,354 +2,1155 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h> // floorf
+#include <string.h> // memcmp
+#include <math.h> // floorf, sqrtf
+
+#include "stm32f7xx.h" // BLOCK_IRQS
 
 #include "caw.h" // Caw_printf
+#include "fastmath.h" // fast_log2f, fast_cosf
+#include "shapes.h" // shapes_curve_retain()
 
 #include "lualink.h" // L_queue_asl_done for raising a sequence-complete event
 
 // TODO
-// add sequins data type
-// add random math operator
 // dynamics should be available for SHAPEs (though not mutables)
-// switch to a pooled memory store to enable more complex ASLs to borrow memory from cheap ones
 
-#define SELVES_COUNT 4
-static Casl* _selves[SELVES_COUNT];
+// instant stages run back-to-back inside the DSP callback. after this many ops
+// the program yields for a sample, so a loop of zero-time stages can't stall the ISR
+#define OP_BUDGET 256
+#define YIELD_MS  (1.0/SAMPLES_PER_MS)
+
+typedef struct{
+    uint8_t* mem;
+    int      size;     // bytes per element
+    int      capacity; // elements
+    int      used;     // elements. blocks are packed from 0
+} Pool;
+
+static uint32_t rand_state = 0x9E3779B9; // never 0
+static int selves_count = 0;
+static Casl** _selves = NULL;
+static Pool pools[POOL_COUNT];
 
 
 static int casl_defdynamicP( Casl* self );
 
 
-Casl* casl_init( int index )
+static bool pool_init( Pool* p, int size, int capacity )
+{
+    p->mem      = malloc(size * capacity);
+    p->size     = size;
+    p->capacity = capacity;
+    p->used     = 0;
+    return p->mem != NULL;
+}
+
+void casl_init( int channels )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return NULL; }
+    _selves = malloc(sizeof(Casl*) * channels);
+    if(!_selves){ printf("Casl** malloc!\n"); return; }
 
-    Casl* self = malloc(sizeof(Casl));
-    if(!self){ printf("Casl* malloc!\n"); return NULL; }
+    if( !pool_init(&pools[POOL_Code], sizeof(Op),      channels * CODE_COUNT)
+     || !pool_init(&pools[POOL_Seq],  sizeof(Sequins), channels * SEQ_COUNT)
+     || !pool_init(&pools[POOL_Dyn],  sizeof(Elem),    channels * DYN_COUNT) ){
+        printf("casl pools malloc!\n");
+        return;
+    }
 
-    _selves[index] = self; // save ref for indexed lookup
+    for(int i=0; i<channels; i++){
+        Casl* self = malloc(sizeof(Casl));
+        if(!self){ printf("Casl* malloc!\n"); return; }
 
-    self->to_ix = 0; // To* allocation count
-    self->seq_current = &self->seqs[0];
-    self->seq_ix  = 0;  // counts up allocation of Sequence slots
-    self->seq_select = -1; // current 'parent'
-    self->dyn_ix = 0;
+        _selves[i] = self; // save ref for indexed lookup
+        self->index   = i;
+        self->program = i;
 
-    self->holding = false;
-    self->locked = false;
+        for(int p=0; p<POOL_COUNT; p++){
+            self->blocks[p] = (Block){ .base = 0, .count = 0 };
+        }
+        self->pc = 0; // no program
+        self->hash = 0;
 
-    return self;
+        self->holding = false;
+        self->locked = false;
+        self->busy = false;
+        self->osc = -1;
+
+        self->slew  = 0.0;
+        self->shape = SHAPE_Linear;
+
+        selves_count = i+1; // only count successful allocations
+    }
 }
 
-static void seq_enter( Casl* self )
+///////////////////////////////
+// Pools
+// each channel owns one contiguous Block of each pool. blocks are packed
+// so all free space is at the end. a channel allocates by moving its block
+// to the end & growing it. freeing a block slides the following blocks down
+// the DSP reads through Block.base, so each block's move & new base happen with
+// IRQs blocked. blocks move one at a time, so IRQs are never held for the whole pool
+
+typedef uint32_t Word; // every element is a whole number of words
+
+static inline Word* pool_word( Pool* p, int elem ){ return (Word*)&p->mem[elem * p->size]; }
+static inline int pool_words( Pool* p, int elems ){ return elems * p->size / sizeof(Word); }
+
+static void words_move( Word* dst, Word* src, int n ) // forward, so dst may overlap the end of src
 {
-    if(self->seq_ix >= SEQ_COUNT){
-        printf("ERROR: no sequences left!\n");
-        Caw_printf("ERROR: no sequences left!\n");
-        return;
+    while( n-- ){ *dst++ = *src++; }
+}
+
+static void words_reverse( Word* a, Word* b ) // [a, b)
+{
+    while( a < --b ){
+        Word t = *a;
+        *a++ = *b;
+        *b = t;
+    }
+}
+
+static void blocks_shift( PoolType pt, int after, int by )
+{
+    for(int i=0; i<selves_count; i++){
+        Block* o = &_selves[i]->blocks[pt];
+        if( o->base > after ){ o->base -= by; }
+    }
+}
+
+// the (non-empty) block starting at element base
+static Block* block_at( PoolType pt, int base )
+{
+    for(int i=0; i<selves_count; i++){
+        Block* o = &_selves[i]->blocks[pt];
+        if( o->count && o->base == base ){ return o; }
+    }
+    return NULL;
+}
+
+// slides the blocks in [hole+gap, end) down by gap
+static void pool_close( PoolType pt, int hole, int gap, int end )
+{
+    Pool* p = &pools[pt];
+    while( hole + gap < end ){
+        Block* o = block_at( pt, hole + gap );
+        if( !o ){ break; } // blocks are packed, so only if the pool is corrupt
+        BLOCK_IRQS(
+            words_move( pool_word(p, hole), pool_word(p, o->base), pool_words(p, o->count) );
+            o->base = hole;
+        );
+        hole += o->count;
+    }
+}
+
+// frees all but the first keep elements of the block
+static void pool_shrink( Casl* self, PoolType pt, int keep )
+{
+    Pool*  p = &pools[pt];
+    Block* b = &self->blocks[pt];
+    if( b->count > keep ){
+        int gap = b->count - keep;
+        int end = p->used;
+        BLOCK_IRQS( b->count = keep; ); // the tail is unused from here
+        pool_close( pt, b->base + keep, gap, end );
+        p->used -= gap;
+    }
+    if( b->count == 0 ){ b->base = p->used; }
+}
+
+static void pool_release( Casl* self, PoolType pt )
+{
+    pool_shrink( self, pt, 0 );
+}
+
+// moves the block after all others so it can grow
+static void pool_to_end( Casl* self, PoolType pt )
+{
+    Pool*  p = &pools[pt];
+    Block* b = &self->blocks[pt];
+    if( b->count == 0 ){ b->base = p->used; return; }
+    if( b->base + b->count == p->used ){ return; } // already last
+    int hole = b->base;
+    int end  = p->used;
+    if( end + b->count <= p->capacity ){
+        // copy into the free space, which the DSP never reads, then close up behind it
+        words_move( pool_word(p, end), pool_word(p, hole), pool_words(p, b->count) );
+        BLOCK_IRQS( b->base = end; );
+        pool_close( pt, hole, b->count, end + b->count );
+    } else { // no room for a copy, so rotate it past the others in place
+        BLOCK_IRQS(
+            Word* start = pool_word(p, hole);
+            Word* mid   = pool_word(p, hole + b->count);
+            Word* stop  = pool_word(p, end);
+            words_reverse( start, mid );
+            words_reverse( mid, stop );
+            words_reverse( start, stop );
+            blocks_shift( pt, hole, b->count );
+            b->base = end - b->count;
+        );
+    }
+}
+
+// returns index of the first new element, relative to the block. -1 if full
+static int pool_alloc( Casl* self, PoolType pt, int n )
+{
+    Pool*  p = &pools[pt];
+    Block* b = &self->blocks[pt];
+    if( p->used + n > p->capacity ){ return -1; }
+    pool_to_end( self, pt );
+    int ix = b->count;
+    b->count += n;
+    p->used  += n;
+    return ix;
+}
+
+// code is read through the owning channel, which may be another output
+static inline Op* op_at( Casl* self, int ix ){
+    Block* b = &_selves[self->program]->blocks[POOL_Code];
+    return &((Op*)pools[POOL_Code].mem)[b->base + ix];
+}
+static inline int code_count( Casl* self ){
+    return _selves[self->program]->blocks[POOL_Code].count;
+}
+static inline Sequins* seqn_at( Casl* self, int ix ){
+    return &((Sequins*)pools[POOL_Seq].mem)[self->blocks[POOL_Seq].base + ix];
+}
+static inline Elem* dyn_at( Casl* self, int ix ){
+    return &((Elem*)pools[POOL_Dyn].mem)[self->blocks[POOL_Dyn].base + ix];
+}
+
+int casl_usage( int index, PoolType pool )
+{
+    if( pool < 0 || pool >= POOL_COUNT ){ return 0; }
+    if( index < 0 ){ return pools[pool].used; }
+    if( index >= selves_count ){ return 0; }
+    return _selves[index]->blocks[pool].count;
+}
+
+int casl_capacity( PoolType pool )
+{
+    if( pool < 0 || pool >= POOL_COUNT ){ return 0; }
+    return pools[pool].capacity;
+}
+
+
+///////////////////////////////
+// Program construction
+// the lua table is walked once, recursively, emitting ops in execution order.
+// the DSP only ever runs the flat result.
+
+#define LIT_MAX    64 // literals in a cacheable description
+#define HASH_VOLTS 1  // Casl.hash of a casl_volts program
+
+typedef struct{
+    uint32_t hash;
+    int      count;
+    ElemO    lits[LIT_MAX]; // in emit order
+    bool     ok; // false if the description can't be cached
+} Scan;
+
+// state threaded through a single compile
+typedef struct{
+    int  depth;   // values on the expression stack
+    int  pending; // mutable awaiting write-back, or -1
+    bool failed;
+} Compiler;
+
+static void compile_error( Compiler* c, const char* msg )
+{
+    if( !c->failed ){ // only report the first error
+        printf("ERROR: %s\n", msg);
+        Caw_printf("ERROR: %s\n", msg);
+    }
+    c->failed = true;
+}
+
+// returns the index of the new op, or -1
+static int emit( Casl* self, Compiler* c, Opcode op, int arg, ElemO lit )
+{
+    switch( op ){ // track the stack depth the op will leave behind
+        case OP_Lit: case OP_Dyn: case OP_Mut: case OP_Seq:
+            if( ++c->depth > EVAL_DEPTH ){
+                compile_error(c, "ASL expression too complex");
+                return -1;
+            }
+            break;
+        case OP_Add: case OP_Sub: case OP_Mul: case OP_Div: case OP_Mod:
+        case OP_Rand: case OP_Gauss:
+            c->depth--; break;
+        case OP_Store: case OP_Negate: case OP_Data:
+            break;
+        default: // control ops consume the stack
+            c->depth = 0; break;
+    }
+    int ix = pool_alloc(self, POOL_Code, 1);
+    if(ix < 0){
+        compile_error(c, "ASL too long. not enough code space left");
+        return -1;
     }
-    Sequence* s = &self->seqs[self->seq_ix];
-    self->seq_current = s; // save as 'active' Sequence
+    Op* o = op_at(self, ix);
+    o->op  = op;
+    o->arg = arg;
+    o->lit = lit;
+    return ix;
+}
 
-    s->length = 0;
-    s->pc     = 0;
-    s->parent = self->seq_select;
+static int emit_op( Casl* self, Compiler* c, Opcode op, int arg )
+{
+    return emit(self, c, op, arg, (ElemO){ .f = 0.0 });
+}
+
+// dynamics are allocated by lua before describe, so the index can be checked now
+static int emit_dyn( Casl* self, Compiler* c, Opcode op, int dyn )
+{
+    if( dyn < 0 || dyn >= self->blocks[POOL_Dyn].count ){
+        compile_error(c, "ASL dynamic out of range");
+        return -1;
+    }
+    return emit_op(self, c, op, dyn);
+}
+
+// jump any unresolved Ifs in [first, end) to end
+static void patch_ifs( Casl* self, int first, int end )
+{
+    for( int i=first; i<end; i++ ){
+        Op* o = op_at(self, i);
+        if( o->op == OP_If && o->arg < 0 ){ o->arg = end; }
+    }
+}
+
+// user curves are referenced by the code that uses them, so their slots can be recycled
+static void curve_retain( Shape_t shape ){ shapes_curve_retain( (int)shape - SHAPE_Curve ); }
+static void curve_release( Shape_t shape ){ shapes_curve_release( (int)shape - SHAPE_Curve ); }
+
+static void release_curves( Casl* self )
+{
+    for( int i=0; i<code_count(self); i++ ){
+        Op* o = op_at(self, i);
+        if( o->op == OP_Lit && o->arg == LIT_Shape ){ curve_release( o->lit.shape ); }
+    }
+}
 
-    self->seq_select = self->seq_ix; // select the new Sequence
-    self->seq_ix++; // marks the sequence as allocated
+// stop running a shared program, or hand an owned one to a channel sharing it
+static void release_code( Casl* self )
+{
+    if( self->program != self->index ){ // sharing. our own code block is empty
+        self->program = self->index;
+        return;
+    }
+    int heir = -1;
+    for( int i=0; i<selves_count && heir<0; i++ ){
+        if( i != self->index && _selves[i]->program == self->index ){ heir = i; }
+    }
+    if( heir < 0 ){
+        release_curves(self);
+        pool_release(self, POOL_Code);
+        return;
+    }
+    BLOCK_IRQS( // the code stays in place, only its owner changes
+        _selves[heir]->blocks[POOL_Code] = self->blocks[POOL_Code];
+        for( int i=0; i<selves_count; i++ ){
+            if( _selves[i]->program == self->index ){ _selves[i]->program = heir; }
+        }
+        self->program = self->index;
+        self->blocks[POOL_Code].base  = pools[POOL_Code].used;
+        self->blocks[POOL_Code].count = 0;
+    );
 }
 
-static void seq_exit( Casl* self )
+static void clear_program( Casl* self )
 {
-    self->seq_select = self->seq_current->parent; // move up tree
-    self->seq_current = &self->seqs[self->seq_select]; // save the new node
+    // deallocate everything & compact the pool
+    self->osc = -1;
+    self->pc = 0;
+    self->hash = 0;
+    release_code(self);
+    pool_release(self, POOL_Seq);
 }
 
-static void seq_append( Casl* self, To* t )
+static bool is_shared( Casl* self )
 {
-    Sequence* s = self->seq_current;
-    if(s->length >= SEQ_LENGTH){
-        printf("ERROR: no stages left!\n");
-        Caw_printf("ERROR: no stages left!\n");
+    if( self->program != self->index ){ return true; }
+    for( int i=0; i<selves_count; i++ ){
+        if( i != self->index && _selves[i]->program == self->index ){ return true; }
     }
-    s->stage[s->length] = t; // append To* to end of Sequence
-    s->length++;
+    return false;
 }
 
-static void parse_table( Casl* self, lua_State* L );
+static void compile_table( Casl* self, Compiler* c, lua_State* L, int first );
+static void scan_description( Casl* self, lua_State* L, Scan* s );
+static bool lits_match( Casl* self, Casl* prog, Scan* s );
+static bool patch_program( Casl* self, Scan* s, bool write );
+static bool share_program( Casl* self, Casl* owner, Scan* s );
+static Casl* find_program( Casl* self, Scan* s );
 void casl_describe( int index, lua_State* L )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return; }
+    if(index < 0 || index >= selves_count){ return; }
+    Casl* self = _selves[index];
+
+    static Scan s; // only called from the main loop
+    scan_description(self, L, &s);
+    self->busy = true;
+    if( s.ok ){
+        bool hit = s.hash == self->hash;
+        if( hit && lits_match(self, self, &s) && patch_program(self, &s, false) ){
+            self->busy = false; // already running this exact program
+            return;
+        }
+        Casl* owner = find_program(self, &s);
+        if( owner ){ // another channel already runs this exact program
+            clear_program(self);
+            if( share_program(self, owner, &s) ){
+                self->busy = false;
+                return;
+            }
+        } else if( hit && !is_shared(self) && patch_program(self, &s, true) ){
+            self->busy = false; // shared code can't be rewritten under other channels
+            return;
+        }
+    }
+
+    clear_program(self);
+    int dyns = self->blocks[POOL_Dyn].count; // mutables are allocated after these
+    Compiler c = { .depth = 0, .pending = -1, .failed = false };
+    compile_table(self, &c, L, 0);
+    patch_ifs(self, 0, code_count(self)); // a top-level If ends the program
+    if( c.failed ){ // don't leave a partial program, or the mutables it allocated
+        clear_program(self);
+        pool_shrink(self, POOL_Dyn, dyns);
+    }
+    else if( s.ok ){ self->hash = s.hash; }
+    self->busy = false;
+}
+
+void casl_volts( int index, float volts )
+{
+    if(index < 0 || index >= selves_count){ return; }
     Casl* self = _selves[index];
 
-    // deallocate everything
-    self->to_ix  = 0;
-    self->seq_ix = 0;
-    self->seq_select = -1; // current 'parent'
-    // reset all sequences
-    self->seq_current = &self->seqs[0]; // first sequence
-    for(int i=0; i<SEQ_COUNT; i++){ self->seqs[i].pc = 0; } // reset all program counters
+    if( self->hash == HASH_VOLTS ){ // already a volts program. just update its literals
+        float slew = self->slew;
+        Shape_t shape = self->shape;
+        Shape_t old = op_at(self, 2)->lit.shape;
+        curve_retain( shape );
+        BLOCK_IRQS(
+            op_at(self, 0)->lit.f = volts;
+            op_at(self, 1)->lit.f = slew;
+            op_at(self, 2)->lit.shape = shape;
+            self->pc = 0;
+            self->osc = -1;
+        );
+        curve_release( old );
+    } else { // emit the single To directly rather than walking a lua table
+        self->busy = true;
+        clear_program(self);
+        Compiler c = { .depth = 0, .pending = -1, .failed = false };
+        emit(self, &c, OP_Lit, 0, (ElemO){ .f = volts });
+        emit(self, &c, OP_Lit, 0, (ElemO){ .f = self->slew });
+        if( emit(self, &c, OP_Lit, LIT_Shape, (ElemO){ .shape = self->shape }) >= 0 ){
+            curve_retain( self->shape );
+        }
+        emit_op(self, &c, OP_To, 0);
+        self->busy = false;
+        if( c.failed ){ clear_program(self); return; }
+        self->hash = HASH_VOLTS;
+    }
+    casl_action(index, 1);
+}
 
-    // enter first sequence
-    seq_enter(self);
+void casl_setslew( int index, float slew )
+{
+    if(index < 0 || index >= selves_count){ return; }
+    _selves[index]->slew = slew;
+}
 
-    parse_table(self, L);
-    // seq_exit(self)? // i think we want to start inside the first Seq anyway
+float casl_getslew( int index )
+{
+    if(index < 0 || index >= selves_count){ return 0.0; }
+    return _selves[index]->slew;
+}
+
+void casl_setshape( int index, Shape_t shape )
+{
+    if(index < 0 || index >= selves_count){ return; }
+    Casl* self = _selves[index];
+    curve_retain( shape );
+    curve_release( self->shape );
+    self->shape = shape;
 }
 
 // suite of functions for unwrapping elements of Lua tables
+// none of them raise a lua error, which would longjmp out of the compiler leaving the
+// channel busy with a partial program. values of the wrong type read as 0, so the
+// compiler checks types with ix_type before it writes anything
 static int ix_type( lua_State* L, int ix )
 {
-    lua_pushnumber(L, ix); // query first table elem
-    lua_gettable(L, -2);  // get above key from table on stack
-    int ix_type = lua_type(L, -1); // types from lua.h
+    int ix_type = lua_rawgeti(L, -1, ix); // types from lua.h
     lua_pop(L, 1);
     return ix_type;
 }
 static void ix_str( char *result, lua_State* L, int ix, int length )
 {
-    lua_pushnumber(L, ix); // query first table elem
-    lua_gettable(L, -2);  // get above key from table on stack
-    const char *s = luaL_checkstring(L, -1);
+    const char *s = (lua_rawgeti(L, -1, ix) == LUA_TSTRING) ? lua_tostring(L, -1) : "";
     for (int i = 0; i < length; ++i) {
         result[i] = s[i];
+        if( !s[i] ){ break; } // shorter strings stop at the terminator
     }
     lua_pop(L, 1);
 }
 static const char ix_char( lua_State* L, int ix )
 {
-    lua_pushnumber(L, ix); // query first table elem
-    lua_gettable(L, -2);  // get above key from table on stack
-    const char ix_char = luaL_checkstring(L, -1)[0]; // types from lua.h
-    lua_pop(L, 1);
-    return ix_char;
+    char c = 0;
+    ix_str(&c, L, ix, 1);
+    return c;
 }
 static float ix_num( lua_State* L, int ix )
 {
-    lua_pushnumber(L, ix); // query first table elem
-    lua_gettable(L, -2);  // get above key from table on stack
-    float ix_num = luaL_checknumber(L, -1); // types from lua.h
+    lua_rawgeti(L, -1, ix);
+    float ix_num = lua_tonumber(L, -1); // 0 if not a number
     lua_pop(L, 1);
     return ix_num;
 }
 static float ix_bool( lua_State* L, int ix )
 {
-    lua_pushnumber(L, ix); // query first table elem
-    lua_gettable(L, -2);  // get above key from table on stack
+    lua_rawgeti(L, -1, ix);
     float ix_num = lua_toboolean(L, -1) ? 1.0 : 0.0;
     lua_pop(L, 1);
     return ix_num;
 }
 static int ix_int( lua_State* L, int ix )
 {
-    lua_pushnumber(L, ix); // query first table elem
-    lua_gettable(L, -2);  // get above key from table on stack
-    int ix_int = luaL_checkinteger(L, -1); // types from lua.h
+    lua_rawgeti(L, -1, ix);
+    int ix_int = lua_tointeger(L, -1); // 0 if not an integer
     lua_pop(L, 1);
     return ix_int;
 }
-
-static To* to_alloc( Casl* self )
+// reports a compile error unless t[ix] is a number
+static bool ix_isnum( Compiler* c, lua_State* L, int ix, const char* msg )
 {
-    if(self->to_ix >= TO_COUNT){ return NULL; }
-    To* t = &self->tos[self->to_ix]; // get next To
-    self->to_ix++; // mark as allocated
-    return t;
+    if( ix_type(L, ix) == LUA_TNUMBER ){ return true; }
+    compile_error(c, msg);
+    return false;
 }
 
-static void read_to( Casl* self, To* t, lua_State* L );
-static void capture_elem( Casl* self, Elem* e, lua_State* L, int ix );
-static void parse_table( Casl* self, lua_State* L )
+static void compile_operand( Casl* self, Compiler* c, lua_State* L, int ix );
+
+// compiles the stage or sequence on top of the lua stack
+// first is the start of the enclosing sequence, for Recur
+static void compile_table( Casl* self, Compiler* c, lua_State* L, int first )
 {
+    if( c->failed ){ return; }
     switch( ix_type(L, 1) ){ // types from lua.h
 
         case LUA_TSTRING: { // TO, RECUR
-            To* t = to_alloc(self);
-            if(t == NULL){
-                printf("ERROR: not enough To slots left\n");
-                Caw_printf("ERROR: not enough To slots left\n");
-                return;
-            }
-            seq_append(self, t);
             switch( ix_char(L, 1) ){
-                case 'T': read_to(self, t, L); break; // standard To
-                case 'R':{ t->ctrl = ToRecur; break; } // Recur ctrlflow
+                case 'T':{ // standard To
+                    compile_operand(self, c, L, 2); // volts
+                    compile_operand(self, c, L, 3); // time
+                    compile_operand(self, c, L, 4); // shape
+                    emit_op(self, c, OP_To, 0);
+                    break;}
+                case 'V':{ // VCO: free-running oscillator
+                    compile_operand(self, c, L, 2); // freq
+                    compile_operand(self, c, L, 3); // level
+                    char s[2] = { 0, 0 };
+                    ix_str(s, L, 4, 2); // wave
+                    emit_op(self, c, OP_Osc, S_str_to_wave( s ));
+                    break;}
+                case 'R': emit_op(self, c, OP_Recur, first); break;
                 case 'I':{ // If ctrlflow
-                    capture_elem(self, &(t->a), L, 2); // capture predicate from ix[2] to t->a
-                    t->ctrl = ToIf;
-                    break; }
-                case 'H':{ t->ctrl = ToHeld; break; }
-                case 'W':{ t->ctrl = ToWait; break; }
-                case 'U':{ t->ctrl = ToUnheld; break; }
-                case 'L':{ t->ctrl = ToLock; break; }
-                case 'O':{ t->ctrl = ToOpen; break; }
+                    compile_operand(self, c, L, 2); // predicate
+                    emit_op(self, c, OP_If, -1); // target is patched at the end of the sequence
+                    break;}
+                case 'H': emit_op(self, c, OP_Held, 0); break;
+                case 'W': emit_op(self, c, OP_Wait, 0); break;
+                case 'U': emit_op(self, c, OP_Unheld, 0); break;
+                case 'L': emit_op(self, c, OP_Lock, 0); break;
+                case 'O': emit_op(self, c, OP_Open, 0); break;
                 default:
-                    printf("ERROR char not found\n");
-                    Caw_printf("ERROR char not found\n");
+                    compile_error(c, "ASL char not found");
                     break;
             }
             break;}
 
         case LUA_TTABLE:{ // NEST
-            To* t = to_alloc(self);
-            seq_append(self, t);
-            t->ctrl = ToEnter; // mark as entering a sub-Seq
-            seq_enter(self);
-            t->a.obj.seq = self->seq_select; // pass this To* to seq_enter, and do this line in there
+            int enter = emit_op(self, c, OP_Enter, -1);
+            if( enter < 0 ){ return; }
+            int start = code_count(self);
             int seq_len = lua_rawlen(L, -1);
             for( int i=1; i<=seq_len; i++ ){ // Lua is 1-based
-                lua_pushnumber(L, i); // grab the next elem
-                lua_gettable(L, -2); // push that inner-table to the stack
-                parse_table(self, L); // RECUR
+                lua_rawgeti(L, -1, i); // push the next inner-table to the stack
+                compile_table(self, c, L, start); // RECUR
                 lua_pop(L, 1); // pops inner-table
             }
-            seq_exit(self);
+            if( c->failed ){ return; }
+            int end = code_count(self);
+            patch_ifs(self, start, end);
+            op_at(self, enter)->arg = end;
             break;}
 
         default:
             printf("ERROR unhandled parse type\n");
             Caw_printf("ERROR ASL unhandled type. Do you have a function in your ASL? Replace it with dyn.\n");
+            c->failed = true;
             break;
     }
 }
 
-static void read_to( Casl* self, To* t, lua_State* L )
+static void compile_elem( Casl* self, Compiler* c, lua_State* L, int ix );
+
+// a top-level argument of a stage. writes back any mutable that wasn't explicitly mutated
+static void compile_operand( Casl* self, Compiler* c, lua_State* L, int ix )
+{
+    c->pending = -1;
+    compile_elem(self, c, L, ix);
+    if( c->pending >= 0 ){
+        emit_op(self, c, OP_Store, c->pending);
+        c->pending = -1;
+    }
+}
+
+static void compile_binop( Casl* self, Compiler* c, lua_State* L, Opcode op )
 {
-    capture_elem(self, &(t->a), L, 2);
-    capture_elem(self, &(t->b), L, 3);
-    capture_elem(self, &(t->c), L, 4);
-    t->ctrl = ToLiteral;
+    compile_elem(self, c, L, 2);
+    compile_elem(self, c, L, 3);
+    emit_op(self, c, op, 0);
 }
 
-static void allocating_capture( Casl* self, Elem* e, lua_State* L, ElemT t, int count )
+static void sequins_reset( Sequins* q, ElemO first )
 {
-    e->type = t;
-    for(int i=0; i<count; i++){
-        int var = casl_defdynamicP(self); // allocate a dynamic to hold op. FIXME 0 is asl id
-        e->obj.var[i] = var; // capture dynamic ref
-        capture_elem(self, &self->dynamics[var], L, i+2); // recur to capture operand
+    q->ix       = -1;
+    q->every.ix = 0;
+    q->times.ix = 0;
+    q->count.ix = 0;
+    q->last     = first;
+}
+
+// {'SEQ', {values..}, step, every, times, count} on top of the stack. unused flows are 0
+static void compile_sequins( Casl* self, Compiler* c, lua_State* L )
+{
+    for( int i=3; i<=6; i++ ){
+        if( !ix_isnum(c, L, i, "ASL sequins step & flows must be numbers") ){ return; }
     }
+    int step  = ix_int(L, 3);
+    int every = ix_int(L, 4);
+    int times = ix_int(L, 5);
+    int count = ix_int(L, 6);
+
+    if( lua_rawgeti(L, -1, 2) != LUA_TTABLE ){ // values
+        compile_error(c, "ASL sequins has no values");
+        lua_pop(L, 1);
+        return;
+    }
+    int len = lua_rawlen(L, -1);
+    if( len < 1 ){
+        compile_error(c, "ASL sequins is empty");
+        lua_pop(L, 1);
+        return;
+    }
+    for( int i=1; i<=len; i++ ){ // checked before anything is allocated
+        if( !ix_isnum(c, L, i, "ASL sequins can only hold numbers") ){
+            lua_pop(L, 1);
+            return;
+        }
+    }
+    int q = pool_alloc(self, POOL_Seq, 1);
+    if( q < 0 ){
+        compile_error(c, "no sequins left");
+        lua_pop(L, 1);
+        return;
+    }
+    Sequins* sq = seqn_at(self, q);
+    sq->length = len;
+    sq->step   = step;
+    sq->every  = (Flow){ .n = every };
+    sq->times  = (Flow){ .n = times };
+    sq->count  = (Flow){ .n = count };
+    sequins_reset(sq, (ElemO){ .f = ix_num(L, 1) });
+
+    emit_op(self, c, OP_Seq, q);
+    for( int i=1; i<=len; i++ ){
+        emit(self, c, OP_Data, 0, (ElemO){ .f = ix_num(L, i) });
+    }
+    lua_pop(L, 1);
 }
 
-// REFACTOR to have it return the Elem (and copy it) rather than passing a pointer
-static void capture_elem( Casl* self, Elem* e, lua_State* L, int ix )
+static void compile_elem( Casl* self, Compiler* c, lua_State* L, int ix )
 {
+    if( c->failed ){ return; }
     switch( ix_type(L, ix) ){ // type of table elem
-        case LUA_TNUMBER:{
-            e->obj.f = ix_num(L, ix);
-            e->type = ElemT_Float;
-            break;}
+        case LUA_TNUMBER:
+            emit(self, c, OP_Lit, 0, (ElemO){ .f = ix_num(L, ix) });
+            break;
 
-        case LUA_TBOOLEAN:{
-            e->obj.f = ix_bool(L, ix);
-            e->type = ElemT_Float;
-            break;}
+        case LUA_TBOOLEAN:
+            emit(self, c, OP_Lit, 0, (ElemO){ .f = ix_bool(L, ix) });
+            break;
 
         case LUA_TSTRING:{
-            char s[2];
+            char s[2] = { 0, 0 };
             ix_str(s, L, ix, 2);
-            e->obj.shape = S_str_to_shape( s );
-            e->type = ElemT_Shape;
+            emit(self, c, OP_Lit, 0, (ElemO){ .shape = S_str_to_shape( s ) });
             break;}
 
         case LUA_TTABLE: // handle behavioural-types
-            lua_pushnumber(L, ix); // push ix of To
-            lua_gettable(L, -2);  // unwrap To[ix]
+            lua_rawgeti(L, -1, ix); // unwrap To[ix]
             char index = ix_char(L, 1); // parse on first char at ix[1]
+            if( !index ){
+                compile_error(c, "ASL composite To must start with a string");
+                lua_pop(L, 1);
+                break;
+            }
+            if( (index == 'D' || index == 'N' || index == 'C')
+             && !ix_isnum(c, L, 2, "ASL dynamic & curve indices must be numbers") ){
+                lua_pop(L, 1);
+                break;
+            }
             switch( index ){ // parse on first char at ix[1]
-                case 'D':{ // DYNAMIC
-                    e->obj.dyn = ix_int(L, 2); // grab dyn_ix at ix[2]
-                    e->type = ElemT_Dynamic;
+                case 'D': emit_dyn(self, c, OP_Dyn, ix_int(L, 2)); break; // DYNAMIC
+                case 'M':{ // MUTABLE. its initial value lives in a new dynamic
+                    if( !ix_isnum(c, L, 2, "ASL mutable must be a number") ){ break; }
+                    int var = casl_defdynamicP(self);
+                    if( var < 0 ){ c->failed = true; break; }
+                    Elem* d = dyn_at(self, var);
+                    d->obj.f = ix_num(L, 2);
+                    d->type  = ElemT_Float;
+                    emit_op(self, c, OP_Mut, var);
+                    c->pending = var;
                     break;}
-                case 'M': // MUTABLE
-                    allocating_capture(self, e, L, ElemT_Mutable, 1); break;
-                case 'N':{// NAMED MUTABLE. combination of dynamic & mutable for live update
-                    e->obj.var[0] = ix_int(L, 2); // grab dyn_ix at ix[2]
-                    e->type = ElemT_Mutable;
+                case 'N':{ // NAMED MUTABLE. combination of dynamic & mutable for live update
+                    int var = ix_int(L, 2);
+                    emit_dyn(self, c, OP_Mut, var);
+                    c->pending = var;
                     break;}
-                case '~': allocating_capture(self, e, L, ElemT_Negate, 1); break;
-                case '+': allocating_capture(self, e, L, ElemT_Add, 2); break;
-                case '-': allocating_capture(self, e, L, ElemT_Sub, 2); break;
-                case '*': allocating_capture(self, e, L, ElemT_Mul, 2); break;
-                case '/': allocating_capture(self, e, L, ElemT_Div, 2); break;
-                case '%': allocating_capture(self, e, L, ElemT_Mod, 2); break;
-                case '#': allocating_capture(self, e, L, ElemT_Mutate, 1); break;
+                case 'C':{ // CURVE. index of a table registered with shape_defcurve
+                    Shape_t shape = SHAPE_Curve + ix_int(L, 2);
+                    if( emit(self, c, OP_Lit, LIT_Shape, (ElemO){ .shape = shape }) >= 0 ){
+                        curve_retain( shape );
+                    }
+                    break;}
+                case 'S': compile_sequins(self, c, L); break; // SEQUINS
+                case '~':
+                    compile_elem(self, c, L, 2);
+                    emit_op(self, c, OP_Negate, 0);
+                    break;
+                case '+': compile_binop(self, c, L, OP_Add); break;
+                case '-': compile_binop(self, c, L, OP_Sub); break;
+                case '*': compile_binop(self, c, L, OP_Mul); break;
+                case '/': compile_binop(self, c, L, OP_Div); break;
+                case '%': compile_binop(self, c, L, OP_Mod); break;
+                case 'R': compile_binop(self, c, L, OP_Rand); break; // RAND
+                case 'G': compile_binop(self, c, L, OP_Gauss); break; // GAUSS
+                case '#': // MUTATE. writes the result back to the innermost mutable
+                    compile_elem(self, c, L, 2);
+                    if( c->pending >= 0 ){
+                        emit_op(self, c, OP_Store, c->pending);
+                        c->pending = -1; // mutation resolved!
+                    }
+                    break;
 
                 default:
                     printf("ERROR composite To char '%c'not found\n",index);
                     Caw_printf("ERROR composite To char '%c'not found\n",index);
+                    c->failed = true;
                     break;
             }
             lua_pop(L, 1);
             break;
 
         default:
-            printf("ERROR unknown To type\n");
-            Caw_printf("ERROR unknown To type\n");
+            compile_error(c, "unknown To type");
             break;
     }
 }
 
 
 ///////////////////////////////
-// Runtime
+// Describe cache
+// re-describing with the same structure (eg. retriggering ar() with new times)
+// skips compilation. a single pass over the table hashes everything that
+// determines the code & collects the literal operands. on a match the literals
+// are patched into the existing program, in the order they were emitted.
+
+// FNV-1a
+static void hash_byte( Scan* s, uint8_t b )
+{
+    s->hash = (s->hash ^ b) * 16777619u;
+}
+static void hash_int( Scan* s, int v )
+{
+    for( int i=0; i<4; i++ ){ hash_byte(s, (v >> (i*8)) & 0xFF); }
+}
+
+static void scan_lit( Scan* s, ElemO v )
+{
+    hash_byte(s, 'l');
+    if( s->count >= LIT_MAX ){ s->ok = false; return; }
+    s->lits[s->count++] = v;
+}
+
+// first char of the string at t[ix], or 0
+static char scan_char( lua_State* L, int ix )
+{
+    char c = 0;
+    if( lua_rawgeti(L, -1, ix) == LUA_TSTRING ){ c = lua_tostring(L, -1)[0]; }
+    lua_pop(L, 1);
+    return c;
+}
+
+// wave at t[ix], parsed exactly as compile does so different waves never hash alike
+static int scan_wave( lua_State* L, int ix )
+{
+    char w[2] = {0};
+    if( lua_rawgeti(L, -1, ix) == LUA_TSTRING ){
+        const char* str = lua_tostring(L, -1);
+        w[0] = str[0];
+        if( w[0] ){ w[1] = str[1]; }
+    }
+    lua_pop(L, 1);
+    return S_str_to_wave( w );
+}
+
+static int scan_int( lua_State* L, int ix )
+{
+    lua_rawgeti(L, -1, ix);
+    int i = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+    return i;
+}
+
+// mirrors compile_elem, for the value on top of the stack
+static void scan_elem( Scan* s, lua_State* L )
+{
+    switch( lua_type(L, -1) ){
+        case LUA_TNUMBER:  scan_lit(s, (ElemO){ .f = lua_tonumber(L, -1) }); break;
+        case LUA_TBOOLEAN: scan_lit(s, (ElemO){ .f = lua_toboolean(L, -1) ? 1.0 : 0.0 }); break;
+        case LUA_TSTRING:{
+            const char* str = lua_tostring(L, -1);
+            char sh[2] = { str[0], str[1] };
+            scan_lit(s, (ElemO){ .shape = S_str_to_shape( sh ) });
+            break;}
+        case LUA_TTABLE:{
+            char c = scan_char(L, 1);
+            hash_byte(s, c);
+            switch( c ){
+                case 'D': case 'N': hash_int(s, scan_int(L, 2)); break;
+                case 'C': scan_lit(s, (ElemO){ .shape = SHAPE_Curve + scan_int(L, 2) }); break;
+                case 'M':
+                    if( lua_rawgeti(L, -1, 2) == LUA_TNUMBER ){
+                        scan_lit(s, (ElemO){ .f = lua_tonumber(L, -1) });
+                    } else { s->ok = false; }
+                    lua_pop(L, 1);
+                    break;
+                case 'S':{
+                    for( int i=3; i<=6; i++ ){ hash_int(s, scan_int(L, i)); } // step & flows
+                    lua_rawgeti(L, -1, 2);
+                    int len = lua_rawlen(L, -1);
+                    hash_int(s, len);
+                    for( int i=1; i<=len && s->ok; i++ ){
+                        if( lua_rawgeti(L, -1, i) == LUA_TNUMBER ){
+                            scan_lit(s, (ElemO){ .f = lua_tonumber(L, -1) });
+                        } else { s->ok = false; }
+                        lua_pop(L, 1);
+                    }
+                    lua_pop(L, 1);
+                    break;}
+                case '+': case '-': case '*': case '/': case '%': case 'R': case 'G':
+                    lua_rawgeti(L, -1, 2); scan_elem(s, L); lua_pop(L, 1);
+                    // FALLS THROUGH
+                case '~': case '#':
+                    lua_rawgeti(L, -1, c == '~' || c == '#' ? 2 : 3);
+                    scan_elem(s, L);
+                    lua_pop(L, 1);
+                    break;
+                default: s->ok = false; break;
+            }
+            break;}
+        default: s->ok = false; break;
+    }
+}
+
+static void scan_arg( Scan* s, lua_State* L, int ix )
+{
+    lua_rawgeti(L, -1, ix);
+    scan_elem(s, L);
+    lua_pop(L, 1);
+}
 
-static To* seq_advance( Casl* self )
+// mirrors compile_table, for the stage or sequence on top of the stack
+static void scan_table( Scan* s, lua_State* L )
 {
-    Sequence* s = self->seq_current;
-    To* t = NULL;
-    if( s->pc < s->length ){ // stages remain
-        t = s->stage[s->pc]; // get next stage
-        s->pc++; // select following stage
+    if( !s->ok ){ return; }
+    int t = lua_rawgeti(L, -1, 1);
+    lua_pop(L, 1);
+    switch( t ){
+        case LUA_TSTRING:{
+            char c = scan_char(L, 1);
+            hash_byte(s, c);
+            switch( c ){
+                case 'T': scan_arg(s, L, 2); scan_arg(s, L, 3); scan_arg(s, L, 4); break;
+                case 'V':
+                    scan_arg(s, L, 2);
+                    scan_arg(s, L, 3);
+                    hash_int(s, scan_wave(L, 4)); // wave is compiled into the op
+                    break;
+                case 'I': scan_arg(s, L, 2); break;
+                default: break; // no operands
+            }
+            break;}
+        case LUA_TTABLE:{
+            int len = lua_rawlen(L, -1);
+            hash_byte(s, '[');
+            hash_int(s, len);
+            for( int i=1; i<=len; i++ ){
+                lua_rawgeti(L, -1, i);
+                scan_table(s, L);
+                lua_pop(L, 1);
+            }
+            hash_byte(s, ']');
+            break;}
+        default: s->ok = false; break;
     }
-    return t;
 }
 
-// return true if there is an upval
-static bool seq_up( Casl* self )
+static void scan_description( Casl* self, lua_State* L, Scan* s )
 {
-    if( self->seq_current->parent < 0 ){ return false; } // nothing left to do
+    s->hash  = 2166136261u;
+    s->count = 0;
+    s->ok    = true;
+    // mutables are allocated after lua's dynamics, so their indices depend on the count
+    hash_int(s, self->blocks[POOL_Dyn].count);
+    scan_table(s, L);
+    hash_int(s, s->count);
+    if( s->hash <= HASH_VOLTS ){ s->hash += HASH_VOLTS + 1; } // reserved values
+}
 
-    self->seq_current->pc = 0; // RESET PC so it runs more than once
-    // TODO this will prob change when it comes to nesting conditionals?
-    // TODO or at least when it comes to behavioural data
+// returns false if the mutables can't be reallocated
+// true if prog's code holds exactly the literals of s
+static bool lits_match( Casl* self, Casl* prog, Scan* s )
+{
+    if( code_count(prog) == 0 ){ return false; }
+    int base = self->blocks[POOL_Dyn].count; // mutables are in s, but not in the code
+    int lit = 0;
+    for( int i=0; i<code_count(prog); i++ ){
+        Op* o = op_at(prog, i);
+        if( o->op == OP_Lit || o->op == OP_Data ){
+            if( lit >= s->count
+             || memcmp(&o->lit, &s->lits[lit], sizeof(ElemO)) ){ return false; }
+            lit++;
+        } else if( o->op == OP_Mut && o->arg >= base ){
+            lit++;
+        }
+    }
+    return lit == s->count;
+}
 
-    self->seq_select = self->seq_current->parent;
-    self->seq_current = &self->seqs[self->seq_select];
+// a channel owning its code, running a program identical to s
+static Casl* find_program( Casl* self, Scan* s )
+{
+    for( int i=0; i<selves_count; i++ ){
+        Casl* o = _selves[i];
+        if( o == self || o->program != i || o->hash != s->hash ){ continue; }
+        if( lits_match(self, o, s) ){ return o; }
+    }
+    return NULL;
+}
+
+// run owner's code on self. sequins & mutables get their own state
+static bool share_program( Casl* self, Casl* owner, Scan* s )
+{
+    int seqs = owner->blocks[POOL_Seq].count;
+    if( seqs && pool_alloc(self, POOL_Seq, seqs) < 0 ){ return false; }
+    for( int i=0; i<seqs; i++ ){
+        *seqn_at(self, i) = *seqn_at(owner, i); // sequins_reset() restarts them
+    }
+    self->program = owner->index;
+    if( !patch_program(self, s, false) ){
+        clear_program(self);
+        return false;
+    }
+    self->hash = s->hash;
     return true;
 }
 
-static void seq_down( Casl* self, int s_ix )
+// write the literals of s into the code (if write), and reset per-channel state
+static bool patch_program( Casl* self, Scan* s, bool write )
 {
-    self->seq_select = s_ix;
-    self->seq_current = &self->seqs[self->seq_select];
+    if( code_count(self) == 0 ){ return false; }
+
+    // mutables were released with the dynamics. reallocate them in the same slots
+    int base = self->blocks[POOL_Dyn].count;
+    int muts = 0;
+    for( int i=0; i<code_count(self); i++ ){
+        Op* o = op_at(self, i);
+        if( o->op == OP_Mut && o->arg >= base ){ muts++; }
+    }
+    if( muts && pool_alloc(self, POOL_Dyn, muts) < 0 ){ return false; }
+
+    BLOCK_IRQS(
+        int lit = 0;
+        for( int i=0; i<code_count(self) && lit<s->count; i++ ){
+            Op* o = op_at(self, i);
+            if( o->op == OP_Lit || o->op == OP_Data ){
+                if( write ){
+                    if( o->arg == LIT_Shape ){ // the structure matched, so this is a curve too
+                        curve_retain( s->lits[lit].shape );
+                        curve_release( o->lit.shape );
+                    }
+                    o->lit = s->lits[lit];
+                }
+                lit++;
+            } else if( o->op == OP_Seq ){ // restart, holding the first value
+                sequins_reset( seqn_at(self, o->arg), s->lits[lit] );
+            } else if( o->op == OP_Mut && o->arg >= base ){
+                Elem* d = dyn_at(self, o->arg);
+                d->obj  = s->lits[lit++];
+                d->type = ElemT_Float;
+            }
+        }
+        self->pc = 0;
+        self->osc = -1;
+    );
+    return true;
+}
+
+
+///////////////////////////////
+// Runtime
+
+// port of S.next from lua/sequins.lua, for literal values
+// where lua would return 'skip' or 'dead', the previous value is held
+static ElemO sequins_next( Sequins* q, Op* values )
+{
+    if( q->every.n ){
+        q->every.ix++;
+        if( (q->every.ix % q->every.n) != 0 ){ return q->last; } // skip
+    }
+    if( q->times.n ){
+        q->times.ix++;
+        if( q->times.ix > q->times.n ){ return q->last; } // dead
+    }
+    if( q->count.n ){
+        q->count.ix++;
+        if( q->count.ix < q->count.n ){ // 'again'. only affects a parent sequins
+            if( q->every.n ){ q->every.ix--; } // undo every advance
+        } else { q->count.ix = 0; }
+    }
+    if( q->ix < 0 ){ q->ix = 0; } // first step selects the first value
+    else {
+        q->ix = (q->ix + q->step) % q->length;
+        if( q->ix < 0 ){ q->ix += q->length; } // negative steps
+    }
+    q->last = values[q->ix].lit;
+    return q->last;
+}
+
+// xorshift32. cheap enough to run per stage in the DSP
+static float rand_float( void ) // [0, 1)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return (float)(rand_state >> 8) * (1.0/16777216.0);
+}
+
+// box-muller, discarding the second value
+// sqrtf is a single FPU instruction. log & cos use the fastmath approximations
+static float rand_gauss( void )
+{
+    float u1 = 1.0 - rand_float(); // (0, 1] so the log is finite
+    float u2 = rand_float();
+    return sqrtf(-1.3862944 * fast_log2f(u1)) * fast_cosf(6.2831853 * u2); // -2ln(u1) == -2ln(2)log2(u1)
+}
+
+// runs expression ops from pc, leaving their results in stack[]
+// returns the index of the control op that consumes them, or code_count
+// if the program ends first (eg. it was cleared under a running channel)
+static int eval( Casl* self, int pc, ElemO* stack )
+{
+    int dyns  = self->blocks[POOL_Dyn].count; // guards a program outliving casl_cleardynamics
+    int count = code_count(self);
+    int sp = 0;
+    while( pc < count ){
+        Op* o = op_at(self, pc);
+        switch( o->op ){
+            case OP_Lit: stack[sp++] = o->lit; break;
+            case OP_Dyn:
+            case OP_Mut:
+                stack[sp++] = (o->arg < dyns) ? dyn_at(self, o->arg)->obj
+                                              : (ElemO){ .f = 0.0 };
+                break;
+            case OP_Store:
+                if( o->arg < dyns ){ dyn_at(self, o->arg)->obj = stack[sp-1]; }
+                break;
+            case OP_Seq:{
+                Sequins* q = seqn_at(self, o->arg);
+                stack[sp++] = sequins_next(q, o + 1); // values are contiguous in the pool
+                pc += q->length; // skip the values
+                break;}
+            case OP_Negate: stack[sp-1].f = -stack[sp-1].f; break;
+            case OP_Add: sp--; stack[sp-1].f += stack[sp].f; break;
+            case OP_Sub: sp--; stack[sp-1].f -= stack[sp].f; break;
+            case OP_Mul: sp--; stack[sp-1].f *= stack[sp].f; break;
+            case OP_Div: sp--; stack[sp-1].f /= stack[sp].f; break;
+            case OP_Mod:{
+                // this is just fmodf(val, wrap), but we need to handle negative numerators
+                // FIXME negative values shoud wrap to 'wrap' value
+                sp--;
+                float val  = stack[sp-1].f; // -0.001
+                float wrap = stack[sp].f; // 0.1
+                float mul = floorf(val/wrap); // -0.01 -> -1
+                stack[sp-1].f = val - (wrap * mul); // -0.001 - (0.1 * -1) => 0.099
+                break;}
+            case OP_Rand:
+                sp--;
+                stack[sp-1].f += (stack[sp].f - stack[sp-1].f) * rand_float();
+                break;
+            case OP_Gauss:
+                sp--;
+                stack[sp-1].f += stack[sp].f * rand_gauss();
+                break;
+            default: return pc; // control op. the compiler always emits one after an expression
+        }
+        pc++;
+    }
+    return count;
 }
 
 static void next_action( int index );
-static bool find_control( Casl* self, ToControl ctrl, bool full_search );
-static ElemO resolve( Casl* self, Elem* e );
+static bool find_unheld( Casl* self );
+static void apply_action( int index, int action );
 
 void casl_action( int index, int action )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return; }
+    if(index < 0 || index >= selves_count){ return; }
+
+    // routes call this from the DSP. blocking it stops an action from the main loop
+    // & one from the ISR stepping the same program at once. nests inside the ISR
+    BLOCK_IRQS( apply_action(index, action); );
+}
+
+static void apply_action( int index, int action )
+{
     Casl* self = _selves[index];
 
+    if( self->busy || code_count(self) == 0 ){ return; } // no program
+
     if( self->locked ){ // can't apply action until unlocked
         if( action == 2 ){ self->locked = false; } // 'unlock' message received
         return; // doesn't trigger action
     }
     if( action == 1){ // restart sequence
-        self->seq_current = &self->seqs[0]; // first sequence
-        for(int i=0; i<SEQ_COUNT; i++){ self->seqs[i].pc = 0; } // reset all program counters
+        self->pc = 0;
         self->holding = false;
         self->locked = false;
     } else if( action == 0 && self->holding ){ // goto release if held
-        if( find_control(self, ToUnheld, false) ){
+        if( find_unheld(self) ){
             self->holding = false;
         } else {
             printf("couldn't find ToWait. restarting\n");
-            casl_action(index, 1);
+            apply_action(index, 1);
             return;
         }
     } else {
@@ -361,113 +1162,80 @@ void casl_action( int index, int action )
 
 static void next_action( int index )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return; }
+    if(index < 0 || index >= selves_count){ return; }
     Casl* self = _selves[index];
 
-    while(true){ // repeat until halt
-        To* t = seq_advance(self);
-        if(t){ // To is valid
-            switch(t->ctrl){
-                case ToLiteral:{
-                    float ms = resolve(self, &t->b).f * 1000.0;
-                    S_toward( index
-                            , resolve(self, &t->a).f
-                            , ms
-                            , resolve(self, &t->c).shape
-                            , &next_action // recur upon breakpoint
-                            );
-                    if(ms > 0.0){ return; } // wait for DSP callback before proceeding
-                    break;}
+    if( self->busy ){ return; } // program is being rewritten. halt until the next action
 
-                case ToIf:{
-                    if( resolve(self, &t->a).f <= 0.0 ){ // pred is false
-                        goto stepup; // WARNING! ensuring only 1 path to asl_done event
-                    }
-                    break;}
+    self->osc = -1; // any running vco is replaced by the next stage
 
-                case ToRecur:{  self->seq_current->pc = 0;    break;}
-                case ToEnter:   seq_down(self, t->a.obj.seq); break;
-                case ToHeld:{   self->holding = true;         break;}
-                case ToWait:    /* halt execution */    return;
-                case ToUnheld:{ self->holding = false;        break;} // this is never executed, but here for reference
-                case ToLock:{   self->locked = true;          break;}
-                case ToOpen:{   self->locked = false;         break;}
-            }
-        } else {
-stepup:
-            if( !seq_up(self) ){ // To invalid. Jump up. return if nothing left to do
-                L_queue_asl_done(index); // trigger a lua event when sequence is complete
-                return;
-            }
+    ElemO v[EVAL_DEPTH];
+    int budget = OP_BUDGET;
+    while( self->pc < code_count(self) ){ // repeat until halt
+        if( budget <= 0 ){ // yield to the DSP, resuming at the next sample
+            S_toward( index, S_get_state(index), YIELD_MS, SHAPE_Linear, &next_action );
+            return;
+        }
+        int stage = self->pc;
+        int pc = eval(self, stage, v);
+        if( pc >= code_count(self) ){ break; } // expression without a control op
+        budget -= pc - stage + 1;
+        Op* o = op_at(self, pc);
+        self->pc = pc + 1;
+        switch( o->op ){
+            case OP_To:{
+                float ms = v[1].f * 1000.0;
+                S_toward( index
+                        , v[0].f
+                        , ms
+                        , v[2].shape
+                        , &next_action // recur upon breakpoint
+                        );
+                if(ms > 0.0){ return; } // wait for DSP callback before proceeding
+                break;}
+
+            case OP_If:{
+                if( v[0].f <= 0.0 ){ self->pc = o->arg; } // pred is false. skip rest of sequence
+                break;}
+
+            case OP_Recur:  self->pc = o->arg;     break;
+            case OP_Enter:  /* sequence is inline */ break;
+            case OP_Held:   self->holding = true;  break;
+            case OP_Wait:   /* halt execution */   return;
+            case OP_Unheld: self->holding = false; break; // this is never executed, but here for reference
+            case OP_Lock:   self->locked = true;   break;
+            case OP_Open:   self->locked = false;  break;
+            case OP_Osc:{
+                self->osc = stage;
+                S_oscillate( index
+                           , v[0].f
+                           , v[1].f
+                           , (Wave_t)o->arg
+                           );
+                return;} // runs in the DSP until the next action
+            default: break;
         }
     }
+    L_queue_asl_done(index); // trigger a lua event when sequence is complete
 }
 
-static bool find_control( Casl* self, ToControl ctrl, bool full_search )
+// moves pc past the next Unheld at this level, skipping nested sequences & If bodies
+static bool find_unheld( Casl* self )
 {
-    To* t = seq_advance(self);
-    if(t){ // To is valid
-        if(t->ctrl == ctrl){ return true; } // FOUND IT
-        switch(t->ctrl){ // else handle navigation
-            case ToEnter:
-                if(full_search){ seq_down(self, t->a.obj.seq); }
-                return find_control(self, ctrl, full_search);
-            case ToIf:
-                if( !full_search ){ seq_up(self); } // skip If contents
-                // FALLS THROUGH
-            default:
-                return find_control(self, ctrl, full_search);
+    int pc = self->pc;
+    while( pc < code_count(self) ){
+        Op* o = op_at(self, pc);
+        switch( o->op ){
+            case OP_Unheld: self->pc = pc + 1; return true; // FOUND IT
+            case OP_Enter: // jump over the nested sequence
+            case OP_If:    // or the rest of the If's sequence
+                pc = o->arg; break;
+            default: pc++; break;
         }
-    } else if( seq_up(self) ){ // end of list. Jump up the retstk
-        return find_control(self, ctrl, full_search); // recur
     }
     return false;
 }
 
-// resolves behavioural types to a literal value
-static volatile uint16_t resolving_mutable; // tmp global var for cheaper recursive fn
-#define RESOLVE_VAR(self, e, n) _resolve(self, &self->dynamics[e->obj.var[n]] ).f
-static ElemO _resolve( Casl* self, Elem* e )
-{
-    switch( e->type ){
-        case ElemT_Dynamic: return _resolve(self, &self->dynamics[e->obj.dyn] );
-        case ElemT_Mutable:{
-            resolving_mutable = e->obj.var[0];
-            return _resolve(self, &self->dynamics[e->obj.var[0]] );}
-        case ElemT_Negate: return (ElemO){-RESOLVE_VAR(self,e,0)};
-        case ElemT_Add: return (ElemO){RESOLVE_VAR(self,e,0) + RESOLVE_VAR(self,e,1)};
-        case ElemT_Sub: return (ElemO){RESOLVE_VAR(self,e,0) - RESOLVE_VAR(self,e,1)};
-        case ElemT_Mul: return (ElemO){RESOLVE_VAR(self,e,0) * RESOLVE_VAR(self,e,1)};
-        case ElemT_Div: return (ElemO){RESOLVE_VAR(self,e,0) / RESOLVE_VAR(self,e,1)};
-        case ElemT_Mod:{
-            // this is just fmodf(val, wrap), but we need to handle negative numerators
-            // FIXME negative values shoud wrap to 'wrap' value
-            float val  = RESOLVE_VAR(self,e,0); // -0.001
-            float wrap = RESOLVE_VAR(self,e,1); // 0.1
-            float mul = floorf(val/wrap); // -0.01 -> -1
-            return (ElemO){val - (wrap * mul)};} // -0.001 - (0.1 * -1) => 0.099
-        case ElemT_Mutate:{
-            ElemO mutated = (ElemO){RESOLVE_VAR(self,e,0)};
-            if(resolving_mutable < DYN_COUNT){
-                self->dynamics[resolving_mutable].obj = mutated; // update value
-                resolving_mutable = DYN_COUNT; // mutation resolved!
-            }
-            return mutated;} // return the resultant value
-        default: return e->obj;
-    }
-}
-#undef RESOLVE_VAR
-
-// wrap _resolve with mutable resolution
-static ElemO resolve( Casl* self, Elem* e )
-{
-    resolving_mutable = DYN_COUNT; // out of range
-    ElemO eo = _resolve(self, e);
-    if(resolving_mutable < DYN_COUNT){
-        self->dynamics[resolving_mutable].obj = eo; // update value
-    }
-    return eo;
-}
 
 ////////////////////////////////////
 // Dynamic Variables
@@ -475,49 +1243,107 @@ static ElemO resolve( Casl* self, Elem* e )
 
 int casl_defdynamic( int index )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return -1; }
+    if(index < 0 || index >= selves_count){ return -1; }
     return casl_defdynamicP(_selves[index]);
 }
 
 int casl_defdynamicP( Casl* self )
 {
-    if(self->dyn_ix >= DYN_COUNT){
+    int ix = pool_alloc(self, POOL_Dyn, 1);
+    if(ix < 0){
         printf("ERROR: no dynamic slots remain\n");
         Caw_printf("ERROR: no dynamic slots remain\n");
-        return -1;
     }
-    int ix = self->dyn_ix; self->dyn_ix++;
     return ix;
 }
 
 void casl_cleardynamics( int index )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return; }
+    if(index < 0 || index >= selves_count){ return; }
     Casl* self = _selves[index];
 
-    self->dyn_ix = 0;
+    self->osc = -1; // dynamics are being reallocated. stop retuning the old vco
+    pool_release(self, POOL_Dyn);
+}
+
+static void dyn_write( Casl* self, int dynamic_ix, float val )
+{
+    if(dynamic_ix < 0 || dynamic_ix >= self->blocks[POOL_Dyn].count){ return; }
+
+    Elem* d = dyn_at(self, dynamic_ix);
+    d->obj.f = val;
+    d->type  = ElemT_Float; // FIXME support other types
+}
+
+static void osc_retune( int index, Casl* self )
+{
+    if( self->osc >= 0 && !self->busy ){ // retune the running vco without restarting its phase
+        ElemO v[EVAL_DEPTH];
+        int pc = eval(self, self->osc, v);
+        if( pc >= code_count(self) ){ return; }
+        S_oscillate( index
+                   , v[0].f
+                   , v[1].f
+                   , (Wave_t)op_at(self, pc)->arg
+                   );
+    }
 }
 
 void casl_setdynamic( int index, int dynamic_ix, float val )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return; }
+    if(index < 0 || index >= selves_count){ return; }
+    Casl* self = _selves[index];
+
+    BLOCK_IRQS( // retune can't interleave with a stage resolving in the DSP
+        dyn_write(self, dynamic_ix, val);
+        osc_retune(index, self);
+    );
+}
+
+bool casl_setdynamics( int index, const int* dynamic_ixs, const float* vals, int count )
+{
+    if(index < 0 || index >= selves_count){ return false; }
     Casl* self = _selves[index];
 
-    self->dynamics[dynamic_ix].obj.f = val;
-    self->dynamics[dynamic_ix].type  = ElemT_Float; // FIXME support other types
+    for( int i=0; i<count; i++ ){ // dynamics are only reallocated from the main loop
+        if(dynamic_ixs[i] < 0 || dynamic_ixs[i] >= self->blocks[POOL_Dyn].count){ return false; }
+    }
+    // the DSP resolves stages between blocks, so blocking it makes the batch atomic
+    BLOCK_IRQS(
+        for( int i=0; i<count; i++ ){
+            dyn_write(self, dynamic_ixs[i], vals[i]);
+        }
+        osc_retune(index, self); // once for the whole batch
+    );
+    return true;
 }
 
 float casl_getdynamic( int index, int dynamic_ix )
 {
-    if(index < 0 || index >= SELVES_COUNT){ return 0.0; }
+    if(index < 0 || index >= selves_count){ return 0.0; }
     Casl* self = _selves[index];
 
-    switch(self->dynamics[dynamic_ix].type){
+    if(dynamic_ix < 0 || dynamic_ix >= self->blocks[POOL_Dyn].count){ return 0.0; }
+
+    Elem* d = dyn_at(self, dynamic_ix);
+    switch(d->type){
         case ElemT_Float:
-            return self->dynamics[dynamic_ix].obj.f;
+            return d->obj.f;
         default:
             printf("getdynamic! wrong type\n");
             Caw_printf("getdynamic! wrong type\n");
             return 0.0;
     }
 }
+
+////////////////////////////////////
+// Random
+
+void casl_seed( uint32_t seed )
+{
+    // scramble so small seeds don't start with a run of small values
+    seed ^= seed >> 16; seed *= 0x85EBCA6B;
+    seed ^= seed >> 13; seed *= 0xC2B2AE35;
+    seed ^= seed >> 16;
+    rand_state = seed ? seed : 0x9E3779B9; // xorshift is stuck at 0
+}
@@ -9,42 +9,53 @@
 
 #include "slopes.h" // S_toward
 
-#define TO_COUNT   16   // 28bytes
-#define SEQ_COUNT  8    // 16bytes
-#define SEQ_LENGTH 8    // 4bytes
+// average budget per channel. memory is pooled across all channels
+// so a complex ASL can borrow space that simple ones aren't using
+#define CODE_COUNT 80   // 8bytes. to(v,t,s) with literal args is 4 ops
 #define DYN_COUNT  40   // 8bytes
-
-typedef enum{ ToLiteral
-            , ToRecur
-            , ToIf
-            , ToEnter
-            , ToHeld
-            , ToWait
-            , ToUnheld
-            , ToLock
-            , ToOpen
-} ToControl;
+#define SEQ_COUNT  4    // 20bytes. values are stored inline in the code
+
+#define EVAL_DEPTH 8    // max values on the expression stack
+
+// descriptions compile to a flat stack-machine program
+// expression ops push values, which are consumed by the following control op
+// nested sequences are laid out inline, so control flow is just jumps
+typedef enum{ OP_Lit     // push lit. arg is LIT_Shape if lit may be a user curve
+            , OP_Dyn     // push dynamic[arg]
+            , OP_Mut     // push dynamic[arg]. the compiler emits its write-back
+            , OP_Store   // dynamic[arg] = top (no pop)
+            , OP_Negate
+            , OP_Add
+            , OP_Sub
+            , OP_Mul
+            , OP_Div
+            , OP_Mod
+            , OP_Rand    // (lo, hi) uniform in [lo, hi)
+            , OP_Gauss   // (mean, dev) normal distribution
+            , OP_Seq     // push the next value of sequins[arg]. followed by its values
+            , OP_Data    // a sequins value in lit. never executed
+        // control ops. each consumes the whole expression stack
+            , OP_To      // (volts, time, shape)
+            , OP_Osc     // (freq, level). arg is the Wave_t
+            , OP_If      // (pred). if false jump to arg: end of enclosing sequence
+            , OP_Recur   // jump to arg: start of enclosing sequence
+            , OP_Enter   // no-op. arg is the end of the nested sequence
+            , OP_Held
+            , OP_Wait
+            , OP_Unheld
+            , OP_Lock
+            , OP_Open
+} Opcode;
+
+#define LIT_Shape 1 // OP_Lit arg. the code holds a reference to the curve in lit.shape
 
 typedef union{
     float   f;
-    int     dyn; // index into the dynamics array
-    uint16_t var[2]; // 2 indexes into dynamic table
-    int     seq; // reference to a Sequence object
     Shape_t shape;
 } ElemO; // 4bytes
 
 typedef enum{ ElemT_Float
             , ElemT_Shape
-            , ElemT_Dynamic
-            , ElemT_Mutable
-        // arithmetic ops
-            , ElemT_Negate
-            , ElemT_Add
-            , ElemT_Sub
-            , ElemT_Mul
-            , ElemT_Div
-            , ElemT_Mod
-            , ElemT_Mutate
 } ElemT;
 
 typedef struct{
@@ -53,42 +64,82 @@ typedef struct{
 } Elem; // 8bytes
 
 typedef struct{
-    Elem a;
-    Elem b;
-    Elem c;
-    ToControl ctrl;
-} To; // 28bytes
+    uint8_t op;  // Opcode
+    int16_t arg; // jump target, dynamic index, sequins index or wave
+    ElemO   lit;
+} Op; // 8bytes
 
 typedef struct{
-    To* stage[SEQ_LENGTH];
-    int length;
-    int pc;
-    int parent; // seq_ix, like a tree 'parent' link
-} Sequence;
+    int16_t n;  // 0 if unused
+    int16_t ix;
+} Flow;
 
-// TODO rename 'dynamics' to 'elements' and use it as a general abstraction (eg with To*)
+// a sequins of literal values, stepped in the DSP. mirrors lua/sequins.lua
 typedef struct{
-    To tos[TO_COUNT];
-    int to_ix;
+    int16_t length;
+    int16_t ix;   // current value. -1 before the first step
+    int16_t step;
+    Flow    every;
+    Flow    times;
+    Flow    count;
+    ElemO   last; // held while skipping, or after times is exhausted
+} Sequins; // 20bytes
+
+typedef enum{ POOL_Code
+            , POOL_Seq
+            , POOL_Dyn
+            , POOL_COUNT
+} PoolType;
 
-    Sequence* seq_current;
-    Sequence seqs[SEQ_COUNT];
-    int seq_ix;
-    int seq_select;
+typedef struct{
+    int base;  // first element in the pool
+    int count; // elements owned
+} Block;
+
+// program memory lives in the shared pools. code addresses are relative
+// to the channel's Block, so the pools can be compacted under a running program
+// code is immutable once compiled, so channels describing the same program run
+// one copy. sequins, mutables & dynamics stay in each channel's own blocks
+typedef struct{
+    Block blocks[POOL_COUNT];
+    int   index;   // this channel
+    int   program; // channel whose code is run. == index unless sharing
 
-    Elem dynamics[DYN_COUNT];
-    int dyn_ix;
+    int      pc;   // next op to execute
+    uint32_t hash; // structure of the compiled description, for the describe cache. 0 if none
 
     bool holding;
     bool locked;
+    volatile bool busy; // main loop is rewriting the program. routes mustn't start it
+    int  osc; // first op of the running vco stage, or -1. re-resolved when a dynamic changes
+
+    // defaults for casl_volts
+    float   slew;
+    Shape_t shape;
 } Casl;
 
-Casl* casl_init( int index );
+void casl_init( int channels );
 void casl_describe( int index, lua_State* L );
 void casl_action( int index, int action );
 
+// direct voltage update. equivalent to describing & calling to(volts,slew,shape)
+void casl_volts( int index, float volts );
+void casl_setslew( int index, float slew );
+float casl_getslew( int index );
+void casl_setshape( int index, Shape_t shape );
+
+// pool usage. index < 0 gives the total across all channels
+int casl_usage( int index, PoolType pool );
+int casl_capacity( PoolType pool );
+
 // dynamic vars
 int casl_defdynamic( int index );
 void casl_cleardynamics( int index );
 void casl_setdynamic( int index, int dynamic_ix, float val );
+// writes count values at once, so the DSP never sees a partial update
+// returns false & writes nothing if any index is out of range
+bool casl_setdynamics( int index, const int* dynamic_ixs, const float* vals, int count );
 float casl_getdynamic( int index, int dynamic_ix );
+
+// seed the random operators. the same seed gives the same sequence of values
+void casl_seed( uint32_t seed );
@@ -7,6 +7,8 @@
 #include "lualink.h"
 #include <stm32f7xx_hal.h> // HAL_GetTick
 #include "clock_ll.h" // linked list for clocks
+#include "io.h" // IO_GetTime
+#include "slopes.h" // SAMPLE_RATE
 
 
 ///////////////////////////////
@@ -257,7 +259,7 @@ static void clock_internal_run(uint32_t ms)
 
 static bool clock_crow_last_time_set;
 static int clock_crow_counter;
-static double clock_crow_last_time;
+static uint32_t clock_crow_last_time; // in samples
 
 #define DURATION_BUFFER_LENGTH 4
 
@@ -278,21 +280,21 @@ void clock_crow_init(void)
 }
 
 // called by an event received on input
-void clock_input_handler( int id, float freq )
+void clock_input_handler( int id, float freq, int offset )
 {
-    // this stub function just ignores the args
-    clock_crow_handle_clock();
+    // sample clock rather than HAL_GetTick, for sub-ms edge timing
+    clock_crow_handle_clock( IO_GetTime() + offset );
 }
-void clock_crow_handle_clock(void)
+void clock_crow_handle_clock( uint32_t current_time )
 {
     float beat_duration;
-    double current_time = clock_get_time_seconds();
 
     if( clock_crow_last_time_set == false ){
         clock_crow_last_time_set = true;
         clock_crow_last_time = current_time;
     } else {
-        beat_duration = (float)(current_time - clock_crow_last_time)
+        beat_duration = (float)(current_time - clock_crow_last_time) // wraps safely
+                            * iSAMPLE_RATE
                             * crow_in_div;
         if( beat_duration > 4.0 ){ // assume clock stopped
             clock_crow_last_time = current_time;
@@ -47,6 +47,6 @@ void clock_internal_stop(void);
 
 // TODO add arg to choose input channel
 void clock_crow_init(void);
-void clock_input_handler( int id, float freq ); // Called from Detect lib
-void clock_crow_handle_clock(void);
+void clock_input_handler( int id, float freq, int offset ); // Called from Detect lib
+void clock_crow_handle_clock( uint32_t time ); // capture time of the clock edge. see IO_GetTime()
 void clock_crow_in_div( float div );
@@ -1,6 +1,7 @@
 #include "detect.h"
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <math.h>
 #include <stdio.h>
 
@@ -10,18 +11,19 @@ Detect_t*  selves = NULL;
 
 // helpers
 static void scale_bounds( Detect_t* self, int ix, int oct );
+static void window_bounds( D_window_t* w );
 
 ////////////////////////////////////////////////
 // signal processor declarations
 
-static void d_none( Detect_t* self, float level );
-static void d_stream( Detect_t* self, float level );
-static void d_change( Detect_t* self, float level );
-static void d_window( Detect_t* self, float level );
-static void d_scale( Detect_t* self, float level );
-static void d_volume( Detect_t* self, float level );
-static void d_peak( Detect_t* self, float level );
-static void d_freq( Detect_t* self, float level );
+static void d_none( Detect_t* self, float* in, int size );
+static void d_stream( Detect_t* self, float* in, int size );
+static void d_change( Detect_t* self, float* in, int size );
+static void d_window( Detect_t* self, float* in, int size );
+static void d_scale( Detect_t* self, float* in, int size );
+static void d_volume( Detect_t* self, float* in, int size );
+static void d_peak( Detect_t* self, float* in, int size );
+static void d_freq( Detect_t* self, float* in, int size );
 
 
 ///////////////////////////////////////////
@@ -30,15 +32,19 @@ static void d_freq( Detect_t* self, float level );
 void Detect_init( int channels )
 {
     channel_count = channels;
-    selves = malloc( sizeof ( Detect_t ) * channels );
-    for( int j=0; j<channels; j++ ){
-        selves[j].channel = j;
+    // each channel's chain is contiguous
+    selves = malloc( sizeof ( Detect_t ) * channels * DETECT_CHAIN );
+    for( int j=0; j<channels * DETECT_CHAIN; j++ ){
+        selves[j].channel = j / DETECT_CHAIN;
         selves[j].action  = NULL;
         selves[j].last    = 0.0;
         selves[j].state   = 0;
         Detect_none( &(selves[j]) );
         selves[j].win.lastWin = 0;
+        selves[j].win.wLen    = 0;
+        window_bounds( &selves[j].win );
         selves[j].vu = VU_init();
+        FTrack_init( &selves[j].ftrack );
     }
 }
 
@@ -52,9 +58,25 @@ void Detect_deinit( void )
 // global helpers
 
 Detect_t* Detect_ix_to_p( uint8_t index )
+{
+    return Detect_chain_to_p( index, 0 );
+}
+
+Detect_t* Detect_chain_to_p( uint8_t index, uint8_t slot )
 {
     if( index < 0 || index >= channel_count ){ return NULL; } // TODO error msg
-    return &(selves[index]);
+    if( slot >= DETECT_CHAIN ){ return NULL; }
+    return &(selves[index * DETECT_CHAIN + slot]);
+}
+
+// for event handlers that read a detector's state
+Detect_t* Detect_find_action( uint8_t index, Detect_callback_t cb )
+{
+    for( int i=0; i<DETECT_CHAIN; i++ ){
+        Detect_t* d = Detect_chain_to_p( index, i );
+        if( d && d->modefn != d_none && d->action == cb ){ return d; }
+    }
+    return NULL;
 }
 
 int8_t Detect_str_to_dir( const char* str )
@@ -68,14 +90,8 @@ int8_t Detect_str_to_dir( const char* str )
 //////////////////////////////////////////
 // mode configuration
 
-static void clear_ch_one( void )
-{
-    FTrack_stop();
-}
-
 void Detect_none( Detect_t* self )
 {
-    if( self->channel == 0 ){ clear_ch_one(); }
     self->modefn = d_none;
 }
 
@@ -84,7 +100,6 @@ void Detect_stream( Detect_t*         self
                   , float             interval
                   )
 {
-    if( self->channel == 0 ){ clear_ch_one(); }
     self->modefn         = d_stream;
     self->action         = cb;
     // SAMPLE_RATE * i / BLOCK_SIZE
@@ -100,7 +115,6 @@ void Detect_change( Detect_t*         self
                   , int8_t            direction
                   )
 {
-    if( self->channel == 0 ){ clear_ch_one(); }
     self->modefn            = d_change;
     self->action            = cb;
     self->change.threshold  = threshold;
@@ -131,7 +145,6 @@ void Detect_scale( Detect_t*         self
                  , float             scaling
                  )
 {
-    if( self->channel == 0 ){ clear_ch_one(); }
     self->modefn = d_scale;
     self->action = cb;
 
@@ -169,15 +182,63 @@ void Detect_window( Detect_t*         self
                   , float             hysteresis
                   )
 {
-    if( self->channel == 0 ){ clear_ch_one(); }
-    printf("TODO need to sort the windows!\n");
-    self->modefn         = d_window;
-    self->action         = cb;
-    self->win.wLen       = (wLen > WINDOW_MAX_COUNT) ? WINDOW_MAX_COUNT : wLen;
-    self->win.hysteresis = hysteresis;
-    for( int i=0; i<self->win.wLen; i++ ){
-        self->win.windows[i] = *windows++;
+    D_window_t* w = &self->win; // readability
+
+    w->wLen       = (wLen > WINDOW_MAX_COUNT) ? WINDOW_MAX_COUNT : wLen;
+    w->hysteresis = hysteresis;
+    for( int i=0; i<w->wLen; i++ ){ // insertion sort. lists are short & usually sorted already
+        float v = *windows++;
+        int j = i;
+        for(; j>0 && w->windows[j-1] > v; j-- ){
+            w->windows[j] = w->windows[j-1];
+        }
+        w->windows[j] = v;
+    }
+    w->lastWin = 0; // unknown, so the first sample reports its window
+    window_bounds( w );
+
+    self->action = cb;
+    self->modefn = d_window; // set last, as the DSP may be running
+}
+
+// bounds of lastWin with hysteresis. the next window is only entered once
+// the input is past the boundary by the hysteresis amount
+static void window_bounds( D_window_t* w )
+{
+    if( w->lastWin == 0 ){ // unknown. force a search
+        w->lower = INFINITY;
+        w->upper = -INFINITY;
+        return;
     }
+    int ix = w->lastWin - 1; // 1-based
+    w->lower = (ix == 0)       ? -INFINITY : w->windows[ix-1] - w->hysteresis;
+    w->upper = (ix == w->wLen) ?  INFINITY : w->windows[ix] + w->hysteresis;
+}
+
+static bool in_window( D_window_t* w, int win, float level )
+{
+    int ix = win - 1; // 1-based
+    if( ix < 0 || ix > w->wLen ){ return false; }
+    return (ix == 0       || level >= w->windows[ix-1])
+        && (ix == w->wLen || level <  w->windows[ix]);
+}
+
+// returns the 1-based window containing level
+static int window_find( D_window_t* w, float level )
+{
+    // inputs mostly move to a neighbour
+    if( in_window( w, w->lastWin + 1, level ) ){ return w->lastWin + 1; }
+    if( in_window( w, w->lastWin - 1, level ) ){ return w->lastWin - 1; }
+
+    // otherwise bisect for the first window above level
+    int lo = 0;
+    int hi = w->wLen;
+    while( lo < hi ){
+        int mid = (lo + hi) >> 1;
+        if( level < w->windows[mid] ){ hi = mid; }
+        else { lo = mid + 1; }
+    }
+    return lo + 1;
 }
 
 void Detect_volume( Detect_t*         self
@@ -185,7 +246,6 @@ void Detect_volume( Detect_t*         self
                   , float             interval
                   )
 {
-    if( self->channel == 0 ){ clear_ch_one(); }
     self->modefn         = d_volume;
     self->action         = cb;
 
@@ -202,7 +262,6 @@ void Detect_peak( Detect_t*         self
                 , float             hysteresis
                 )
 {
-    if( self->channel == 0 ){ clear_ch_one(); }
     self->modefn            = d_peak;
     self->action            = cb;
     // TODO perhaps a abs->2lpf (no RMS averaging) is better?
@@ -217,122 +276,138 @@ void Detect_peak( Detect_t*         self
 void Detect_freq( Detect_t*         self
                 , Detect_callback_t cb
                 , float             interval
+                , float             hysteresis
                 )
 {
-    // only first chan supports freq tracking. otherwise ignore
-    if( self->channel == 0 ){
-        clear_ch_one(); 
-        self->modefn = d_freq;
-
-        // below is same as 'stream'
-        self->action = cb;
-        // SAMPLE_RATE * i / BLOCK_SIZE
-        self->stream.blocks  = (int)((48000.0 * interval) / 32.0);
-        if( self->stream.blocks <= 0 ){ self->stream.blocks = 1; }
-        self->stream.countdown = self->stream.blocks;
-
-        FTrack_init();
-        FTrack_start();
+    FTrack_set_hysteresis( &self->ftrack, hysteresis ); // also resets the tracker
+
+    // reporting is the same as 'stream'
+    self->action = cb;
+    // SAMPLE_RATE * i / BLOCK_SIZE
+    self->stream.blocks  = (int)((48000.0 * interval) / 32.0);
+    if( self->stream.blocks <= 0 ){ self->stream.blocks = 1; }
+    self->stream.countdown = self->stream.blocks;
+    self->modefn = d_freq;
+}
+
+//////////////////////////////////////////////
+// DSP
+
+void Detect_process( uint8_t index, float* in, int size )
+{
+    Detect_t* d = Detect_chain_to_p( index, 0 );
+    if( !d ){ return; }
+    for( int i=0; i<DETECT_CHAIN; i++, d++ ){
+        if( d->modefn != d_none ){ (*d->modefn)( d, in, size ); }
     }
 }
 
+
 //////////////////////////////////////////////
 // signal processors
-static void d_none( Detect_t* self, float level ){ return; }
+static void d_none( Detect_t* self, float* in, int size ){ return; }
 
-static void d_stream( Detect_t* self, float level )
+static void d_stream( Detect_t* self, float* in, int size )
 {
     if( --self->stream.countdown <= 0 ){
         self->stream.countdown = self->stream.blocks; // reset counter
         (*self->action)( self->channel
-                       , level
+                       , in[size-1]
+                       , size-1
                        ); // callback!
     }
 }
 
-static void d_change( Detect_t* self, float level )
+static void d_change( Detect_t* self, float* in, int size )
 {
-    if( self->state ){ // high to low
-        if( level < (self->change.threshold - self->change.hysteresis) ){
-            self->state = 0;
-            if( self->change.direction != 1 ){ // not 'rising' only
-                (*self->action)( self->channel, (float)self->state );
+    float upper = self->change.threshold + self->change.hysteresis;
+    float lower = self->change.threshold - self->change.hysteresis;
+    for( int i=0; i<size; i++ ){ // every sample, so short pulses aren't missed
+        if( self->state ){ // high to low
+            if( in[i] < lower ){
+                self->state = 0;
+                if( self->change.direction != 1 ){ // not 'rising' only
+                    (*self->action)( self->channel, (float)self->state, i );
+                }
             }
-        }
-    } else { // low to high
-        if( level > (self->change.threshold + self->change.hysteresis) ){
-            self->state = 1;
-            if( self->change.direction != -1 ){ // not 'falling' only
-                (*self->action)( self->channel, (float)self->state );
+        } else { // low to high
+            if( in[i] > upper ){
+                self->state = 1;
+                if( self->change.direction != -1 ){ // not 'falling' only
+                    (*self->action)( self->channel, (float)self->state, i );
+                }
             }
         }
     }
 }
 
-static void d_window( Detect_t* self, float level )
+static void d_window( Detect_t* self, float* in, int size )
 {
-    // search index containing 'level'
-    int ix = 0;
-        // TODO optimize: start from 'lastWin' rather than 0
-    for(; ix<self->win.wLen; ix++ ){
-        if( level < self->win.windows[ix] ){
-            break;
+    D_window_t* w = &self->win; // readability
+
+    for( int i=0; i<size; i++ ){
+        float level = in[i];
+        if( level >= w->lower && level < w->upper ){ continue; } // still inside
+
+        int ix = window_find( w, level );
+        int lW = w->lastWin;
+        if( ix != lW ){ // window has changed
+            (*self->action)( self->channel
+                           , (ix > lW) // sign of index determines direction
+                                ? ix
+                                : -ix
+                           , i
+                           ); // callback!
+            w->lastWin = ix; // save newly entered window
+            window_bounds( w );
         }
     }
-    ix++; // 1-base the index so it can be passed with sign
-    // compare the found win with 'lastWin'
-    int lW = self->win.lastWin;
-    if( ix != lW ){ // window has changed
-        (*self->action)( self->channel
-                       , (ix > lW) // sign of index determines direction
-                            ? ix
-                            : -ix
-                       ); // callback!
-        self->win.lastWin = ix; // save newly entered window
-    }
 }
 
-static void d_scale( Detect_t* self, float level )
+static void d_scale( Detect_t* self, float* in, int size )
 {
     D_scale_t* s = &self->scale; // readability
 
-    if( level > s->upper
-     || level < s->lower ){
-        // offset input to ensure we capture noisy notes at the divs
-        level += self->scale.offset;
-
-        // calculate index of input
-        float norm   = level / s->scaling;       // normalize scaling
-        s->lastOct   = (int)floorf(norm);        // # of folds around scaling
-        float phase  = norm - (float)s->lastOct; // position in win [0,1.0)
-        float fix    = phase * s->sLen;          // map phase to #scale
-        s->lastIndex = (int)floorf(fix);         // select octave at or beneath selection
-
-        // perform scale lookup & prepare outs
-        float note    = s->scale[s->lastIndex]; // lookup within octave
-        s->lastNote  = note + (float)s->lastOct * s->divs;
-        s->lastVolts = (note/s->divs + (float)s->lastOct) * s->scaling;
-
-        // call action
-        (*self->action)( self->channel, 0.0 ); // callback! 0.0 is ignored
-
-        // calculate new bounds
-        scale_bounds(self, s->lastIndex, s->lastOct);
+    for( int i=0; i<size; i++ ){
+        float level = in[i];
+        if( level > s->upper
+         || level < s->lower ){
+            // offset input to ensure we capture noisy notes at the divs
+            level += self->scale.offset;
+
+            // calculate index of input
+            float norm   = level / s->scaling;       // normalize scaling
+            s->lastOct   = (int)floorf(norm);        // # of folds around scaling
+            float phase  = norm - (float)s->lastOct; // position in win [0,1.0)
+            float fix    = phase * s->sLen;          // map phase to #scale
+            s->lastIndex = (int)floorf(fix);         // select octave at or beneath selection
+
+            // perform scale lookup & prepare outs
+            float note    = s->scale[s->lastIndex]; // lookup within octave
+            s->lastNote  = note + (float)s->lastOct * s->divs;
+            s->lastVolts = (note/s->divs + (float)s->lastOct) * s->scaling;
+
+            // call action
+            (*self->action)( self->channel, s->lastVolts, i ); // callback! the rest is read from s now
+
+            // calculate new bounds
+            scale_bounds(self, s->lastIndex, s->lastOct);
+        }
     }
 }
 
-static void d_volume( Detect_t* self, float level )
+static void d_volume( Detect_t* self, float* in, int size )
 {
-    level = VU_step( self->vu, level );
+    float level = VU_step( self->vu, in[size-1] );
     if( --self->volume.countdown <= 0 ){
         self->volume.countdown = self->volume.blocks; // reset counter
-        (*self->action)( self->channel, level ); // callback!
+        (*self->action)( self->channel, level, size-1 ); // callback!
     }
 }
 
-static void d_peak( Detect_t* self, float level )
+static void d_peak( Detect_t* self, float* in, int size )
 {
-    level = VU_step( self->vu, level );
+    float level = VU_step( self->vu, in[size-1] );
     if( level > self->last ){ // instant attack
         self->peak.envelope = level;
     } else { // release as 1lpf slew
@@ -347,18 +422,20 @@ static void d_peak( Detect_t* self, float level )
     } else { // low to high
         if( self->peak.envelope > (self->peak.threshold + self->peak.hysteresis) ){
             self->state = 1;
-            (*self->action)( self->channel, 0.0 ); // callback! 0.0 is ignored
+            (*self->action)( self->channel, 0.0, size-1 ); // callback! 0.0 is ignored
         }
     }
 }
 
-static void d_freq( Detect_t* self, float level )
+static void d_freq( Detect_t* self, float* in, int size )
 {
-    float f = FTrack_get(); // call every block
+    FTrack_process( &self->ftrack, in, size ); // every block
+    float f = FTrack_get( &self->ftrack );
     if( --self->stream.countdown <= 0 ){
         self->stream.countdown = self->stream.blocks; // reset counter
         (*self->action)( self->channel
                        , f
+                       , size-1
                        ); // callback!
     }
 }
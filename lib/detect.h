@@ -6,10 +6,12 @@
 #include "ftrack.h"
 
 #define SCALE_MAX_COUNT 16
-#define WINDOW_MAX_COUNT 16
+#define DETECT_CHAIN     4 // detectors per input, each with its own mode & callback
+#define WINDOW_MAX_COUNT 64
 
 typedef void (*Detect_void_callback_t)(uint8_t* data);
-typedef void (*Detect_callback_t)(int channel, float value);
+// offset is the sample index of the event within the current block
+typedef void (*Detect_callback_t)(int channel, float value, int offset);
 
 typedef struct{
     int blocks;
@@ -42,10 +44,13 @@ typedef struct{
 } D_scale_t;
 
 typedef struct{
-    float windows[WINDOW_MAX_COUNT];
+    float windows[WINDOW_MAX_COUNT]; // sorted ascending
     int   wLen;
     float hysteresis;
     int   lastWin;
+    // bounds of lastWin, widened by hysteresis
+    float lower;
+    float upper;
 } D_window_t;
 
 typedef struct{
@@ -62,7 +67,7 @@ typedef struct{
 
 typedef struct detect{
     uint8_t channel;
-    void (*modefn)(struct detect* self, float level);
+    void (*modefn)(struct detect* self, float* in, int size);
     Detect_callback_t action;
 
 // state memory
@@ -78,9 +83,12 @@ typedef struct detect{
     VU_meter_t* vu; // vu metering for amplitude dtection
     D_volume_t  volume;
     D_peak_t    peak;
+    FTrack_t    ftrack;
 } Detect_t;
 
-typedef void (*Detect_mode_fn_t)(Detect_t* self, float level);
+// mode fns receive the whole ADC block. edge & threshold modes scan every
+// sample, while metering modes only look at the latest
+typedef void (*Detect_mode_fn_t)(Detect_t* self, float* in, int size);
 
 
 ////////////////////////////////////
@@ -93,10 +101,18 @@ void Detect_deinit( void );
 ////////////////////////////////////
 // global functions
 
-Detect_t* Detect_ix_to_p( uint8_t index );
+Detect_t* Detect_ix_to_p( uint8_t index ); // first detector in the chain
+Detect_t* Detect_chain_to_p( uint8_t index, uint8_t slot );
+Detect_t* Detect_find_action( uint8_t index, Detect_callback_t cb ); // NULL if none
 int8_t Detect_str_to_dir( const char* str );
 
 
+/////////////////////////////////////
+// DSP. runs the input's whole chain over the block
+
+void Detect_process( uint8_t index, float* in, int size );
+
+
 /////////////////////////////////////
 // mode configuration
 
@@ -136,4 +152,5 @@ void Detect_peak( Detect_t*         self
 void Detect_freq( Detect_t*         self
                 , Detect_callback_t cb
                 , float             interval
+                , float             hysteresis
                 );
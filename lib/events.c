@@ -5,6 +5,7 @@
 #include "events.h"
 #include "lualink.h"
 #include "caw.h" // Caw_send_luachunk
+#include "io.h" // IO_GetTime
 
 
 /// NOTE: if we are ever over-filling the event queue, we have problems.
@@ -38,6 +39,7 @@ void events_clear(void)
     // zero out the event records
     for ( int k = 0; k < MAX_EVENTS; k++ ) {
         sysEvents[ k ].data.i  = 0;
+        sysEvents[ k ].time    = 0;
         sysEvents[ k ].handler = NULL;
     }
 }
@@ -62,6 +64,7 @@ void event_next( void ){
 // add event to queue, return success status
 uint8_t event_post( event_t *e ) {
     uint8_t status = 0;
+    uint32_t time = e->timed ? e->time : IO_GetTime(); // stamp at the source, not on dequeue
 
     BLOCK_IRQS(
         // increment write idx, posbily wrapping
@@ -71,6 +74,8 @@ uint8_t event_post( event_t *e ) {
             sysEvents[ putIdx ].handler = e->handler;
             sysEvents[ putIdx ].index   = e->index;
             sysEvents[ putIdx ].data    = e->data;
+            sysEvents[ putIdx ].time    = time;
+            sysEvents[ putIdx ].timed   = true;
             status = 1;
         } else {
             // idx wrapped, so queue is full, restore idx
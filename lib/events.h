@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 union Data{
     void* p;
@@ -13,6 +14,8 @@ typedef struct event{
     void (*handler)( struct event* e );
     union Data   index;
     union Data   data;
+    uint32_t     time;  // capture time in samples, see IO_GetTime()
+    bool         timed; // time was set at the source. otherwise event_post stamps it
 } event_t;
 
 extern void events_init(void);
@@ -0,0 +1,72 @@
+#include "fastmath.h"
+
+#include <stdint.h>
+
+typedef union{
+    float    f;
+    uint32_t u;
+} fbits_t;
+
+#define FM_LN2     (0.6931471805599453)
+#define FM_PI      (3.141592653589793)
+#define FM_PI_2    (FM_PI/2.0)
+#define FM_2PI     (2.0*FM_PI)
+#define FM_2PI_HI  (6.28125) // 2pi split for exact reduction (cody-waite)
+#define FM_2PI_LO  (0.0019353071795864769)
+#define FM_1_2PI   (1.0/FM_2PI)
+#define FM_2_LN2   (2.0/FM_LN2)
+
+// split into integer & fractional parts. the fraction is approximated by a
+// taylor series for e^(f*ln2) on [-0.5,0.5], and the integer is shifted
+// directly into the exponent bits
+float fast_exp2f( float x )
+{
+    if( x >= 128.0 ){ fbits_t inf = { .u = 0x7F800000 }; return inf.f; }
+    if( x <= -126.0 ){ return 0.0; } // flush subnormals
+
+    int   n = (int)(x + (x < 0.0 ? -0.5 : 0.5)); // round to nearest
+    float f = (x - (float)n) * FM_LN2; // [-0.347,0.347]
+
+    // horner form of 1 + f + f^2/2! + ... + f^6/6!
+    float p = 1.0 + f*(1.0 + f*(1.0/2.0 + f*(1.0/6.0 + f*(1.0/24.0
+                + f*(1.0/120.0 + f*(1.0/720.0))))));
+
+    if( n > 127 ){ n--; p *= 2.0; } // x in [127.5,128) would overflow exponent
+    fbits_t scale = { .u = (uint32_t)(n + 127) << 23 };
+    return p * scale.f;
+}
+
+// split into exponent & mantissa, with the mantissa in [sqrt(.5),sqrt(2))
+// ln(m) = 2*atanh(t) where t = (m-1)/(m+1), |t| < 0.172
+float fast_log2f( float x )
+{
+    if( x <= 0.0 ){ fbits_t ninf = { .u = 0xFF800000 }; return ninf.f; }
+
+    fbits_t b = { .f = x };
+    int e = (int)((b.u >> 23) & 0xFF) - 127;
+    b.u = (b.u & 0x007FFFFF) | 0x3F800000; // m in [1,2)
+    if( b.f > 1.41421356 ){ b.f *= 0.5; e++; }
+
+    float t  = (b.f - 1.0) / (b.f + 1.0);
+    float t2 = t*t;
+    float s  = t*(1.0 + t2*(1.0/3.0 + t2*(1.0/5.0 + t2*(1.0/7.0 + t2*(1.0/9.0)))));
+    return (float)e + s * FM_2_LN2;
+}
+
+// fold into [0,pi/2] by symmetry, then an even taylor series to x^12
+float fast_cosf( float x )
+{
+    // reduce to [-pi,pi]
+    float q = x * FM_1_2PI;
+    q = (float)(int)(q + (q < 0.0 ? -0.5 : 0.5));
+    x = (x - q * FM_2PI_HI) - q * FM_2PI_LO;
+    if( x < 0.0 ){ x = -x; } // cos is even
+
+    float sign = 1.0;
+    if( x > FM_PI_2 ){ x = FM_PI - x; sign = -1.0; } // cos(pi-x) = -cos(x)
+
+    float x2 = x*x;
+    float p = 1.0 - x2*(1.0/2.0 - x2*(1.0/24.0 - x2*(1.0/720.0
+                - x2*(1.0/40320.0 - x2*(1.0/3628800.0 - x2*(1.0/479001600.0))))));
+    return sign * p;
+}
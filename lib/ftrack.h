@@ -1,26 +1,39 @@
 #pragma once
 
-#include <stm32f7xx.h>
-#include "../ll/interrupts.h"
-
-// shared pins with MIDI port
-#define FTRACK_GPIO_CLK_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
-#define FTRACK_PIN               GPIO_PIN_1
-#define FTRACK_GPIO_PORT         GPIOA
-
-#define FTRACK_IRQn                  EXTI1_IRQn
-#define FTRACK_IRQHandler            EXTI1_IRQHandler
-#define FTRACK_IRQPriority           MIDI_IRQPriority
-#define FTRACK_IRQSubPriority        2
-
-
-void FTrack_init( void );
-void FTrack_deinit( void );
-
-void FTrack_start( void );
-void FTrack_stop( void );
-
-float FTrack_get( void );
-
-// Interrupt handler for HAL
-void FTRACK_IRQHandler(void);
+#include <stdint.h>
+#include <stdbool.h>
+
+// frequency tracking on ADC samples, so any input can measure pitch
+// a schmitt trigger around the midpoint of the last cycle marks each rising crossing,
+// interpolated between samples. the time between crossings is the period.
+// cost is a few ops per sample, plus a divide per crossing
+// a new signal reads within 1% from its second rising crossing, so after 1-2 periods.
+// eg. ~30ms at 55Hz, but ~850ms for a 2Hz clock
+
+#define FTRACK_HYSTERESIS 0.1  // default volts either side of the center
+#define FTRACK_HYSTERESIS_MIN 0.001
+#define FTRACK_TIMEOUT    20.0 // seconds without a crossing until 0Hz is reported
+
+typedef struct{
+    bool  high;   // schmitt state
+    float last;   // previous sample, to interpolate the crossing
+    float center; // midpoint of the last cycle. crossings are measured around this
+    float cmax;   // extremes since the last rising crossing
+    float cmin;
+    float hysteresis; // volts either side of the center. signals must swing over twice this
+    float phase;  // samples since the last rising crossing
+    bool  primed; // a crossing has been seen, so phase is a period
+
+    float period; // smoothed period in samples. 0 if none
+    float confidence; // [0,1] how steady recent periods are
+} FTrack_t;
+
+void FTrack_init( FTrack_t* self );
+// lower it to track small signals, raise it to reject noise. resets tracking
+void FTrack_set_hysteresis( FTrack_t* self, float volts );
+
+// call once per block with the raw input
+void FTrack_process( FTrack_t* self, float* in, int size );
+
+float FTrack_get( FTrack_t* self ); // Hz. 0 if no steady signal
+float FTrack_get_confidence( FTrack_t* self );
@@ -6,7 +6,8 @@
 #include "../ll/adda.h"        // _Init(), _Start(), _GetADCValue(), IO_block_t
 #include "slopes.h"            // S_init(), S_step_v()
 #include "ashapes.h"           // AShaper_init(), AShaper_v()
-#include "detect.h"            // Detect_init(), Detect(), Detect_ix_to_p()
+#include "detect.h"            // Detect_init(), Detect_process()
+#include "route.h"             // Route_init(), Route_process()
 #include "metro.h"
 #include "caw.h"
 #include "casl.h"
@@ -17,6 +18,8 @@
 
 static void public_update( void );
 
+static volatile uint32_t block_time = 0; // sample time of b->in[j][0]
+
 void IO_Init( int adc_timer_ix )
 {
     // hardware layer
@@ -24,11 +27,13 @@ void IO_Init( int adc_timer_ix )
 
     // dsp objects
     Detect_init( IN_CHANNELS );
-    for(int i=0; i<SLOPE_CHANNELS; i++){
-        casl_init(i);
+    casl_init( IO_SLOPE_CHANNELS );
+    Route_init( IN_CHANNELS, IO_SLOPE_CHANNELS );
+    S_init( IO_SLOPE_CHANNELS );
+    AShaper_init( IO_SLOPE_CHANNELS );
+    for( int j=IO_OUT_CHANNELS; j<IO_SLOPE_CHANNELS; j++ ){
+        S_set_sample_rate( j, (float)SAMPLE_RATE / (float)ADDA_BLOCK_SIZE ); // 1 sample per block
     }
-    S_init( SLOPE_CHANNELS );
-    AShaper_init( SLOPE_CHANNELS );
 }
 
 void IO_Start( void )
@@ -40,28 +45,50 @@ void IO_Start( void )
 IO_block_t* IO_BlockProcess( IO_block_t* b )
 {
     for( int j=0; j<IN_CHANNELS; j++ ){
-        Detect_t* d = Detect_ix_to_p(j);
-        (*d->modefn)( d, b->in[j][b->size-1] );
+        Detect_process( j, b->in[j], b->size );
+        Route_process( j, b->in[j], b->size ); // before slopes step, so actions land in this block
     }
-    for( int j=0; j<SLOPE_CHANNELS; j++ ){
-        S_step_v( j
-                , b->out[j]
-                , b->size
-                );
+    for( int j=0; j<IO_OUT_CHANNELS; j++ ){
+        if( S_is_settled(j) && !AShaper_is_dirty(j) ){ // idle. nothing to recompute
+            b->held |= 1 << j;
+            b->out[j][0] = AShaper_get_state(j);
+        }
     }
-    for( int j=0; j<SLOPE_CHANNELS; j++ ){
-        AShaper_v( j
-                 , b->out[j]
+    // slopes step 4 channels at a time, & each group is quantized straight after
+    // while its buffers are hot. calibrate, clamp & pack are one pass in DAC_PickleBlock
+    for( int j=0; j<IO_OUT_CHANNELS; j+=4 ){
+        float* outs[4] = { b->out[j], b->out[j+1], b->out[j+2], b->out[j+3] };
+        S_step4_v( j
+                 , outs
+                 , b->held >> j
                  , b->size
                  );
+        for( int k=j; k<j+4; k++ ){
+            if( b->held & (1 << k) ){ continue; }
+            AShaper_v( k
+                     , b->out[k]
+                     , b->size
+                     );
+        }
+    }
+    for( int j=IO_OUT_CHANNELS; j<IO_SLOPE_CHANNELS; j++ ){ // virtual buses
+        if( S_is_settled(j) && !AShaper_is_dirty(j) ){ continue; }
+        float v;
+        S_step_v( j, &v, 1 );
+        AShaper_v( j, &v, 1 );
     }
     public_update();
+    block_time += b->size;
     return b;
 }
 float IO_GetADC( uint8_t channel )
 {
     return ADDA_GetADCValue( channel );
 }
+uint32_t IO_GetTime( void )
+{
+    return block_time;
+}
 typedef enum{ In_none
             , In_stream
             , In_change
@@ -3,12 +3,21 @@
 #include <stm32f7xx.h>
 #include <stdbool.h>
 
+#define IO_OUT_CHANNELS   4 // slopes rendered to the DAC. multiple of 4 for S_step4_v
+#define IO_BUS_CHANNELS   4 // virtual slopes rendered at control rate
+#define IO_SLOPE_CHANNELS (IO_OUT_CHANNELS + IO_BUS_CHANNELS)
+
 void IO_Init( int adc_timer_ix );
 void IO_Start( void );
 
 void IO_Process( void );
 
 float IO_GetADC( uint8_t channel );
+
+// sample clock for timestamping events. counts from IO_Start & wraps after
+// ~24hrs, so compare times by subtraction. during IO_BlockProcess it is the
+// time of the block's first sample, so detectors add their sample offset
+uint32_t IO_GetTime( void );
 void IO_SetADCaction( uint8_t channel, const char* mode );
 
 void IO_public_set_view( int chan, bool state );
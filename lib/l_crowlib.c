@@ -8,7 +8,10 @@
 #include "lib/ii.h"         // ii_*()
 #include "lib/ashapes.h"    // AShaper_get_state
 #include "lib/caw.h"        // Caw_printf()
-#include "lib/io.h"         // IO_GetADC()
+#include "lib/io.h"         // IO_GetADC(), IO_OUT_CHANNELS
+#include "lib/casl.h"       // casl_volts(), casl_setslew()
+#include "lib/route.h"      // Route_clear()
+#include "lib/fastmath.h"   // fast_log2f(), fast_exp2f()
 
 #define L_CL_MIDDLEC 		(261.63f)
 #define L_CL_MIDDLEC_INV 	(1.0f/L_CL_MIDDLEC)
@@ -36,6 +39,25 @@ static void _load_lib(lua_State* L, char* filename, char* luaname){
     lua_settop(L, 0);
 }
 
+// creates global table 'name' of count Output objects, starting at channel first
+static void _new_outputs(lua_State* L, const char* name, int first, int count){
+	lua_createtable(L, count, 0); // count array elements
+	lua_setglobal(L, name); // -> @0
+
+	lua_getglobal(L, name); // @1
+	for(int i=1; i<=count; i++){
+		lua_getglobal(L, "Output"); // @2
+		lua_getfield(L, 2, "new"); // Output.new @3
+		lua_pushinteger(L, first+i-1); // push the channel
+		lua_call(L, 1, 1); // Output.new(chan) -> replace key with value -> @3
+		lua_pushinteger(L, i); // push the key
+		lua_rotate(L, -2, 1); // swap top 2 elements
+		lua_settable(L, 1); // name[i] = result
+		lua_settop(L, 1); // discard everything except _G[name]
+	}
+	lua_settop(L, 0);
+}
+
 // called after crowlib lua file is loaded
 // here we add any additional globals and such
 void l_crowlib_init(lua_State* L){
@@ -118,21 +140,11 @@ void l_crowlib_init(lua_State* L){
 	// for chan = 1, #output do
 	// 	 output[chan] = Output.new( chan )
 	// end
-	lua_createtable(L, 4, 0); // 4 array elements
-	lua_setglobal(L, "output"); // -> @0
+	_new_outputs(L, "output", 1, IO_OUT_CHANNELS);
 
-	lua_getglobal(L, "output"); // @1
-	for(int i=1; i<=4; i++){
-		lua_getglobal(L, "Output"); // @2
-		lua_getfield(L, 2, "new"); // Output.new @3
-		lua_pushinteger(L, i); // push the key
-		lua_call(L, 1, 1); // Output.new(chan) -> replace key with value -> @3
-		lua_pushinteger(L, i); // push the key
-		lua_rotate(L, -2, 1); // swap top 2 elements
-		lua_settable(L, 1); // output[chan] = result
-		lua_settop(L, 1); // discard everything except _G.output
-	}
-	lua_settop(L, 0);
+	// virtual outputs for modulation. not connected to the DAC
+	// bus[n] = Output.new( #output + n )
+	_new_outputs(L, "bus", IO_OUT_CHANNELS+1, IO_BUS_CHANNELS);
 
 
 	// LL_get_state = get_state
@@ -198,42 +210,33 @@ void l_crowlib_emptyinit(lua_State* L){
 }
 
 
-int l_crowlib_crow_reset( lua_State* L ){
-	printf("crow.reset()\n\r");
-
-    lua_getglobal(L, "input"); // @1
-	for(int i=1; i<=2; i++){
-        lua_settop(L, 1); // _G.input is TOS @1
-		lua_pushinteger(L, i); // @2
-		lua_gettable(L, 1); // replace @2 with: input[n]
-
-        // input[n].mode = 'none'
-        lua_pushstring(L, "none"); // @3
-        lua_setfield(L, 2, "mode"); // pops 'none' -> @2
-
-        // input[n].reset_events(input[n]) -- aka void method call
-        lua_getfield(L, 2, "reset_events"); // @3
-        lua_pushvalue(L, 2); // @4 copy of input[n]
-        lua_call(L, 1, 0);
-	}
-    lua_settop(L, 0);
-
-    lua_getglobal(L, "output"); // @1
-	for(int i=1; i<=4; i++){
-        lua_settop(L, 1); // _G.output is TOS @1
+// resets each Output object in global table 'name'
+static void _reset_outputs(lua_State* L, const char* name, int count){
+    lua_getglobal(L, name); // @1
+	for(int i=1; i<=count; i++){
+        lua_settop(L, 1); // _G[name] is TOS @1
 		lua_pushinteger(L, i); // @2
 		lua_gettable(L, 1); // replace @2 with: output[n]
 
         // output[n].slew = 0
         lua_pushnumber(L, 0.0); // @3
         lua_setfield(L, 2, "slew"); // pops 'slew' -> @2
-        // output[n].volts = 0
+        // output[n].shape = 'linear' -- also frees any curve it held
+        lua_pushstring(L, "linear"); // @3
+        lua_setfield(L, 2, "shape"); // pops 'shape' -> @2
+        // output[n].volts = 0 -- replaces the program, freeing its curves
         lua_pushnumber(L, 0.0); // @3
         lua_setfield(L, 2, "volts"); // pops 'volts' -> @2
         // output[n].scale('none')
         lua_getfield(L, 2, "scale");
         lua_pushstring(L, "none");
         lua_call(L, 1, 0);
+        // output[n].hysteresis = 0
+        lua_pushnumber(L, 0.0); // @3
+        lua_setfield(L, 2, "hysteresis"); // pops 'hysteresis' -> @2
+        // output[n].note = nil
+        lua_pushnil(L); // @3
+        lua_setfield(L, 2, "note"); // pops nil -> @2
         // output[n].done = function() end
         lua_getglobal(L, "nop_fn"); // @3
         lua_setfield(L, 2, "done"); // pops nop_fn -> @2
@@ -249,6 +252,31 @@ int l_crowlib_crow_reset( lua_State* L ){
         lua_call(L, 1, 0);
 	}
 	lua_settop(L, 0);
+}
+
+int l_crowlib_crow_reset( lua_State* L ){
+	printf("crow.reset()\n\r");
+
+    lua_getglobal(L, "input"); // @1
+	for(int i=1; i<=2; i++){
+        lua_settop(L, 1); // _G.input is TOS @1
+		lua_pushinteger(L, i); // @2
+		lua_gettable(L, 1); // replace @2 with: input[n]
+
+        // input[n].mode = 'none'
+        lua_pushstring(L, "none"); // @3
+        lua_setfield(L, 2, "mode"); // pops 'none' -> @2
+
+        // input[n].reset_events(input[n]) -- aka void method call
+        lua_getfield(L, 2, "reset_events"); // @3
+        lua_pushvalue(L, 2); // @4 copy of input[n]
+        lua_call(L, 1, 0);
+	}
+    lua_settop(L, 0);
+    Route_clear( -1 ); // input[n]:unroute() for all inputs
+
+    _reset_outputs(L, "output", IO_OUT_CHANNELS);
+    _reset_outputs(L, "bus", IO_BUS_CHANNELS);
 
     // ii.reset_events(ii.self)
     lua_getglobal(L, "ii"); // @1
@@ -313,10 +341,10 @@ int l_crowlib_hztovolts(lua_State *L){
 	switch(lua_gettop(L)){
 		case 1: // use default middleC reference
 			// note we 
-			retval = log2f(luaL_checknumber(L, 1) * L_CL_MIDDLEC_INV);
+			retval = fast_log2f(luaL_checknumber(L, 1) * L_CL_MIDDLEC_INV);
 			break;
 		case 2: // use provided reference
-			retval = log2f(luaL_checknumber(L, 1)/luaL_checknumber(L, 2));
+			retval = fast_log2f(luaL_checknumber(L, 1)/luaL_checknumber(L, 2));
 			break;
 		default:
 			lua_pushliteral(L, "need 1 or 2 args");
@@ -333,7 +361,7 @@ static int justvolts(lua_State* L, float mul){
 	float offset = 0.f;
 	switch(lua_gettop(L)){
 		case 1: break;
-		case 2: {offset = log2f(luaL_checknumber(L, 2))*mul;} break;
+		case 2: {offset = fast_log2f(luaL_checknumber(L, 2))*mul;} break;
 		default:
 			lua_pushliteral(L, "need 1 or 2 args");
 			lua_error(L);
@@ -344,7 +372,7 @@ static int justvolts(lua_State* L, float mul){
 	int nresults = 0;
 	switch(lua_type(L, 1)){
 		case LUA_TNUMBER:{
-			float result = log2f(lua_tonumber(L, 1))*mul + offset;
+			float result = fast_log2f(lua_tonumber(L, 1))*mul + offset;
 			lua_settop(L, 0);
 			lua_pushnumber(L, result);
 			nresults = 1;
@@ -359,7 +387,7 @@ static int justvolts(lua_State* L, float mul){
 			float newtab[telems+1]; // bottom element is unused
 			for(int i=1; i<=telems; i++){
 				lua_geti(L, 1, i);
-				newtab[i] = log2f(luaL_checknumber(L, -1))*mul + offset;
+				newtab[i] = fast_log2f(luaL_checknumber(L, -1))*mul + offset;
 				lua_pop(L, 1); // pops the number from the stack
 			}
 
@@ -413,12 +441,8 @@ static int _ii_self_volts( lua_State* L ){
 	int chan = luaL_checknumber(L, 1);
 	float val = luaL_checknumber(L, 2);
 	lua_settop(L, 0);
-	lua_getglobal(L, "output"); // 1
-	lua_pushnumber(L, chan); // 2
-	lua_gettable(L, -2); // output[chan] onto stack @2
-	lua_pushnumber(L, val); // 3
-	lua_setfield(L, 2, "volts");
-	lua_settop(L, 0);
+	if( chan < 1 || chan > IO_OUT_CHANNELS ){ return 0; } // outputs only. buses aren't ii targets
+	casl_volts(chan-1, val); // skip the lua metamethod. C is zero-based
 	return 0;
 }
 
@@ -427,12 +451,8 @@ static int _ii_self_slew( lua_State* L ){
 	int chan = luaL_checknumber(L, 1);
 	float slew = luaL_checknumber(L, 2);
 	lua_settop(L, 0);
-	lua_getglobal(L, "output"); // 1
-	lua_pushnumber(L, chan); // 2
-	lua_gettable(L, -2); // output[chan] onto stack @2
-	lua_pushnumber(L, slew); // 3
-	lua_setfield(L, 2, "slew");
-	lua_settop(L, 0);
+	if( chan < 1 || chan > IO_OUT_CHANNELS ){ return 0; } // outputs only
+	casl_setslew(chan-1, slew); // C is zero-based
 	return 0;
 }
 
@@ -504,7 +524,7 @@ static int _ii_self_lfo( lua_State* L ){
 	lua_gettable(L, -2); // output[chan] onto stack @2
 
 	lua_getglobal(L, "ramp"); // 3
-	lua_pushnumber(L, powf(2.0, -freq));
+	lua_pushnumber(L, fast_exp2f(-freq));
 	lua_pushnumber(L, skew);
 	lua_pushnumber(L, level);
 	lua_call(L, 3, 1); // calls 'ramp' and leaves asl table @3
@@ -11,9 +11,11 @@
 
 // Hardware IO
 #include "lib/slopes.h"     // S_toward
+#include "lib/shapes.h"     // shapes_curve_define()
 #include "lib/casl.h"       // C-ASL
 #include "lib/ashapes.h"    // AShaper_unset_scale(), AShaper_set_scale()
 #include "lib/detect.h"     // Detect*
+#include "lib/route.h"      // Route_*()
 #include "lib/caw.h"        // Caw_send_*()
 #include "lib/ii.h"         // ii_*()
 #include "lib/bootloader.h" // bootloader_enter()
@@ -24,6 +26,7 @@
 #include "../ll/cal_ll.h"   // CAL_LL_ActiveChannel()
 #include "../ll/system.h"   // getUID_Word()
 #include "../ll/i2c.h"      // I2C_SetTimings(u8)
+#include "../ll/random.h"   // Random_Float()
 #include "lib/events.h"     // event_t event_post()
 #include "stm32f7xx_hal.h"  // HAL_GetTick()
 #include "stm32f7xx_it.h"   // CPU_GetCount()
@@ -59,6 +62,7 @@ void L_handle_ii_followRx( event_t* e );
 void L_handle_ii_followRx_cont( uint8_t cmd, int args, float* data );
 void L_handle_window( event_t* e );
 void L_handle_in_scale( event_t* e );
+void L_handle_out_note( event_t* e );
 void L_handle_volume( event_t* e );
 void L_handle_peak( event_t* e );
 void L_handle_clock_resume( event_t* e );
@@ -73,6 +77,12 @@ void _printf(char* error_message)
 
 lua_State* L; // global access for 'reset-environment'
 
+static uint32_t _hw_seed( void )
+{
+    return (uint32_t)(Random_Float() * 65536.0) << 16
+         | (uint32_t)(Random_Float() * 65536.0);
+}
+
 // Public functions
 lua_State* Lua_Init(void)
 {
@@ -80,6 +90,7 @@ lua_State* Lua_Init(void)
     luaL_openlibs(L);
     Lua_linkctolua(L);
     l_bootstrap_init(L); // redefine dofile(), print(), load crowlib
+    casl_seed( _hw_seed() ); // the RNG buffer has filled while lua loaded
     return L;
 }
 
@@ -104,9 +115,12 @@ lua_State* Lua_Reset( void )
     // cleanup any C-based event generators
     Metro_stop_all();
     for( int i=0; i<2; i++ ){
-        Detect_none( Detect_ix_to_p(i) );
+        for( int j=0; j<DETECT_CHAIN; j++ ){
+            Detect_none( Detect_chain_to_p(i, j) );
+        }
     }
-    for( int i=0; i<4; i++ ){
+    Route_clear( -1 );
+    for( int i=0; i<IO_SLOPE_CHANNELS; i++ ){
         S_toward( i, 0.0, 0.0, SHAPE_Linear, NULL );
     }
     events_clear();
@@ -284,6 +298,20 @@ static int _set_scale( lua_State *L )
     lua_pop( L, nargs );
     return 0;
 }
+static int _set_output_hysteresis( lua_State *L )
+{
+    AShaper_set_hysteresis( luaL_checkinteger(L, 1)-1 // index is 1-based in lua
+                          , luaL_checknumber(L, 2) );
+    lua_pop( L, 2 );
+    return 0;
+}
+static int _set_output_note( lua_State *L )
+{
+    AShaper_set_note_action( luaL_checkinteger(L, 1)-1 // index is 1-based in lua
+                           , lua_toboolean(L, 2) ? L_queue_out_note : NULL );
+    lua_pop( L, 2 );
+    return 0;
+}
 static int _io_get_input( lua_State *L )
 {
     float adc = IO_GetADC( luaL_checkinteger(L, 1)-1 );
@@ -291,10 +319,17 @@ static int _io_get_input( lua_State *L )
     lua_pushnumber( L, adc );
     return 1;
 }
+// set_input_<mode>( channel, <mode args>..., [slot] )
+// slot picks the detector in the input's chain, defaulting to the first
+static Detect_t* input_detector( lua_State* L, int args )
+{
+    uint8_t ix   = luaL_checkinteger(L, 1)-1; // Lua is 1-based
+    uint8_t slot = luaL_optinteger(L, args+1, 1)-1;
+    return Detect_chain_to_p( ix, slot );
+}
 static int _set_input_none( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 1 );
     if(d){ // valid index
         Detect_none( d );
     }
@@ -304,8 +339,7 @@ static int _set_input_none( lua_State *L )
 }
 static int _set_input_stream( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 2 );
     if(d){ // valid index
         Detect_stream( d
                      , L_queue_stream
@@ -318,8 +352,7 @@ static int _set_input_stream( lua_State *L )
 }
 static int _set_input_change( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 4 );
     if(d){ // valid index
         Detect_change( d
                      , L_queue_change
@@ -334,8 +367,7 @@ static int _set_input_change( lua_State *L )
 }
 static int _set_input_window( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 3 );
     if(d){ // valid index
         // capture window table from lua
         int wLen = lua_rawlen( L, 2 );           // length of the table
@@ -358,8 +390,7 @@ static int _set_input_window( lua_State *L )
 }
 static int _set_input_scale( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 4 );
     if(d){ // valid index
         int sLen = lua_rawlen( L, 2 ); // length of the scale table
         float scale[sLen];
@@ -382,8 +413,7 @@ static int _set_input_scale( lua_State *L )
 }
 static int _set_input_volume( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 2 );
     if(d){ // valid index
         Detect_volume( d
                      , L_queue_volume
@@ -396,8 +426,7 @@ static int _set_input_volume( lua_State *L )
 }
 static int _set_input_peak( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 3 );
     if(d){ // valid index
         Detect_peak( d
                    , L_queue_peak
@@ -411,22 +440,21 @@ static int _set_input_peak( lua_State *L )
 }
 static int _set_input_freq( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 3 );
     if(d){ // valid index
         Detect_freq( d
                    , L_queue_freq
                    , luaL_checknumber(L, 2)
+                   , luaL_checknumber(L, 3)
                    );
     }
-    lua_pop( L, 2 );
+    lua_pop( L, 3 );
     lua_settop(L, 0);
     return 0;
 }
 static int _set_input_clock( lua_State *L )
 {
-    uint8_t ix = luaL_checkinteger(L, 1)-1;
-    Detect_t* d = Detect_ix_to_p( ix ); // Lua is 1-based
+    Detect_t* d = input_detector( L, 4 );
     if(d){ // valid index
         clock_set_source(CLOCK_SOURCE_CROW);
         clock_crow_in_div(luaL_checknumber(L, 2));
@@ -442,6 +470,41 @@ static int _set_input_clock( lua_State *L )
     return 0;
 }
 
+// Routes
+// set_route_trigger(input, output, threshold, hysteresis, direction, held_dyn) -> route id or -1
+static int _set_route_trigger( lua_State *L )
+{
+    int r = Route_trigger( luaL_checkinteger(L, 1)-1 // Lua is 1-based
+                         , luaL_checkinteger(L, 2)-1
+                         , luaL_checknumber(L, 3)
+                         , luaL_checknumber(L, 4)
+                         , Detect_str_to_dir( luaL_checkstring(L, 5) )
+                         , luaL_optinteger(L, 6, -1) // held{} dynamic, if any
+                         );
+    lua_settop(L, 0);
+    lua_pushinteger(L, r);
+    return 1;
+}
+// set_route_cv(input, output, dynamic, scale, offset) -> route id or -1
+static int _set_route_cv( lua_State *L )
+{
+    int r = Route_cv( luaL_checkinteger(L, 1)-1 // Lua is 1-based
+                    , luaL_checkinteger(L, 2)-1
+                    , luaL_checkinteger(L, 3) // dynamics are 0-based
+                    , luaL_checknumber(L, 4)
+                    , luaL_checknumber(L, 5)
+                    );
+    lua_settop(L, 0);
+    lua_pushinteger(L, r);
+    return 1;
+}
+static int _clear_routes( lua_State *L )
+{
+    Route_clear( luaL_checkinteger(L, 1)-1 ); // Lua is 1-based
+    lua_settop(L, 0);
+    return 0;
+}
+
 // CASL
 static int _casl_describe( lua_State *L )
 {
@@ -460,6 +523,107 @@ static int _casl_action( lua_State *L )
     lua_settop(L, 0);
     return 0;
 }
+static int _casl_volts( lua_State *L )
+{
+    casl_volts( luaL_checkinteger(L, 1)-1 // C is zero-based
+              , luaL_checknumber(L, 2) );
+    lua_pop(L, 2);
+    lua_settop(L, 0);
+    return 0;
+}
+static int _casl_setslew( lua_State *L )
+{
+    casl_setslew( luaL_checkinteger(L, 1)-1 // C is zero-based
+                , luaL_checknumber(L, 2) );
+    lua_pop(L, 2);
+    return 0;
+}
+static int _casl_getslew( lua_State *L )
+{
+    float s = casl_getslew( luaL_checkinteger(L, 1)-1 ); // C is zero-based
+    lua_pop(L, 1);
+    lua_pushnumber(L, s);
+    return 1;
+}
+static Shape_t _lua_to_shape( lua_State *L, int ix )
+{
+    if( lua_istable(L, ix) ){ // curve{} returns {'CURVE', index}
+        lua_rawgeti(L, ix, 2);
+        int curve = luaL_checkinteger(L, -1);
+        lua_pop(L, 1);
+        if( curve < 0 || curve >= CURVE_COUNT ){ return SHAPE_Linear; } // failed define
+        return SHAPE_Curve + curve;
+    }
+    return S_str_to_shape( luaL_checkstring(L, ix) );
+}
+static int _casl_setshape( lua_State *L )
+{
+    casl_setshape( luaL_checkinteger(L, 1)-1 // C is zero-based
+                 , _lua_to_shape(L, 2) );
+    lua_pop(L, 2);
+    return 0;
+}
+// takes a table of levels, or of {x,y} breakpoints. returns the curve index or -1
+// longer tables are resampled by shapes_curve_define, so the whole list is read
+static int _shape_defcurve( lua_State *L )
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int count = lua_rawlen(L, 1);
+    if( count < 2 ){ // not a curve
+        lua_settop(L, 0);
+        lua_pushinteger(L, -1);
+        return 1;
+    }
+    lua_rawgeti(L, 1, 1);
+    bool pairs = lua_istable(L, -1);
+    lua_pop(L, 1);
+
+    float* x = malloc( sizeof(float) * count * (pairs ? 2 : 1) );
+    if( !x ){ return luaL_error(L, "curve: out of memory"); }
+    float* y = pairs ? &x[count] : x;
+    bool ok = true;
+    for( int i=0; i<count && ok; i++ ){ // no lua errors while x is held
+        lua_rawgeti(L, 1, i+1);
+        if( pairs ){
+            ok = lua_istable(L, -1);
+            if( ok ){
+                lua_rawgeti(L, -1, 1);
+                lua_rawgeti(L, -2, 2);
+                ok = lua_isnumber(L, -2) && lua_isnumber(L, -1);
+                x[i] = lua_tonumber(L, -2);
+                y[i] = lua_tonumber(L, -1);
+                lua_pop(L, 2);
+            }
+        } else {
+            ok = lua_isnumber(L, -1);
+            y[i] = lua_tonumber(L, -1);
+        }
+        lua_pop(L, 1);
+    }
+    int ix = ok ? shapes_curve_define( pairs ? x : NULL, y, count ) : -1;
+    free(x);
+    if( !ok ){ return luaL_error(L, "curve: expected numbers or {x,y} pairs"); }
+    lua_settop(L, 0);
+    lua_pushinteger(L, ix);
+    return 1;
+}
+// casl_usage([id]) -> {code=, seq=, dyn=, code_max=, ...}
+// counts for asl channel id, or totals across all channels if no id. _max is pool size
+static int _casl_usage( lua_State *L )
+{
+    static const char* used[POOL_COUNT] = {"code",     "seq",     "dyn"    };
+    static const char* max[POOL_COUNT]  = {"code_max", "seq_max", "dyn_max"};
+    int c_ix = luaL_optinteger(L, 1, 0)-1; // lua is 1-based. no arg gives -1 for totals
+    lua_settop(L, 0);
+    lua_createtable(L, 0, 2*POOL_COUNT);
+    for( int p=0; p<POOL_COUNT; p++ ){
+        lua_pushinteger(L, casl_usage(c_ix, p));
+        lua_setfield(L, -2, used[p]);
+        lua_pushinteger(L, casl_capacity(p));
+        lua_setfield(L, -2, max[p]);
+    }
+    return 1;
+}
 static int _casl_defdynamic( lua_State *L )
 {
     int c_ix = luaL_checkinteger(L, 1)-1; // lua is 1-based
@@ -482,6 +646,48 @@ static int _casl_setdynamic( lua_State *L )
     lua_pop(L, 3);
     return 0;
 }
+// casl_setdynamics(id, {[dyn_ix]=value, ...})
+static int _casl_setdynamics( lua_State *L )
+{
+    int c_ix = luaL_checkinteger(L, 1)-1; // lua is 1-based
+    luaL_checktype(L, 2, LUA_TTABLE);
+
+    // check the whole batch before anything is written, so it applies entirely or not at all
+    int count = 0;
+    lua_pushnil(L);
+    while( lua_next(L, 2) != 0 ){
+        luaL_checkinteger(L, -2);
+        luaL_checknumber(L, -1);
+        count++;
+        lua_pop(L, 1); // keep key for next iteration
+    }
+    if( count == 0 ){ lua_settop(L, 0); return 0; }
+    if( c_ix < 0 || count > casl_usage(c_ix, POOL_Dyn) ){
+        return luaL_error(L, "casl_setdynamics: %d values for %d dynamics", count
+                           , (c_ix < 0) ? 0 : casl_usage(c_ix, POOL_Dyn) );
+    }
+
+    int*   ixs  = malloc( sizeof(int) * count );
+    float* vals = malloc( sizeof(float) * count );
+    if( !ixs || !vals ){
+        free(ixs); free(vals);
+        return luaL_error(L, "casl_setdynamics: out of memory");
+    }
+    int i = 0;
+    lua_pushnil(L);
+    while( lua_next(L, 2) != 0 ){ // types were checked above, so nothing here can raise
+        ixs[i]  = lua_tointeger(L, -2);
+        vals[i] = lua_tonumber(L, -1);
+        i++;
+        lua_pop(L, 1);
+    }
+    bool ok = casl_setdynamics( c_ix, ixs, vals, count );
+    free(ixs);
+    free(vals);
+    if( !ok ){ return luaL_error(L, "casl_setdynamics: dynamic out of range"); }
+    lua_settop(L, 0);
+    return 0;
+}
 static int _casl_getdynamic( lua_State *L )
 {
     float d = casl_getdynamic( luaL_checkinteger(L, 1)-1 // lua is 1-based
@@ -491,6 +697,14 @@ static int _casl_getdynamic( lua_State *L )
     lua_pushnumber(L, d);
     return 1;
 }
+// casl_seed([n]) -> seeds asl random ops. reseeds from the hardware RNG if no n
+static int _casl_seed( lua_State *L )
+{
+    casl_seed( lua_isnoneornil(L, 1) ? _hw_seed()
+                                     : (uint32_t)luaL_checkinteger(L, 1) );
+    lua_settop(L, 0);
+    return 0;
+}
 
 static int _send_usb( lua_State *L )
 {
@@ -821,6 +1035,8 @@ static const struct luaL_Reg libCrow[]=
         // io
     , { "get_state"        , _get_state        }
     , { "set_output_scale" , _set_scale        }
+    , { "set_output_hysteresis", _set_output_hysteresis }
+    , { "set_output_note"  , _set_output_note  }
     , { "io_get_input"     , _io_get_input     }
     , { "set_input_none"   , _set_input_none   }
     , { "set_input_stream" , _set_input_stream }
@@ -831,13 +1047,24 @@ static const struct luaL_Reg libCrow[]=
     , { "set_input_peak"   , _set_input_peak   }
     , { "set_input_freq"   , _set_input_freq   }
     , { "set_input_clock"  , _set_input_clock  }
+    , { "set_route_trigger", _set_route_trigger }
+    , { "set_route_cv"     , _set_route_cv     }
+    , { "clear_routes"     , _clear_routes     }
         // casl
     , { "casl_describe"    , _casl_describe    }
     , { "casl_action"      , _casl_action      }
+    , { "casl_volts"       , _casl_volts       }
+    , { "casl_setslew"     , _casl_setslew     }
+    , { "casl_getslew"     , _casl_getslew     }
+    , { "casl_setshape"    , _casl_setshape    }
+    , { "shape_defcurve"   , _shape_defcurve   }
+    , { "casl_usage"       , _casl_usage       }
     , { "casl_defdynamic"  , _casl_defdynamic  }
     , { "casl_cleardynamics", _casl_cleardynamics }
     , { "casl_setdynamic"  , _casl_setdynamic  }
+    , { "casl_setdynamics" , _casl_setdynamics }
     , { "casl_getdynamic"  , _casl_getdynamic  }
+    , { "casl_seed"        , _casl_seed        }
         // usb
     , { "send_usb"         , _send_usb         }
         // i2c
@@ -990,12 +1217,15 @@ void L_queue_asl_done( int id )
     event_post(&e);
 }
 
-// forward directly to output[e->index.i].done()
+// forward directly to Output.outputs[e->index.i].done()
+// Output.outputs covers both output[n] and bus[n]
 void L_handle_asl_done( event_t* e )
 {
-    lua_getglobal(L, "output"); // @1
+    lua_getglobal(L, "Output"); // @1
+    lua_getfield(L, 1, "outputs"); // @2
     lua_pushinteger(L, e->index.i + 1); // 1-ix'd
-    lua_gettable(L, 1); // @2
+    lua_gettable(L, 2); // @3
+    lua_remove(L, 2); // Output.outputs[n] is now @2
     lua_getfield(L, 2, "done");
     Lua_call_usercode(L, 0, 0); // lua_call with timeout hook
     lua_settop(L, 0);
@@ -1014,15 +1244,18 @@ void L_handle_metro( event_t* e )
     lua_getglobal(L, "metro_handler");
     lua_pushinteger(L, e->index.i +1); // 1-ix'd
     lua_pushinteger(L, e->data.i +1);  // 1-ix'd
-    if( Lua_call_usercode(L, 2, 0) != LUA_OK ){
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 3, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
 
-void L_queue_stream( int id, float state )
+void L_queue_stream( int id, float state, int offset )
 {
     event_t e = { .handler = L_handle_stream
                 , .index.i = id
+                , .time    = IO_GetTime() + offset
+                , .timed   = true
                 , .data.f  = state
                 };
     event_post(&e);
@@ -1032,15 +1265,18 @@ void L_handle_stream( event_t* e )
     lua_getglobal(L, "stream_handler");
     lua_pushinteger(L, e->index.i +1); // 1-ix'd
     lua_pushnumber(L, e->data.f);
-    if( Lua_call_usercode(L, 2, 0) != LUA_OK ){
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 3, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
 
-void L_queue_change( int id, float state )
+void L_queue_change( int id, float state, int offset )
 {
     event_t e = { .handler = L_handle_change
                 , .index.i = id
+                , .time    = IO_GetTime() + offset
+                , .timed   = true
                 , .data.f  = state
                 };
     event_post(&e);
@@ -1050,7 +1286,8 @@ void L_handle_change( event_t* e )
     lua_getglobal(L, "change_handler");
     lua_pushinteger(L, e->index.i +1); // 1-ix'd
     lua_pushnumber(L, e->data.f);
-    if( Lua_call_usercode(L, 2, 0) != LUA_OK ){
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 3, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
@@ -1072,7 +1309,8 @@ void L_handle_ii_leadRx( event_t* e )
     lua_pushinteger(L, e->index.u8s[1]); // command
     lua_pushinteger(L, e->index.u8s[2]); // arg
     lua_pushnumber(L, e->data.f);
-    if( Lua_call_usercode(L, 4, 0) != LUA_OK ){
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 5, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
@@ -1117,32 +1355,76 @@ float L_handle_ii_followRxTx( uint8_t cmd, int args, float* data )
     return n;
 }
 
-void L_queue_in_scale( int id, float note )
+// called from d_scale at each crossing, so the detector's last* state is this crossing's.
+// it's packed into the event, as more crossings may happen before it's handled
+void L_queue_in_scale( int id, float volts, int offset )
 {
+    Detect_t* d = Detect_find_action( id, L_queue_in_scale );
+    if( !d ){ return; }
     event_t e = { .handler = L_handle_in_scale
-                , .index.i = id
+                , .data.f  = volts
+                , .time    = IO_GetTime() + offset
+                , .timed   = true
                 };
+    e.index.u8s[0] = id;
+    e.index.u8s[1] = d->scale.lastIndex; // < SCALE_MAX_COUNT
+    e.index.u8s[2] = (uint16_t)d->scale.lastOct & 0xFF; // 16bit signed
+    e.index.u8s[3] = (uint16_t)d->scale.lastOct >> 8;
     event_post(&e);
 }
 void L_handle_in_scale( event_t* e )
 {
+    int id    = e->index.u8s[0];
+    int index = e->index.u8s[1];
+    int oct   = (int16_t)(e->index.u8s[2] | (e->index.u8s[3] << 8));
+    Detect_t* d = Detect_find_action( id, L_queue_in_scale );
+    if( !d || index >= d->scale.sLen ){ return; } // reconfigured since the event
     lua_getglobal(L, "scale_handler");
-    Detect_t* d = Detect_ix_to_p( e->index.i );
     // TODO these should be wrapped in a table here rather than lua
-    lua_pushinteger(L, e->index.i +1); // 1-ix'd
-    lua_pushinteger(L, d->scale.lastIndex +1); // 1-ix'd
-    lua_pushinteger(L, d->scale.lastOct);
-    lua_pushnumber(L, d->scale.lastNote);
-    lua_pushnumber(L, d->scale.lastVolts);
-    if( Lua_call_usercode(L, 5, 0) != LUA_OK ){
+    lua_pushinteger(L, id +1); // 1-ix'd
+    lua_pushinteger(L, index +1); // 1-ix'd
+    lua_pushinteger(L, oct);
+    lua_pushnumber(L, d->scale.scale[index] + (float)oct * d->scale.divs); // as lastNote
+    lua_pushnumber(L, e->data.f);
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 6, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
 
-void L_queue_window( int id, float window )
+// the note is packed into the event, as the shaper may have moved on before it's handled
+void L_queue_out_note( int id, int note, int octave, float volts )
+{
+    event_t e = { .handler = L_handle_out_note
+                , .data.f  = volts
+                , .time    = IO_GetTime() // raised by the DSP as the block's note settles
+                , .timed   = true
+                };
+    e.index.u8s[0] = id;
+    e.index.u8s[1] = note; // < MAX_DIV_LIST_LEN
+    e.index.u8s[2] = (uint16_t)octave & 0xFF; // 16bit signed
+    e.index.u8s[3] = (uint16_t)octave >> 8;
+    event_post(&e);
+}
+void L_handle_out_note( event_t* e )
+{
+    int octave = (int16_t)(e->index.u8s[2] | (e->index.u8s[3] << 8));
+    lua_getglobal(L, "note_handler");
+    lua_pushinteger(L, e->index.u8s[0] +1); // 1-ix'd
+    lua_pushinteger(L, e->index.u8s[1] +1); // 1-ix'd
+    lua_pushinteger(L, octave);
+    lua_pushnumber(L, e->data.f);
+    if( Lua_call_usercode(L, 4, 0) != LUA_OK ){
+        lua_pop( L, 1 );
+    }
+}
+
+void L_queue_window( int id, float window, int offset )
 {
     event_t e = { .handler = L_handle_window
                 , .index.i = id
+                , .time    = IO_GetTime() + offset
+                , .timed   = true
                 };
     if( window >= 0.0 ){
         e.data.u8s[0] = window;
@@ -1159,15 +1441,18 @@ void L_handle_window( event_t* e )
     lua_pushinteger(L, e->index.i+1); // 1-ix'd
     lua_pushinteger(L, e->data.u8s[0]);
     lua_pushnumber(L, e->data.u8s[1]);
-    if( Lua_call_usercode(L, 3, 0) != LUA_OK ){
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 4, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
 
-void L_queue_volume( int id, float level )
+void L_queue_volume( int id, float level, int offset )
 {
     event_t e = { .handler = L_handle_volume
                 , .index.i = id
+                , .time    = IO_GetTime() + offset
+                , .timed   = true
                 , .data.f  = level
                 };
     event_post(&e);
@@ -1177,15 +1462,18 @@ void L_handle_volume( event_t* e )
     lua_getglobal(L, "volume_handler");
     lua_pushinteger(L, e->index.i+1); // 1-ix'd
     lua_pushnumber(L, e->data.f);
-    if( Lua_call_usercode(L, 2, 0) != LUA_OK ){
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 3, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
 
-void L_queue_peak( int id, float ignore )
+void L_queue_peak( int id, float ignore, int offset )
 {
     event_t e = { .handler = L_handle_peak
                 , .index.i = id
+                , .time    = IO_GetTime() + offset
+                , .timed   = true
                 };
     event_post(&e);
 }
@@ -1193,25 +1481,32 @@ void L_handle_peak( event_t* e )
 {
     lua_getglobal(L, "peak_handler");
     lua_pushinteger(L, e->index.i +1); // 1-ix'd
-    if( Lua_call_usercode(L, 1, 0) != LUA_OK ){
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 2, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
 
-void L_queue_freq( int id, float freq )
+void L_queue_freq( int id, float freq, int offset )
 {
     event_t e = { .handler = L_handle_freq
                 , .index.i = id
+                , .time    = IO_GetTime() + offset
+                , .timed   = true
                 , .data.f  = freq
                 };
     event_post(&e);
 }
 void L_handle_freq( event_t* e )
 {
+    Detect_t* d = Detect_find_action( e->index.i, L_queue_freq );
+    if( !d ){ return; } // reconfigured since the event
     lua_getglobal(L, "freq_handler");
     lua_pushinteger(L, e->index.i +1); // 1-ix'd
     lua_pushnumber(L, e->data.f);
-    if( Lua_call_usercode(L, 2, 0) != LUA_OK ){
+    lua_pushnumber(L, FTrack_get_confidence( &d->ftrack )); // latest, like in_scale
+    lua_pushinteger(L, (lua_Integer)e->time); // capture time in samples
+    if( Lua_call_usercode(L, 4, 0) != LUA_OK ){
         lua_pop( L, 1 );
     }
 }
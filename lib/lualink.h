@@ -25,13 +25,15 @@ void Lua_load_default_script( void );
 // Event enqueue wrappers
 extern void L_queue_asl_done( int id );
 extern void L_queue_metro( int id, int state );
-extern void L_queue_stream( int id, float state );
-extern void L_queue_change( int id, float state );
-extern void L_queue_window( int id, float window );
-extern void L_queue_volume( int id, float level );
-extern void L_queue_peak( int id, float ignore );
-extern void L_queue_freq( int id, float freq );
-extern void L_queue_in_scale( int id, float note );
+// input detectors. offset is the event's sample within the ADC block
+extern void L_queue_stream( int id, float state, int offset );
+extern void L_queue_change( int id, float state, int offset );
+extern void L_queue_window( int id, float window, int offset );
+extern void L_queue_volume( int id, float level, int offset );
+extern void L_queue_peak( int id, float ignore, int offset );
+extern void L_queue_freq( int id, float freq, int offset );
+extern void L_queue_in_scale( int id, float volts, int offset );
+extern void L_queue_out_note( int id, int note, int octave, float volts );
 extern void L_queue_ii_leadRx( uint8_t address, uint8_t cmd, float data, uint8_t arg );
 extern void L_queue_ii_followRx( void );
 extern void L_queue_clock_resume( int coro_id );
@@ -0,0 +1,140 @@
+#include "route.h"
+
+#include <stdio.h>
+
+#include "stm32f7xx.h" // BLOCK_IRQS
+
+#include "casl.h" // casl_action(), casl_setdynamic()
+
+static Route_t routes[ROUTE_COUNT];
+static volatile int route_count = 0; // routes are packed from 0
+static int input_count  = 0;
+static int output_count = 0;
+
+
+///////////////////////////////////////////
+// init
+
+void Route_init( int inputs, int outputs )
+{
+    input_count  = inputs;
+    output_count = outputs;
+    route_count = 0;
+    for( int i=0; i<ROUTE_COUNT; i++ ){
+        routes[i].type = Rt_none;
+    }
+}
+
+
+/////////////////////////////////////
+// configuration
+
+// fill the route before publishing it to the DSP by bumping route_count
+static Route_t* route_new( int input, int output, Route_type_t type )
+{
+    if( input < 0 || input >= input_count
+     || output < 0 || output >= output_count ){
+        printf("route out of range\n");
+        return NULL;
+    }
+    if( route_count >= ROUTE_COUNT ){
+        printf("no routes left\n");
+        return NULL;
+    }
+    Route_t* r = &routes[route_count];
+    r->type   = type;
+    r->input  = input;
+    r->output = output;
+    return r;
+}
+
+int Route_trigger( int    input
+                 , int    output
+                 , float  threshold
+                 , float  hysteresis
+                 , int8_t direction
+                 , int    held
+                 )
+{
+    Route_t* r = route_new( input, output, Rt_trigger );
+    if( !r ){ return -1; }
+    r->threshold  = threshold;
+    r->hysteresis = hysteresis;
+    r->direction  = direction;
+    r->held       = held;
+    r->state      = false;
+    return route_count++;
+}
+
+int Route_cv( int   input
+            , int   output
+            , int   dynamic
+            , float scale
+            , float offset
+            )
+{
+    Route_t* r = route_new( input, output, Rt_cv );
+    if( !r ){ return -1; }
+    r->dynamic = dynamic;
+    r->scale   = scale;
+    r->offset  = offset;
+    return route_count++;
+}
+
+void Route_clear( int input )
+{
+    BLOCK_IRQS(
+        int kept = 0;
+        for( int i=0; i<route_count; i++ ){
+            if( input >= 0 && routes[i].input != input ){
+                routes[kept++] = routes[i]; // keep packed
+            }
+        }
+        route_count = kept;
+    );
+}
+
+
+/////////////////////////////////////
+// DSP
+
+// matches Asl:action, which sets held{} before restarting or releasing
+static void action( Route_t* r, int direc )
+{
+    if( r->held >= 0 ){ casl_setdynamic( r->output, r->held, (float)direc ); }
+    else if( direc == 0 ){ return; } // nothing to release
+    casl_action( r->output, direc );
+}
+
+static void trigger( Route_t* r, float level )
+{
+    if( r->state ){ // high to low
+        if( level < (r->threshold - r->hysteresis) ){
+            r->state = false;
+            if( r->direction == -1 ){ action( r, 1 ); } // falling edge trigger
+            else if( r->direction == 0 ){ action( r, 0 ); } // gate release
+        }
+    } else { // low to high
+        if( level > (r->threshold + r->hysteresis) ){
+            r->state = true;
+            if( r->direction != -1 ){ action( r, 1 ); }
+        }
+    }
+}
+
+void Route_process( int input, float* in, int size )
+{
+    for( int i=0; i<route_count; i++ ){
+        Route_t* r = &routes[i];
+        if( r->input != input ){ continue; }
+        switch( r->type ){
+            case Rt_trigger:
+                for( int s=0; s<size; s++ ){ trigger( r, in[s] ); }
+                break;
+            case Rt_cv:
+                casl_setdynamic( r->output, r->dynamic, in[size-1] * r->scale + r->offset );
+                break;
+            default: break;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// routes connect inputs directly to asl channels, evaluated in the DSP block
+// so triggers & cv mappings land without a trip through the lua event queue
+
+#define ROUTE_COUNT 8
+
+typedef enum{ Rt_none
+            , Rt_trigger // input edge calls casl_action on an output
+            , Rt_cv      // input level is written to an output dynamic
+} Route_type_t;
+
+typedef struct{
+    Route_type_t type;
+    uint8_t      input;
+    uint8_t      output;
+
+    // trigger
+    float        threshold;
+    float        hysteresis;
+    int8_t       direction; // 1 rising, -1 falling, 0 both (falling releases held{})
+    int          held;      // output's held{} dynamic, or -1
+    bool         state;
+
+    // cv
+    int          dynamic;
+    float        scale;
+    float        offset;
+} Route_t;
+
+
+////////////////////////////////////
+// init
+
+void Route_init( int inputs, int outputs ); // inputs & asl channels that routes may connect
+
+
+/////////////////////////////////////
+// configuration. return the route index, or -1 if all routes are in use
+
+int Route_trigger( int    input
+                 , int    output
+                 , float  threshold
+                 , float  hysteresis
+                 , int8_t direction
+                 , int    held
+                 );
+int Route_cv( int   input
+            , int   output
+            , int   dynamic
+            , float scale
+            , float offset
+            );
+
+// clears all routes from input. -1 clears every route
+void Route_clear( int input );
+
+
+/////////////////////////////////////
+// DSP. call once per block for each input
+// triggers scan every sample of the block. cv follows the latest
+
+void Route_process( int input, float* in, int size );
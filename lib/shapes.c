@@ -1,9 +1,156 @@
 #include "shapes.h"
 
-#include <math.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "caw.h" // Caw_printf
+#include "fastmath.h"
+
+
+//////////////////////////////
+// lookup tables
+
+// only the transcendental shapes are tabled. the polynomial shapes are
+// cheaper to compute directly, and rebound's kinks don't interpolate well
+// each table holds LUT_SIZE segments plus a guard point for interpolation
+// 512 segments keeps worst-case error (expo) around 2e-5 of full scale
+#define LUT_SIZE 512
+
+static float lut_sin[LUT_SIZE+1];
+static float lut_log[LUT_SIZE+1];
+static float lut_exp[LUT_SIZE+1];
+
+typedef struct{
+    int      segments; // 0 if the slot is empty
+    int      refs;     // programs & outputs using the curve
+    uint32_t stamp;    // when last defined or released. unused curves are recycled oldest first
+    float    lut[CURVE_SIZE+1];
+} Curve_t;
+
+static Curve_t curves[CURVE_COUNT];
+static uint32_t curve_clock = 0;
+
+static void lut_fill( float* lut, float (*fn)(float) )
+{
+    for( int i=0; i<=LUT_SIZE; i++ ){
+        lut[i] = fn( (float)i / (float)LUT_SIZE );
+    }
+}
+
+void shapes_init( void )
+{
+    lut_fill( lut_sin, shapes_sin );
+    lut_fill( lut_log, shapes_log );
+    lut_fill( lut_exp, shapes_exp );
+    shapes_curve_clear();
+}
+
+
+//////////////////////////////
+// user curves
+
+// linear interpolation through breakpoints. x is rising
+static float breakpoints( const float* x, const float* y, int count, float in )
+{
+    if( in <= x[0] ){ return y[0]; }
+    for( int i=1; i<count; i++ ){
+        if( in < x[i] ){
+            float span = x[i] - x[i-1];
+            float c = (span > 0.0) ? (in - x[i-1]) / span : 1.0;
+            return y[i-1] + c * (y[i] - y[i-1]);
+        }
+    }
+    return y[count-1];
+}
+
+int shapes_curve_define( const float* x, const float* y, int count )
+{
+    if( count < 2 ){ return -1; }
+
+    Curve_t c;
+    if( x == NULL && count <= CURVE_SIZE+1 ){ // levels fit the table as-is
+        c.segments = count-1;
+        for( int i=0; i<count; i++ ){ c.lut[i] = y[i]; }
+    } else { // resample
+        c.segments = CURVE_SIZE;
+        for( int i=0; i<=CURVE_SIZE; i++ ){
+            float in = (float)i / (float)CURVE_SIZE;
+            if( x ){
+                c.lut[i] = breakpoints( x, y, count, in );
+            } else { // too many levels. treat as evenly spaced breakpoints
+                float f  = in * (float)(count-1);
+                int   ix = (int)f;
+                if( ix >= count-1 ){ c.lut[i] = y[count-1]; continue; }
+                c.lut[i] = y[ix] + (f - (float)ix) * (y[ix+1] - y[ix]);
+            }
+        }
+    }
+
+    size_t bytes = sizeof(float) * (c.segments+1);
+    int slot = -1;
+    for( int i=0; i<CURVE_COUNT; i++ ){
+        Curve_t* k = &curves[i];
+        if( k->segments == c.segments
+         && !memcmp( k->lut, c.lut, bytes ) ){ // reuse an identical curve
+            k->stamp = ++curve_clock;
+            return i;
+        }
+        if( k->segments == 0 ){ // empty
+            if( slot < 0 || curves[slot].segments ){ slot = i; }
+        } else if( k->refs == 0 ){ // unused. recycle the stalest
+            if( slot < 0 || (curves[slot].segments && k->stamp < curves[slot].stamp) ){ slot = i; }
+        }
+    }
+    if( slot < 0 ){
+        printf("ERROR: no curve slots remain\n");
+        Caw_printf("ERROR: no curve slots remain\n");
+        return -1;
+    }
+    // nothing references a recycled slot, so the DSP only reads it if a slope is
+    // still finishing a segment described with the old curve
+    curves[slot].segments = 0;
+    memcpy( curves[slot].lut, c.lut, bytes );
+    curves[slot].segments = c.segments;
+    curves[slot].refs     = 0;
+    curves[slot].stamp    = ++curve_clock;
+    return slot;
+}
+
+static Curve_t* curve_of( int curve )
+{
+    if( curve < 0 || curve >= CURVE_COUNT || curves[curve].segments == 0 ){ return NULL; }
+    return &curves[curve];
+}
+
+void shapes_curve_retain( int curve )
+{
+    Curve_t* k = curve_of( curve );
+    if( k ){ k->refs++; }
+}
+
+void shapes_curve_release( int curve )
+{
+    Curve_t* k = curve_of( curve );
+    if( k && k->refs > 0 ){
+        if( --k->refs == 0 ){ k->stamp = ++curve_clock; }
+    }
+}
+
+int shapes_curve_refs( int curve )
+{
+    if( curve < 0 || curve >= CURVE_COUNT ){ return 0; }
+    return curves[curve].refs;
+}
+
+void shapes_curve_clear( void )
+{
+    for( int i=0; i<CURVE_COUNT; i++ ){
+        curves[i].segments = 0;
+        curves[i].refs     = 0;
+    }
+}
 
-#include "submodules/wrDsp/wrBlocks.h" // for vectorized shapers
 
 //////////////////////////////
 // single sample shapers
@@ -17,17 +164,17 @@
 
 float shapes_sin( float in )
 {
-    return -0.5 * (cosf( M_PI * in ) - 1.0);
+    return -0.5 * (fast_cosf( M_PI * in ) - 1.0);
 }
 
 float shapes_exp( float in )
 {
-    return powf(2.0, 10.0 * (in - 1.0));
+    return fast_exp2f( 10.0 * (in - 1.0) );
 }
 
 float shapes_log( float in )
 {
-    return 1.0 - powf(2.0, -10.0 * in);
+    return 1.0 - fast_exp2f( -10.0 * in );
 }
 
 float shapes_step_now( float in )
@@ -72,37 +219,78 @@ float shapes_ease_out_rebound( float in )
 ////////////////////////////////
 // vectorized shapers
 
-float* shapes_v_sin( float* in, int size )
+// linear interpolation into a table. input is clamped to (0,1)
+static float* lut_v( const float* lut, int segments, float* in, int size )
+{
+    float* io = in;
+    for( int i=0; i<size; i++ ){
+        float f = *io * (float)segments;
+        if( f <= 0.0 ){
+            *io++ = lut[0];
+        } else if( f >= (float)segments ){
+            *io++ = lut[segments];
+        } else {
+            int   ix = (int)f;
+            float c  = f - (float)ix;
+            *io++ = lut[ix] + c * (lut[ix+1] - lut[ix]);
+        }
+    }
+    return in;
+}
+
+float* shapes_v_sin( float* in, int size ){ return lut_v( lut_sin, LUT_SIZE, in, size ); }
+float* shapes_v_log( float* in, int size ){ return lut_v( lut_log, LUT_SIZE, in, size ); }
+float* shapes_v_exp( float* in, int size ){ return lut_v( lut_exp, LUT_SIZE, in, size ); }
+
+float* shapes_v_step_now( float* in, int size )
+{
+    float* io = in;
+    for( int i=0; i<size; i++ ){ *io++ = 1.0; }
+    return in;
+}
+
+float* shapes_v_step_wait( float* in, int size )
+{
+    float* io = in;
+    for( int i=0; i<size; i++ ){
+        *io = (*io < 0.99999) ? 0.0 : 1.0;
+        io++;
+    }
+    return in;
+}
+
+float* shapes_v_ease_in_back( float* in, int size )
 {
-    return b_mul(
-            b_add(
-                b_map( cosf,
-                    b_mul( in, M_PI, size )
-                     , size )
-                 , -1.0
-                 , size )
-                , -0.5
-                , size );
+    float* io = in;
+    for( int i=0; i<size; i++ ){
+        float x = *io;
+        *io++ = x * x * (2.70158 * x - 1.70158);
+    }
+    return in;
 }
 
-static float pow2( float in ){ return powf(2.0,in); }
+float* shapes_v_ease_out_back( float* in, int size )
+{
+    float* io = in;
+    for( int i=0; i<size; i++ ){
+        float x = *io - 1.0;
+        *io++ = x * x * (2.70158 * x + 1.70158) + 1.0;
+    }
+    return in;
+}
 
-float* shapes_v_exp( float* in, int size )
+float* shapes_v_ease_out_rebound( float* in, int size )
 {
-    return b_map( pow2,
-            b_mul(
-                b_add( in, -1.0, size )
-                 , 10.0
-                 , size )
-                , size );
+    float* io = in;
+    for( int i=0; i<size; i++ ){
+        *io = shapes_ease_out_rebound( *io ); // inlined. no transcendentals
+        io++;
+    }
+    return in;
 }
 
-float* shapes_v_log( float* in, int size )
+float* shapes_v_curve( int curve, float* in, int size )
 {
-    return b_sub(
-            b_map( pow2,
-                b_mul( in, -10.0, size )
-                 , size )
-                , 1.0
-                , size );
+    if( curve < 0 || curve >= CURVE_COUNT || curves[curve].segments == 0 ){ return in; } // unknown curves are linear
+    return lut_v( curves[curve].lut, curves[curve].segments, in, size );
 }
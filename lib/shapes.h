@@ -1,5 +1,11 @@
 #pragma once
 
+#include <stdbool.h>
+
+// builds the lookup tables used by the vectorized shapers. call once at boot
+void shapes_init( void );
+
+// exact shapers. used to build the tables & as a reference
 float shapes_sin( float in );
 float shapes_log( float in );
 float shapes_exp( float in );
@@ -9,6 +15,32 @@ float shapes_ease_in_back( float in );
 float shapes_ease_out_back( float in );
 float shapes_ease_out_rebound( float in );
 
+// vectorized shapers. operate in-place over a range of (0,1)
+// linear is the identity so has no kernel
 float* shapes_v_sin( float* in, int size );
 float* shapes_v_log( float* in, int size );
 float* shapes_v_exp( float* in, int size );
+float* shapes_v_step_now( float* in, int size );
+float* shapes_v_step_wait( float* in, int size );
+float* shapes_v_ease_in_back( float* in, int size );
+float* shapes_v_ease_out_back( float* in, int size );
+float* shapes_v_ease_out_rebound( float* in, int size );
+
+// user-defined curves. stored as tables of up to CURVE_SIZE segments
+// a curve maps the (0,1) segment progress to output. 0 is the start level, 1 the destination
+#define CURVE_COUNT 8
+#define CURVE_SIZE  256
+
+// x may be NULL for count levels evenly spaced over (0,1)
+// else (x,y) are breakpoints with x rising from 0 to 1, which are resampled
+// returns the curve index, reusing an identical curve if one exists. -1 on failure
+// a new curve takes an empty slot, or recycles the least recently used unreferenced one
+int shapes_curve_define( const float* x, const float* y, int count );
+void shapes_curve_clear( void ); // forget all curves
+
+// compiled programs & output shapes hold a reference to each curve they use
+// indices of empty slots are ignored, so (shape - SHAPE_Curve) can be passed for any shape
+void shapes_curve_retain( int curve );
+void shapes_curve_release( int curve );
+int shapes_curve_refs( int curve );
+float* shapes_v_curve( int curve, float* in, int size );
@@ -7,14 +7,16 @@
 #include "stm32f7xx.h"
 
 #include "shapes.h"
+#include "fastmath.h"
 #include "submodules/wrDsp/wrBlocks.h"
 
 
 ////////////////////////////////
 // global vars
 
-static uint8_t slope_count = 0;
+static int slope_count = 0;
 static Slope_t* slopes = NULL;
+static Slope_lanes_t lanes;
 
 
 ////////////////////////////////
@@ -24,33 +26,61 @@ static float* step_v( Slope_t* self, float* out, int size );
 
 static float* static_v( Slope_t* self, float* out, int size );
 static float* motion_v( Slope_t* self, float* out, int size );
-static float* breakpoint_v( Slope_t* self, float* out, int size );
+#define MAX_BLOCK 64 // largest block motion4_v renders
+static void motion4_v( int first, float** out, uint8_t active, int size );
+static float breakpoint( Slope_t* self );
 
 static float* shaper_v( Slope_t* self, float* out, int size );
 static float shaper( Slope_t* self, float out );
 
+static float* osc_v( Slope_t* self, float* out, int size );
+
 ////////////////////////////////
 // public definitions
 
 void S_init( int channels )
 {
-    slope_count = channels;
+    shapes_init();
     slopes = malloc( sizeof( Slope_t ) * channels );
-    if( !slopes ){ printf("slopes malloc failed\n"); return; }
-    for( int j=0; j<SLOPE_CHANNELS; j++ ){
+    float* hot = malloc( sizeof( float ) * channels * 5 );
+    if( !slopes || !hot ){ printf("slopes malloc failed\n"); return; }
+    lanes.here      = &hot[0*channels];
+    lanes.delta     = &hot[1*channels];
+    lanes.countdown = &hot[2*channels];
+    lanes.scale     = &hot[3*channels];
+    lanes.last      = &hot[4*channels];
+    slope_count = channels;
+    for( int j=0; j<slope_count; j++ ){
         slopes[j].index  = j;
         slopes[j].dest   = 0.0;
-        slopes[j].last   = 0.0;
         slopes[j].shape  = SHAPE_Linear;
         slopes[j].action = NULL;
-
-        slopes[j].here   = 0.0;
-        slopes[j].delta  = 0.0;
-        slopes[j].countdown = -1.0;
-        slopes[j].scale = 0.0;
+        slopes[j].in_callback = false;
+
+        lanes.here[j]      = 0.0;
+        lanes.delta[j]     = 0.0;
+        lanes.countdown[j] = -1.0;
+        lanes.scale[j]     = 0.0;
+        lanes.last[j]      = 0.0;
+
+        slopes[j].shaped = 0.0;
+        slopes[j].settled = false;
+        slopes[j].samples_per_ms = SAMPLES_PER_MS;
+
+        slopes[j].osc   = false;
+        slopes[j].wave  = WAVE_Sine;
+        slopes[j].phase = 0.0;
+        slopes[j].inc   = 0.0;
+        slopes[j].level = 0.0;
     }
 }
 
+void S_set_sample_rate( int index, float sample_rate )
+{
+    if( index < 0 || index >= slope_count ){ return; }
+    slopes[index].samples_per_ms = sample_rate / 1000.0;
+}
+
 Shape_t S_str_to_shape( const char* s )
 {
     char ps = (char)*s;
@@ -68,13 +98,34 @@ Shape_t S_str_to_shape( const char* s )
     }
 }
 
+Wave_t S_str_to_wave( const char* s )
+{
+    char ps = (char)*s;
+    if( ps < 0x61 ){ ps += 0x20; } // convert upper to lowercase
+    switch( ps ){
+        case 't': return WAVE_Tri;
+        case 'p': return WAVE_Square; // pulse
+        case 's':
+            if( s[1]=='a' || s[1]=='A' ){ return WAVE_Saw; }
+            if( s[1]=='q' || s[1]=='Q' ){ return WAVE_Square; }
+            // else flows through
+        default: return WAVE_Sine; // unmatched
+    }
+}
+
 float S_get_state( int index )
 {
-    if( index < 0 || index >= SLOPE_CHANNELS ){ return 0.0; }
+    if( index < 0 || index >= slope_count ){ return 0.0; }
     Slope_t* self = &slopes[index]; // safe pointer
     return self->shaped;
 }
 
+bool S_is_settled( int index )
+{
+    if( index < 0 || index >= slope_count ){ return false; }
+    return slopes[index].settled;
+}
+
 // register a new destination
 void S_toward( int        index
              , float      destination
@@ -83,148 +134,250 @@ void S_toward( int        index
              , Callback_t cb
              )
 {
-    if( index < 0 || index >= SLOPE_CHANNELS ){ return; }
+    if( index < 0 || index >= slope_count ){ return; }
     Slope_t* self = &slopes[index]; // safe pointer
 
     // update destination
     self->dest   = destination;
     self->shape  = shape;
     self->action = cb;
+    self->settled = false;
+    self->osc    = false; // leave oscillator mode from current output level
 
-    // direct update & callback if ms = 0 (ie instant)
+    // direct update if ms = 0 (ie instant)
     if( ms <= 0.0 ){
-        self->last      = self->dest;
-        self->shaped    = self->dest;
-        self->scale     = 0.0;
-        self->here      = 1.0; // hard set to end of range
-        if(self->countdown > 0.0){
+        self->action       = NULL; // caller continues synchronously
+        self->shaped       = self->dest;
+        lanes.last[index]  = self->dest;
+        lanes.scale[index] = 0.0;
+        lanes.here[index]  = 1.0; // hard set to end of range
+        if(lanes.countdown[index] > 0.0){
             // only happens when assynchronously updating S_toward
-            self->countdown = -0.0; // inactive.
+            lanes.countdown[index] = -0.0; // inactive.
         }
     } else {
         // save current output level as new starting point
-        self->last   = self->shaped;
-        self->scale  = self->dest - self->last;
+        lanes.last[index]  = self->shaped;
+        lanes.scale[index] = self->dest - lanes.last[index];
         float overflow = 0.0;
-        if( self->countdown < 0.0 && self->countdown > -1023.0 ){
-            overflow = -(self->countdown);
+        if( self->in_callback && lanes.countdown[index] < 0.0 ){
+            // chained from the breakpoint. an async retarget starts fresh instead
+            // of jumping ahead by the time since the last segment ended
+            overflow = -(lanes.countdown[index]);
         }
-        self->countdown = ms * SAMPLES_PER_MS; // samples until callback
-        self->delta     = 1.0 / self->countdown;
-        self->here      = 0.0; // start of slope
-        if( overflow > 0.0 ){
-            self->here += overflow * self->delta;
-            self->countdown -= overflow;
-            if( self->countdown <= 0.0 ){ // guard against overflow hitting callback
-                printf("FIXME near immediate callback\n");
-                // FIXME this should apply the destination & call self->action
-                self->countdown = 0.00001; // force callback on next sample
-                self->here = 1.0; // set to destination
+        lanes.countdown[index] = ms * self->samples_per_ms; // samples until callback
+        lanes.delta[index] = 1.0 / lanes.countdown[index];
+        lanes.here[index]  = 0.0; // start of slope
+        if( overflow > 0.0 ){ // carry the previous segment's overshoot
+            lanes.here[index] += overflow * lanes.delta[index];
+            lanes.countdown[index] -= overflow;
+            if( lanes.countdown[index] <= 0.0 ){ // overshoot consumed the whole segment
+                lanes.here[index] = 1.0; // at destination. step_v applies the callback
             }
         }
     }
 }
 
+void S_oscillate( int    index
+                , float  freq
+                , float  level
+                , Wave_t wave
+                )
+{
+    if( index < 0 || index >= slope_count ){ return; }
+    Slope_t* self = &slopes[index]; // safe pointer
+
+    if( !self->osc ){ self->phase = 0.0; } // fresh start. retune keeps phase
+    self->osc     = true;
+    self->wave    = wave;
+    self->level   = level;
+    self->action  = NULL;
+    self->settled = false;
+
+    float inc = freq / (self->samples_per_ms * 1000.0);
+    if( inc < 0.0 ){ inc = 0.0; }
+    if( inc > 0.49 ){ inc = 0.49; } // keep below nyquist so the blep windows don't overlap
+    self->inc = inc;
+
+    lanes.countdown[index] = -1024.0; // no overshoot to carry into a later S_toward
+}
+
 float* S_step_v( int     index
                , float*  out
                , int     size
                )
 {
     // turn index into pointer
-    if( index < 0 || index >= SLOPE_CHANNELS ){ return out; }
+    if( index < 0 || index >= slope_count ){ return out; }
     Slope_t* self = &slopes[index]; // safe pointer
 
     return step_v( self, out, size );
 }
 
+void S_step4_v( int      first
+              , float**  out
+              , uint8_t  skip
+              , int      size
+              )
+{
+    if( first < 0 || first+4 > slope_count ){ return; }
+
+    // lanes without a breakpoint this block share the 4-wide kernel
+    // everything else (or any block too big for its scratch) is stepped individually
+    uint8_t kernel = 0;
+    for( int c=0; c<4; c++ ){
+        if( skip & (1<<c) ){ continue; }
+        if( size <= MAX_BLOCK && lanes.countdown[first+c] > (float)size ){
+            kernel |= 1<<c;
+        } else {
+            step_v( &slopes[first+c], out[c], size );
+        }
+    }
+    if( kernel ){
+        motion4_v( first, out, kernel, size );
+        for( int c=0; c<4; c++ ){
+            if( kernel & (1<<c) ){ shaper_v( &slopes[first+c], out[c], size ); }
+        }
+    }
+}
+
 
 ///////////////////////
 // private defns
 
+// max callbacks serviced in a single sample before deferring to the next
+#define BREAKPOINT_LIMIT 16
+
 static float* step_v( Slope_t* self
                     , float*   out
                     , int      size
                     )
 {
-    if( self->countdown <= 0.0 ){ // at destination
-        static_v( self, out, size );
-    } else if( self->countdown > (float)size ){ // no edge case
-        motion_v( self, out, size );
-    } else {
-        breakpoint_v( self, out, size );
+    if( self->osc ){ return osc_v( self, out, size ); }
+
+    int ix = self->index;
+    float* o = out;
+    int remain = size;
+    while( remain > 0 ){
+        if( lanes.countdown[ix] <= 0.0 ){
+            if( self->action == NULL ){ // at destination
+                static_v( self, o, remain );
+                break;
+            }
+            // segment already complete (near-immediate or deferred callback)
+            lanes.countdown[ix] -= 1.0;
+            *o++ = breakpoint( self );
+            remain--;
+        } else if( lanes.countdown[ix] > (float)remain ){ // no edge case
+            motion_v( self, o, remain );
+            break;
+        } else { // breakpoint lands in this block
+            int pre = (int)ceilf( lanes.countdown[ix] ) - 1; // samples before breakpoint
+            if( pre > 0 ){
+                motion_v( self, o, pre );
+                o      += pre;
+                remain -= pre;
+            }
+            lanes.here[ix] += lanes.delta[ix];
+            lanes.countdown[ix] -= 1.0; // now (-1,0]: fraction of a sample past breakpoint
+            *o++ = breakpoint( self );
+            remain--;
+        }
     }
     return out;
 }
 
 static float* static_v( Slope_t* self, float* out, int size )
 {
+    int ix = self->index;
     float* out2 = out;
     for( int i=0; i<size; i++ ){
-        *out2++ = self->here;
+        *out2++ = lanes.here[ix];
     }
-    if( self->countdown > -1024.0 ){ // count overflow samples
-        self->countdown -= (float)size;
+    if( lanes.countdown[ix] > -1024.0 ){ // count samples at rest
+        lanes.countdown[ix] -= (float)size;
+    } else { // at rest long enough. output is fixed until S_toward
+        self->settled = true;
     }
     return shaper_v( self, out, size );
 }
 
 static float* motion_v( Slope_t* self, float* out, int size )
 {
+    int ix = self->index;
     float* out2 = out;
     float* out3 = out;
 
-    if( self->scale == 0.0 || self->delta == 0.0 ){ // delay only
+    if( lanes.scale[ix] == 0.0 || lanes.delta[ix] == 0.0 ){ // delay only
         for( int i=0; i<size; i++ ){
-            *out2++ = self->here;
+            *out2++ = lanes.here[ix];
         }
     } else { // WARN: requires size >= 1
-        *out2++ = self->here + self->delta;
+        *out2++ = lanes.here[ix] + lanes.delta[ix];
         for( int i=1; i<size; i++ ){
-            *out2++ = *out3++ + self->delta;
+            *out2++ = *out3++ + lanes.delta[ix];
         }
     }
-    self->countdown -= (float)size;
-    self->here = out[size-1];
+    lanes.countdown[ix] -= (float)size;
+    lanes.here[ix] = out[size-1];
     return shaper_v( self, out, size );
 }
 
-static float* breakpoint_v( Slope_t* self, float* out, int size )
+// motion_v across 4 neighbouring channels at once. lanes not in active are
+// rendered into scratch & discarded, so the loop is always 4 independent
+// accumulators, keeping the FPU pipeline full (and vectorizable on hosts)
+// results match motion_v exactly: each lane is the same running sum
+// requires size <= MAX_BLOCK
+static void motion4_v( int first, float** out, uint8_t active, int size )
 {
-    if( size <= 0 ){ return out; }
-
-    self->here += self->delta; // no collision can happen on first samp
-
-    self->countdown -= 1.0;
-    if( self->countdown <= 0.0 ){
-        // TODO unroll overshoot and apply proportionally to the post-*act sample
-        self->here = 1.0; // clamp for overshoot
-        if( self->action != NULL ){
-            Callback_t act = self->action;
-            self->action = NULL;
-            self->shaped = self->dest; // save real destination into shaped to actually reach it
-            (*act)(self->index);
-            // side-affects: self->{dest, shape, action, countdown, delta, (here)}
-        }
-        if( self->action != NULL ){ // instant callback
-            *out++ = shaper( self, self->here );
-            // 1. unwind self->countdown (ADD it to countdown)
-            // 2. recalc current sample with new slope
-            // 3. below call should be on out[0] and size
-            if(size > 1){
-                return step_v( self, out, size-1 );
-            } else { // handle breakpoint on last sample of frame
-                return out;
-            }
-        } else { // slope complete, or queued response
-            self->here  = 1.0;
-            self->delta = 0.0;
-            *out++ = shaper( self, self->here );
-            return static_v( self, out, size-1 );
-        }
-    } else {
-        *out++ = shaper( self, self->here );
-        return breakpoint_v( self, out, size-1 ); // recursive call
+    static float scratch[MAX_BLOCK];
+
+    float* o[4];
+    float  h[4];
+    float  d[4];
+    for( int c=0; c<4; c++ ){
+        int ix = first + c;
+        bool on = active & (1<<c);
+        o[c] = on ? out[c] : scratch;
+        h[c] = lanes.here[ix];
+        d[c] = ( !on || lanes.scale[ix] == 0.0 || lanes.delta[ix] == 0.0 )
+                    ? 0.0 // delay only
+                    : lanes.delta[ix];
+    }
+    for( int i=0; i<size; i++ ){
+        h[0] += d[0]; o[0][i] = h[0];
+        h[1] += d[1]; o[1][i] = h[1];
+        h[2] += d[2]; o[2][i] = h[2];
+        h[3] += d[3]; o[3][i] = h[3];
+    }
+    for( int c=0; c<4; c++ ){
+        if( !(active & (1<<c)) ){ continue; }
+        lanes.here[first+c] = h[c];
+        lanes.countdown[first+c] -= (float)size;
+    }
+}
+
+// service callbacks for segment(s) ending in the current sample
+// overshoot is left in countdown for S_toward to carry into the next segment
+static float breakpoint( Slope_t* self )
+{
+    int ix = self->index;
+    int limit = BREAKPOINT_LIMIT;
+    while( lanes.countdown[ix] <= 0.0 && self->action != NULL && limit-- > 0 ){
+        Callback_t act = self->action;
+        self->action = NULL;
+        lanes.here[ix]   = 1.0; // clamp to end of segment
+        self->shaped = self->dest; // save real destination into shaped to actually reach it
+        self->in_callback = true;
+        (*act)(self->index);
+        self->in_callback = false;
+        // side-affects: self->{dest, shape, action, countdown, delta, (here)}
     }
+    if( lanes.countdown[ix] <= 0.0 && self->action == NULL ){ // slope complete, or queued response
+        lanes.here[ix]  = 1.0;
+        lanes.delta[ix] = 0.0;
+    }
+    return shaper( self, lanes.here[ix] );
 }
 
 
@@ -234,26 +387,29 @@ static float* breakpoint_v( Slope_t* self, float* out, int size )
 // vectors for optimized segments (assume: self->shape is constant)
 static float* shaper_v( Slope_t* self, float* out, int size )
 {
+    int ix = self->index;
     switch( self->shape ){
-        case SHAPE_Sine:    out = shapes_v_sin( out, size ); break;
-        case SHAPE_Log:     out = shapes_v_log( out, size ); break;
-        case SHAPE_Expo:    out = shapes_v_exp( out, size ); break;
+        case SHAPE_Sine:    shapes_v_sin( out, size ); break;
+        case SHAPE_Log:     shapes_v_log( out, size ); break;
+        case SHAPE_Expo:    shapes_v_exp( out, size ); break;
+        case SHAPE_Now:     shapes_v_step_now( out, size ); break;
+        case SHAPE_Wait:    shapes_v_step_wait( out, size ); break;
+        case SHAPE_Over:    shapes_v_ease_out_back( out, size ); break;
+        case SHAPE_Under:   shapes_v_ease_in_back( out, size ); break;
+        case SHAPE_Rebound: shapes_v_ease_out_rebound( out, size ); break;
         case SHAPE_Linear: break;
-        default: { // if no vector, use single-sample
-            float* out2 = out;
-            for( int i=0; i<size; i++ ){
-                *out2 = shaper( self, *out2 );
-                out2++;
+        default: // user curves
+            if( self->shape >= SHAPE_Curve ){
+                shapes_v_curve( (int)self->shape - SHAPE_Curve, out, size );
             }
-            // shaper() cleans up self->shaped etc
-            return out; }
+            break;
     }
     // map to output range
     b_add(
        b_mul( out
-            , self->scale
+            , lanes.scale[ix]
             , size )
-         , self->last
+         , lanes.last[ix]
          , size );
     // save last state
     self->shaped = out[size-1];
@@ -261,22 +417,84 @@ static float* shaper_v( Slope_t* self, float* out, int size )
 }
 
 // single sample for breakpoint segment
+// uses the vector path so both share the same tables
 static float shaper( Slope_t* self, float out )
 {
-    switch( self->shape ){
-        case SHAPE_Sine:    out = shapes_sin( out ); break;
-        case SHAPE_Log:     out = shapes_log( out ); break;
-        case SHAPE_Expo:    out = shapes_exp( out ); break;
-        case SHAPE_Now:     out = shapes_step_now( out ); break;
-        case SHAPE_Wait:    out = shapes_step_wait( out ); break;
-        case SHAPE_Over:    out = shapes_ease_out_back( out ); break;
-        case SHAPE_Under:   out = shapes_ease_in_back( out ); break;
-        case SHAPE_Rebound: out = shapes_ease_out_rebound( out ); break;
-        case SHAPE_Linear: default: break; // Linear falls through
+    shaper_v( self, &out, 1 );
+    return out;
+}
+
+
+///////////////////////////////
+// oscillator
+
+// polynomial band-limited step & ramp residuals (2 sample window)
+// t is phase in [0,1), dt is phase increment per sample
+static inline float blep( float t, float dt )
+{
+    if( t < dt ){
+        t /= dt;
+        return t+t - t*t - 1.0;
+    } else if( t > 1.0 - dt ){
+        t = (t - 1.0) / dt;
+        return t*t + t+t + 1.0;
     }
-    // map to output range
-    out = (out * self->scale) + self->last;
-    // save last state
-    self->shaped = out;
+    return 0.0;
+}
+
+static inline float blamp( float t, float dt )
+{
+    if( t < dt ){
+        t = t/dt - 1.0;
+        return -t*t*t * (1.0/3.0);
+    } else if( t > 1.0 - dt ){
+        t = (t - 1.0)/dt + 1.0;
+        return t*t*t * (1.0/3.0);
+    }
+    return 0.0;
+}
+
+static inline float wrap1( float t ){ return (t >= 1.0) ? t - 1.0 : t; }
+
+// waves are phase aligned with sine: positive half-cycle first
+static float* osc_v( Slope_t* self, float* out, int size )
+{
+    float ph  = self->phase;
+    float dt  = self->inc;
+    float lvl = self->level;
+    switch( self->wave ){
+        case WAVE_Tri:
+            for( int i=0; i<size; i++ ){
+                float t = wrap1( ph + 0.25 ); // corners at t=0 & t=0.5
+                float y = 1.0 - 4.0*fabsf( t - 0.5 );
+                y += 4.0 * dt * ( blamp( t, dt ) - blamp( wrap1( t + 0.5 ), dt ) );
+                out[i] = lvl * y;
+                ph = wrap1( ph + dt );
+            }
+            break;
+        case WAVE_Saw:
+            for( int i=0; i<size; i++ ){
+                float t = wrap1( ph + 0.5 ); // reset at t=0
+                out[i] = lvl * ( t+t - 1.0 - blep( t, dt ) );
+                ph = wrap1( ph + dt );
+            }
+            break;
+        case WAVE_Square:
+            for( int i=0; i<size; i++ ){
+                float y = (ph < 0.5) ? 1.0 : -1.0;
+                y += blep( ph, dt ) - blep( wrap1( ph + 0.5 ), dt );
+                out[i] = lvl * y;
+                ph = wrap1( ph + dt );
+            }
+            break;
+        case WAVE_Sine: default:
+            for( int i=0; i<size; i++ ){
+                out[i] = lvl * fast_cosf( 6.2831853 * (ph - 0.25) );
+                ph = wrap1( ph + dt );
+            }
+            break;
+    }
+    self->phase  = ph;
+    self->shaped = out[size-1];
     return out;
 }
@@ -1,8 +1,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
-// need an Init() fn. send SR as an argument
+// default rate. channels can be slowed with S_set_sample_rate
 #define SAMPLE_RATE 48000
 #define iSAMPLE_RATE (1.0/(float)SAMPLE_RATE)
 #define SAMPLES_PER_MS ((float)SAMPLE_RATE/1000.0)
@@ -16,47 +17,82 @@ typedef enum{ SHAPE_Linear
             , SHAPE_Over
             , SHAPE_Under
             , SHAPE_Rebound
+            , SHAPE_Curve // user curve n is SHAPE_Curve+n
 } Shape_t;
 
+// oscillator mode waveforms
+typedef enum{ WAVE_Sine
+            , WAVE_Tri
+            , WAVE_Saw
+            , WAVE_Square
+} Wave_t;
+
 typedef void (*Callback_t)(int channel);
 
+// per-sample state is kept struct-of-arrays, indexed by channel
+// so neighbouring channels can be stepped together
+typedef struct{
+    // FIXME: rename to fade
+    float* here;      // current interp (0,1)
+    // FIXME: rename delta to inc
+    float* delta;     // increment per sample
+    float* countdown; // samples until breakpoint
+    float* scale;     // dest - last
+    float* last;      // previous dest
+} Slope_lanes_t;
+
 typedef struct{
     int         index;
     // destination
     float       dest;
-    float       last; // previous dest
     Shape_t     shape;
     Callback_t  action;
-    // state
-    // FIXME: rename to fade
-    float       here;      // current interp (0,1)
-    // FIXME: rename delta to inc
-    float       delta;     // increment per sample
-    float       countdown; // samples until breakpoint
+    bool        in_callback; // action is running, so S_toward carries the overshoot
 
-    // pre-calcd
-    float scale; // dest - last
     float shaped; // current shaped output voltage
-} Slope_t;
+    float samples_per_ms; // render rate of this channel
+    bool  settled; // at rest & output won't change until next S_toward
 
-#define SLOPE_CHANNELS 4
+    // oscillator mode. free-runs until the next S_toward
+    bool   osc;
+    Wave_t wave;
+    float  phase; // [0,1)
+    float  inc;   // phase increment per sample
+    float  level; // peak amplitude
+} Slope_t;
 
-// refactor for dynamic SLOPE_CHANNELS
-// refactor for dynamic SAMPLE_RATE
 // refactor to S_init returning pointers, but internally tracking indexes?
 
 void S_init( int channels );
+void S_set_sample_rate( int index, float sample_rate );
 
 Shape_t S_str_to_shape( const char* s );
+Wave_t S_str_to_wave( const char* s );
 
 float S_get_state( int index );
+bool S_is_settled( int index );
 void S_toward( int        index
              , float      destination
              , float      ms
              , Shape_t    shape
              , Callback_t cb
              );
+// start (or retune) a band-limited oscillator. output swings +/-level
+// the phase is kept when retuning so dynamics can sweep freq & level smoothly
+void S_oscillate( int    index
+                , float  freq
+                , float  level
+                , Wave_t wave
+                );
 float* S_step_v( int     index
                , float*  out
                , int     size
                );
+
+// steps channels first..first+3 together. out[n] is the buffer for first+n
+// channels set in skip are left untouched
+void S_step4_v( int      first
+              , float**  out
+              , uint8_t  skip
+              , int      size
+              );
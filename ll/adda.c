@@ -55,6 +55,7 @@ void ADDA_BlockProcess( uint32_t* dac_pickle_ptr )
     DAC_PickleBlock( dac_pickle_ptr
                    , b.out[0]
                    , ADDA_BLOCK_SIZE
+                   , b.held
                    );
 }
 
@@ -10,6 +10,7 @@ typedef struct{
     float    in[ ADDA_ADC_CHAN_COUNT][ADDA_BLOCK_SIZE];
     float    out[ADDA_DAC_CHAN_COUNT][ADDA_BLOCK_SIZE];
     uint16_t size;
+    uint8_t  held; // bitmask of outputs holding a constant level in out[n][0]
 } IO_block_t;
 
 uint16_t ADDA_Init( int adc_timer_ix );
@@ -21,6 +21,12 @@ uint32_t* samples = NULL;
 float dac_calibrated_offset[DAC_CHANNELSS];
 float dac_calibrated_scalar[DAC_CHANNELSS];
 
+// SPI command for each channel, pre-shifted into its byte of the DMA word
+static uint32_t dac_header[DAC_CHANNELSS];
+
+// per ping-pong half: bitmask of held channels whose packed words are current
+static volatile uint8_t dac_cached[DAC_BUFFER_COUNT];
+
 void DAC_Init( uint16_t bsize, uint8_t chan_count )
 {
     // Create the sample buffer for DMA transfer
@@ -60,13 +66,15 @@ void DAC_Init( uint16_t bsize, uint8_t chan_count )
 void DAC_Start(void)
 {
     // prepare SPI packet metadata
+    for( int j=0; j<DAC_CHANNELSS; j++ ){
+        uint8_t cmd = (j == 3)
+                        ? DAC8565_SET_AND_UPDATE | 3 << 1
+                        : DAC8565_PREP_ONE | j << 1;
+        dac_header[j] = (uint32_t)cmd << 8; // byte 1
+    }
     uint32_t* dbuf = samples;
     for( uint16_t i=0; i<samp_count; i++ ){
-        uint8_t* addr_ptr = ((uint8_t*)dbuf) + 1;
-        *addr_ptr = (i%4 == 3)
-                        ? DAC8565_SET_AND_UPDATE | 3 << 1
-                        : DAC8565_PREP_ONE | (i%4) << 1;
-        dbuf++;
+        *dbuf++ = dac_header[i%4];
     }
 
     // set all channels to 0v (0xAAAA)
@@ -89,14 +97,25 @@ void DAC_Start(void)
     if(error){ printf("i2s failed to start\n"); }
 }
 
+static void invalidate_cache( uint8_t channel )
+{
+    BLOCK_IRQS(
+        for( int h=0; h<DAC_BUFFER_COUNT; h++ ){
+            dac_cached[h] &= ~(1 << channel);
+        }
+    );
+}
+
 void DAC_CalibrateScalar( uint8_t channel, float scale )
 {
     dac_calibrated_scalar[channel] = DAC_V_TO_U16 * scale;
+    invalidate_cache( channel );
 }
 
 void DAC_CalibrateOffset( uint8_t channel, float volts )
 {
     dac_calibrated_offset[channel] = volts;
+    invalidate_cache( channel );
 }
 
 int32_t lim_i32_u16( int32_t v )
@@ -104,49 +123,49 @@ int32_t lim_i32_u16( int32_t v )
     return (v > (int32_t)(uint16_t)0xFFFF) ? 0xFFFF : (v < (int32_t)0) ? 0 : v;
 }
 
+static inline uint32_t pack( uint8_t channel, float volts )
+{
+    float v = (volts + dac_calibrated_offset[channel])
+                * dac_calibrated_scalar[channel]; // scale volts up to u16
+    uint32_t u = (uint32_t)lim_i32_u16( DAC_ZERO_VOLTS - (int32_t)v );
+    // byte0 = MSB, byte1 = header, byte3 = LSB
+    return (u >> 8) | dac_header[channel] | ((u & 0xFF) << 24);
+}
+
 /* Does all the work converting a generic representation into serial packets
  * Convert floats (representing volts) to u16 representation
  * Interleave a block of each channel into a stream
+ * Single pass: calibrate, clamp & pack each sample straight into its DMA word
+ * Held channels only provide unpickled_data[0], and are skipped entirely once
+ * this half of the buffer already contains their packed level
  * */
 void DAC_PickleBlock( uint32_t* dac_pickle_ptr
                     , float*    unpickled_data
                     , uint16_t  bsize
+                    , uint8_t   held
                     )
 {
+    int half = (dac_pickle_ptr == samples) ? 0 : 1;
     for( uint8_t j=0; j<4; j++ ){
-        add_vf_f( &(unpickled_data[j*bsize])
-                , dac_calibrated_offset[j]
-                , &(unpickled_data[j*bsize])
-                , bsize
-                );
-    }
-    for( uint8_t j=0; j<4; j++ ){
-        mul_vf_f( &(unpickled_data[j*bsize])
-                , dac_calibrated_scalar[j] // scale volts up to u16
-                , bsize
-                );
-    }
-
-    uint16_t usixteens[bsize * 4];
-    uint16_t* usixp = usixteens;
-
-    for( uint16_t i=0; i<bsize; i++ ){
-        for( uint8_t j=0; j<4; j++ ){
-            *usixp++ = (uint16_t)lim_i32_u16( DAC_ZERO_VOLTS
-                                   //- (int32_t)(*u[j]++)
-                                   - (int32_t)(unpickled_data[i+j*bsize])
-                                 );
+        uint8_t   bit = 1 << j;
+        uint32_t* dst = &dac_pickle_ptr[j];
+        float*    src = &unpickled_data[j*bsize];
+        if( held & bit ){
+            if( dac_cached[half] & bit ){ continue; } // already in the buffer
+            uint32_t w = pack( j, *src );
+            for( uint16_t i=0; i<bsize; i++ ){
+                *dst = w;
+                dst += 4;
+            }
+            dac_cached[half] |= bit;
+        } else {
+            for( uint16_t i=0; i<bsize; i++ ){
+                *dst = pack( j, *src++ );
+                dst += 4;
+            }
+            dac_cached[half] &= ~bit;
         }
     }
-
-    uint8_t* insert_p = (uint8_t*)dac_pickle_ptr;
-    usixp = usixteens;
-
-    for( uint16_t i=0; i<(bsize*4); i++ ){
-        *insert_p = *usixp>>8;
-        insert_p += 3;
-        *insert_p++ = *usixp++ & 0xFF;
-    }
 }
 
 
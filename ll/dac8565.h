@@ -58,6 +58,7 @@ void DAC_CalibrateOffset( uint8_t channel, float volts );
 void DAC_PickleBlock( uint32_t* dac_pickle_ptr
                     , float*    unpickled_data
                     , uint16_t  bsize
+                    , uint8_t   held
                     );
 
 void I2Sx_DMA_TX_IRQHandler(void);
@@ -2,7 +2,16 @@ local Asl = {}
 
 local Dynmt = {
     __newindex = function(self, k, v) casl_setdynamic(self.id, self._names[k], v) end,
-    __index = function(self, k) return casl_getdynamic(self.id, self._names[k]) end
+    __index = function(self, k) return casl_getdynamic(self.id, self._names[k]) end,
+    -- usage: myasl.dyn{attack=0.1, release=2} -- updates together, so no stage sees half the change
+    __call = function(self, t)
+        local batch = {}
+        for k,v in pairs(t) do
+            local ix = self._names[k]
+            if ix then batch[ix] = v end -- unknown names are ignored
+        end
+        casl_setdynamics(self.id, batch)
+    end,
 }
 
 function Asl.new(id)
@@ -21,7 +30,11 @@ function Asl.link(self, tab)
             return v(self, tab[2]) -- call compiler fn with self & return new table
             -- early return bc fn must be in the first position, and consumes following arg
         elseif typ == 'table' then
-            t2[k] = Asl.link(self, v) -- link nested tables (won't copy unchanged tables)
+            if sequins and sequins.is_sequins(v) then
+                t2[k] = Asl.seq_compiler(v) -- stepped in C
+            else
+                t2[k] = Asl.link(self, v) -- link nested tables (won't copy unchanged tables)
+            end
         else
             t2[k] = v -- copy value into new table
         end
@@ -56,6 +69,14 @@ function Asl:action(direc)
 end
 
 
+-- memory is shared by all asl channels. returns a table of used & _max counts
+-- usage: asl.usage() for totals, or asl.usage(n) for channel n
+function Asl.usage(id) return casl_usage(id) end
+
+-- seed rand & gauss for a repeatable sequence. no arg reseeds from the hardware RNG
+function Asl.seed(n) casl_seed(n) end
+
+
 function Asl.dyn_compiler(self, d)
     -- register a dynamic pair {name=default}, and return a reference to it
     local elem, typ = d, 'DYN'
@@ -70,6 +91,25 @@ function Asl.dyn_compiler(self, d)
 end
 
 
+-- a sequins is copied into the asl & stepped in C, so it runs without lua
+-- supports literal numbers, step, every, times & count (not nesting or map)
+-- it restarts whenever the asl is described
+function Asl.seq_compiler(s)
+    local function num(v, what)
+        if type(v) ~= 'number' then error('asl sequins '..what..' must be a number') end
+        return v
+    end
+    local function flow(k)
+        local f = s.flw[k]
+        return f and num(f.n, k) or 0
+    end
+    if s.fun[1] then error('asl sequins cannot use map or math') end
+    local data = {}
+    for i=1,s.length do data[i] = num(s.data[i], 'values') end
+    return {'SEQ', data, num(s.n, 'step'), flow'every', flow'times', flow'count'}
+end
+
+
 -- metatables
 Asl.__index = function(self, ix)
     if     ix == 'describe' then return Asl.describe
@@ -84,6 +124,22 @@ function to(volts, time, shape)
     return {'TO', volts or 0.0, time or 1.0, shape or 'linear'}
 end
 
+-- free-running band-limited oscillator. holds until the next action
+-- freq & level can be dyns for live modulation. wave: 'sine', 'tri', 'saw', 'square'
+function vco(freq, level, wave)
+    return {'VCO', freq or 1.0, level or 5.0, wave or 'sine'}
+end
+
+-- user-defined shape. usage: to(5, 1, curve{0, 0.8, 0.3, 1})
+-- levels are evenly spaced over the segment. 0 is the start level & 1 the destination
+-- or as {x,y} breakpoints: curve{{0,0}, {0.1,0.9}, {1,1}}
+-- a slot is recycled once no output's action or shape uses the curve
+function curve(t)
+    local ix = shape_defcurve(t)
+    if ix < 0 then return 'linear' end -- out of curve slots
+    return {'CURVE', ix}
+end
+
 function loop(t)
     table.insert(t,{'RECUR'})
     return t
@@ -161,6 +217,17 @@ function mutable(n)
 end
 
 
+-- random values, drawn each time the stage runs
+-- usage: to(rand(0,5), rand(0.1,1)) -- uniform between lo & hi. rand(n) is 0..n, rand() is 0..1
+-- usage: to(gauss(0, 0.2), 1) -- normal distribution with mean & deviation
+-- args can be dyns or math, eg: rand(0, dyn{spread=2})
+function rand(lo, hi)
+    if hi == nil then lo, hi = 0, lo or 1 end
+    return Asl.math{'RAND', lo, hi}
+end
+function gauss(mean, dev) return Asl.math{'GAUSS', mean or 0, dev or 1} end
+
+
 -- composite constructs
 
 function Asl._while(pred, t) return loop( Asl._if(pred, t)) end
@@ -51,12 +51,13 @@ function ii.get( address, cmd, ... )
     else ii_lead( address, cmd, ... ) end
 end
 
-function ii_LeadRx_handler( addr, cmd, _arg, data )
+function ii_LeadRx_handler( addr, cmd, _arg, data, time )
     if ii.event_raw(addr, cmd, data, _arg) then return end
     local dev, name, addrix = c_ii_cmd(addr,cmd)
     local rx_event = { name   = name
                      , device = addrix
                      , arg    = _arg
+                     , time   = time -- capture time in samples
                      }
     ii[dev].event(rx_event, data)
 end
@@ -9,6 +9,7 @@ Input.inputs = {1,2}
 function Input.new( chan )
     local i = { channel    = chan
               , _mode      = 'none'
+              , _chain     = {} -- params of each detector chained after _mode
               , time       = 0.1
               , threshold  = 1.0
               , hysteresis = 0.1
@@ -45,12 +46,37 @@ function Input:get_value()
     return io_get_input( self.channel )
 end
 
+Input.CHAIN = 4 -- detectors per input. DETECT_CHAIN in detect.h
+
 function Input:set_mode( mode, ... )
+    for slot=2,#self._chain+1 do set_input_none( self.channel, slot ) end
+    self._chain = {}
+    Input.configure( self, 1, mode, ... )
+    self._mode = mode
+end
+
+-- chained detectors run alongside the mode, on the same block of samples
+-- input[1].mode('change', 1, 0.1, 'rising')
+-- input[1].chain('stream', 0.01) -- also stream the level every 10ms
+-- each calls its own event (here .change & .stream), so chain different modes
+-- each keeps its own params, defaulting to the input's. they're in input[1]._chain
+-- setting the mode clears the chain. returns false if the chain is full
+function Input:chain( mode, ... )
+    local slot = #self._chain + 2
+    if slot > Input.CHAIN then print'input chain is full'; return false end
+    local params = setmetatable( {_mode = mode}, {__index = self} )
+    table.insert( self._chain, params )
+    Input.configure( params, slot, mode, ... )
+    return true
+end
+
+-- self is the input for slot 1, or a chained detector's params
+function Input:configure( slot, mode, ... )
     -- TODO short circuit these comparisons by only looking at first char
     local args = {...}
     if mode == 'stream' then
         self.time = args[1] or self.time
-        set_input_stream( self.channel, self.time )
+        set_input_stream( self.channel, self.time, slot )
     elseif mode == 'change' then
         self.threshold  = args[1] or self.threshold
         self.hysteresis = args[2] or self.hysteresis
@@ -59,11 +85,12 @@ function Input:set_mode( mode, ... )
                         , self.threshold
                         , self.hysteresis
                         , self.direction
+                        , slot
                         )
     elseif mode == 'window' then
         self.windows    = args[1] or self.windows
         self.hysteresis = args[2] or self.hysteresis
-        set_input_window( self.channel, self.windows, self.hysteresis )
+        set_input_window( self.channel, self.windows, self.hysteresis, slot )
     elseif mode == 'scale' then
         self.temp = args[2] or self.temp
         local temp = self.temp
@@ -78,33 +105,64 @@ function Input:set_mode( mode, ... )
                        , self.notes
                        , temp -- use local as may be coerced to 12 by ji
                        , self.scaling
+                       , slot
                        )
     elseif mode == 'volume' then
         self.time = args[1] or self.time
-        set_input_volume( self.channel, self.time )
+        set_input_volume( self.channel, self.time, slot )
     elseif mode == 'peak' then
         self.threshold  = args[1] or self.threshold
         self.hysteresis = args[2] or self.hysteresis
         set_input_peak( self.channel
                       , self.threshold
                       , self.hysteresis
+                      , slot
                       )
     elseif mode == 'freq' then
-        self.time = args[1] or self.time
-        set_input_freq( self.channel, self.time )
+        self.time       = args[1] or self.time
+        self.hysteresis = args[2] or self.hysteresis -- lower it for signals under 2x this
+        set_input_freq( self.channel, self.time, self.hysteresis, slot )
     elseif mode == 'clock' then
         self.div = args[1] or self.div
         set_input_clock( self.channel
                        , self.div
                        , self.threshold
                        , self.hysteresis
+                       , slot
                        )
     else
-        set_input_none( self.channel )
+        set_input_none( self.channel, slot )
     end
-    self._mode = mode
 end
 
+-- routes act on an output directly in the DSP, without waiting for lua
+-- input[1].route{ output = output[3] } -- rising edge restarts output[3]'s action
+-- input[1].route{ output = 3, direction = 'both' } -- gate. falling releases held{}
+-- input[2].route{ output = output[4], dyn = 'x', scale = 1, offset = 0 } -- volts*scale+offset -> dyn x
+-- dyns are looked up when routed, so route after setting the output's action
+-- routes add to those already on the input. returns false if there are none left
+function Input:route( r )
+    local out = r.output
+    if type(out) == 'table' then out = out.channel end
+    local id
+    if r.dyn then
+        local ix = output[out].asl.dyn._names[r.dyn]
+        if not ix then print("route: output "..out.." has no dyn '"..r.dyn.."'"); return false end
+        id = set_route_cv( self.channel, out, ix, r.scale or 1.0, r.offset or 0.0 )
+    else
+        id = set_route_trigger( self.channel
+                              , out
+                              , r.threshold or self.threshold
+                              , r.hysteresis or self.hysteresis
+                              , r.direction or 'rising'
+                              , output[out].asl.dyn._names._held -- nil unless action has held{}
+                              )
+    end
+    return id >= 0
+end
+
+function Input:unroute() clear_routes( self.channel ) end
+
 --- METAMETHODS
 Input.__newindex = function(self, ix, val)
     if ix == 'mode' then
@@ -124,6 +182,12 @@ Input.__index = function(self, ix)
         return function(...) Input.set_mode( self, ...) end
     elseif ix == 'reset_events' then
         return function() Input.reset_events(self) end
+    elseif ix == 'chain' then
+        return function(...) return Input.chain( self, ...) end
+    elseif ix == 'route' then
+        return function(r) return Input.route(self, r) end
+    elseif ix == 'unroute' then
+        return function() Input.unroute(self) end
     end
 end
 
@@ -146,16 +210,17 @@ end
 setmetatable(Input, Input) -- capture the metamethods
 
 -- callback
-function stream_handler( chan, val ) Input.inputs[chan].stream( val ) end
-function change_handler( chan, val ) Input.inputs[chan].change( val ~= 0 ) end
-function window_handler( chan, win, dir ) Input.inputs[chan].window( win, dir ~= 0 ) end
-function scale_handler(chan,i,o,n,v)
+-- time is the capture time in samples, passed as an optional final arg
+function stream_handler( chan, val, time ) Input.inputs[chan].stream( val, time ) end
+function change_handler( chan, val, time ) Input.inputs[chan].change( val ~= 0, time ) end
+function window_handler( chan, win, dir, time ) Input.inputs[chan].window( win, dir ~= 0, time ) end
+function scale_handler(chan,i,o,n,v,time)
     --TODO build this table in C as it'll be faster?
-    s={index=i, octave=o, note=n, volts=v}
+    s={index=i, octave=o, note=n, volts=v, time=time}
     Input.inputs[chan].scale(s)
 end
-function volume_handler( chan, val ) Input.inputs[chan].volume( val ) end
-function peak_handler( chan ) Input.inputs[chan].peak() end
-function freq_handler( chan, val ) Input.inputs[chan].freq( val ) end
+function volume_handler( chan, val, time ) Input.inputs[chan].volume( val, time ) end
+function peak_handler( chan, time ) Input.inputs[chan].peak( time ) end
+function freq_handler( chan, val, conf, time ) Input.inputs[chan].freq( val, conf, time ) end
 
 return Input
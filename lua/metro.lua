@@ -156,10 +156,10 @@ end
 -- @section globals
 
 --- event on metro tick from C;
-metro_handler = function(idx, stage)
+metro_handler = function(idx, stage, time)
    if Metro.metros[idx] then
       if Metro.metros[idx].event then
-         Metro.metros[idx].event(stage)
+         Metro.metros[idx].event(stage, time)
       end
    end
 end
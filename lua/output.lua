@@ -6,9 +6,9 @@ function Output.new( chan )
     local o = { channel = chan
               , level   = 5.0
               , rate    = 1/chan
-              , shape   = 'linear'
-              , slew    = 0.0
+              , _shape  = 'linear' -- slew & shape are stored in C for casl_volts
               , _scale  = 'none'
+              , _hysteresis = 0 -- volts beyond a scale note before the quantizer moves on
               , ji      = false -- mark if .scale is in just intonation mode
               , asl     = asl.new( chan )
               , done    = function() end -- customizable event called on asl completion
@@ -50,11 +50,26 @@ Output.__newindex = function(self, ix, val)
             val = assert(load('return '..val))()
         end
         self.asl:describe(val)
-    elseif ix == 'volts' then
-        self.asl:describe(to(val, self.slew, self.shape))
-        self.asl:action()
+    elseif ix == 'volts' then casl_volts(self.channel, val)
+    elseif ix == 'slew' then casl_setslew(self.channel, val)
+    elseif ix == 'shape' then
+        self._shape = val
+        casl_setshape(self.channel, val)
     elseif ix == 'scale' then
         set_output_scale(self.channel, self.ji and just12(val) or val)
+    elseif ix == 'hysteresis' then
+        self._hysteresis = val
+        set_output_hysteresis(self.channel, val)
+    elseif ix == 'note' then -- event handler for quantized note changes. true sends to host
+        if val == true then
+            val = function(s)
+                _c.tell('note', self.channel, '{index='..s.index
+                                            ..',octave='..s.octave
+                                            ..',volts='..s.volts..'}')
+            end
+        end
+        self._note = val
+        set_output_note(self.channel, val and true or false)
     else
         return rawset(self,ix,val) -- allows 'receive' handler to be written
     end
@@ -65,7 +80,11 @@ Output.__index = function(self, ix)
     if ix == 'action' or ix == 'execute' then
         return function(...) return self.asl:action(...) end
     elseif ix == 'volts' then return LL_get_state(self.channel)
+    elseif ix == 'slew' then return casl_getslew(self.channel)
+    elseif ix == 'shape' then return self._shape
     elseif ix == 'clock' then return Output.clock
+    elseif ix == 'hysteresis' then return self._hysteresis
+    elseif ix == 'note' then return self._note
     elseif ix == 'scale' then return
         function(...) -- return lambda as we're closing over self
             local args = {...}
@@ -96,4 +115,9 @@ setmetatable(Output, Output) -- capture the metamethods
 
 function soutput_handler(ch, v) Output.outputs[ch].receive(v) end
 
+function note_handler(ch, i, o, v)
+    local n = Output.outputs[ch]._note
+    if n then n{index=i, octave=o, volts=v} end
+end
+
 return Output
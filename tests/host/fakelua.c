@@ -0,0 +1,189 @@
+#include "fakelua.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define FL_TABLE_MAX 256
+#define FL_STACK_MAX 64
+
+struct FL_node{
+    int          type;
+    float        n;
+    const char*  s;
+    int          len;
+    FL_node**    items; // tables only
+};
+
+struct lua_State{
+    FL_node* stack[FL_STACK_MAX];
+    int      top;
+};
+
+static FL_node nil = { .type = LUA_TNIL };
+
+
+///////////////////////////////
+// building values
+
+static FL_node* node( int type )
+{
+    FL_node* n = calloc( 1, sizeof( FL_node ) );
+    n->type = type;
+    return n;
+}
+
+FL_node* fl_num( float n ){ FL_node* v = node(LUA_TNUMBER); v->n = n; return v; }
+FL_node* fl_bool( int b ){ FL_node* v = node(LUA_TBOOLEAN); v->n = b; return v; }
+FL_node* fl_str( const char* s ){ FL_node* v = node(LUA_TSTRING); v->s = s; return v; }
+
+FL_node* fl_table( int count, ... )
+{
+    FL_node* t = node(LUA_TTABLE);
+    t->items = calloc( FL_TABLE_MAX, sizeof( FL_node* ) );
+    va_list args;
+    va_start( args, count );
+    for( int i=0; i<count; i++ ){ t->items[t->len++] = va_arg( args, FL_node* ); }
+    va_end( args );
+    return t;
+}
+
+void fl_append( FL_node* table, FL_node* elem )
+{
+    table->items[table->len++] = elem;
+}
+
+void fl_prepend( FL_node* table, FL_node* elem )
+{
+    memmove( &table->items[1], &table->items[0], sizeof( FL_node* ) * table->len );
+    table->items[0] = elem;
+    table->len++;
+}
+
+lua_State* fl_state( FL_node* value )
+{
+    lua_State* L = calloc( 1, sizeof( lua_State ) );
+    L->stack[0] = value;
+    L->top = 1;
+    return L;
+}
+
+
+///////////////////////////////
+// stack
+
+static FL_node* at( lua_State* L, int idx )
+{
+    int i = (idx > 0) ? idx-1 : L->top + idx;
+    if( i < 0 || i >= L->top ){ return NULL; } // none
+    return L->stack[i];
+}
+
+static void push( lua_State* L, FL_node* v )
+{
+    if( L->top >= FL_STACK_MAX ){ printf("fakelua: stack overflow\n"); exit(1); }
+    L->stack[L->top++] = v;
+}
+
+static FL_node* index_of( FL_node* t, int n )
+{
+    if( !t || t->type != LUA_TTABLE || n < 1 || n > t->len ){ return &nil; }
+    return t->items[n-1];
+}
+
+int lua_gettop( lua_State* L ){ return L->top; }
+
+void lua_settop( lua_State* L, int idx )
+{
+    int top = (idx >= 0) ? idx : L->top + idx + 1;
+    while( L->top < top ){ L->stack[L->top++] = &nil; }
+    L->top = top;
+}
+
+int lua_type( lua_State* L, int idx )
+{
+    FL_node* v = at(L, idx);
+    return v ? v->type : LUA_TNONE;
+}
+
+int lua_toboolean( lua_State* L, int idx )
+{
+    FL_node* v = at(L, idx);
+    if( !v || v->type == LUA_TNIL ){ return 0; }
+    if( v->type == LUA_TBOOLEAN ){ return (int)v->n; }
+    return 1;
+}
+
+lua_Number lua_tonumberx( lua_State* L, int idx, int* isnum )
+{
+    FL_node* v = at(L, idx);
+    int ok = v && v->type == LUA_TNUMBER;
+    if( isnum ){ *isnum = ok; }
+    return ok ? v->n : 0.0;
+}
+
+lua_Integer lua_tointegerx( lua_State* L, int idx, int* isnum )
+{
+    return (lua_Integer)lua_tonumberx( L, idx, isnum );
+}
+
+const char* lua_tolstring( lua_State* L, int idx, size_t* len )
+{
+    FL_node* v = at(L, idx);
+    if( !v || v->type != LUA_TSTRING ){ return NULL; }
+    if( len ){ *len = strlen(v->s); }
+    return v->s;
+}
+
+size_t lua_rawlen( lua_State* L, int idx )
+{
+    FL_node* v = at(L, idx);
+    if( !v ){ return 0; }
+    if( v->type == LUA_TSTRING ){ return strlen(v->s); }
+    return (v->type == LUA_TTABLE) ? v->len : 0;
+}
+
+void lua_pushnumber( lua_State* L, lua_Number n )
+{
+    push( L, fl_num(n) );
+}
+
+int lua_gettable( lua_State* L, int idx )
+{
+    FL_node* t = at(L, idx); // resolved before the key is popped
+    FL_node* k = L->stack[--L->top];
+    FL_node* v = index_of( t, (int)k->n );
+    push( L, v );
+    return v->type;
+}
+
+int lua_rawgeti( lua_State* L, int idx, lua_Integer n )
+{
+    FL_node* v = index_of( at(L, idx), n );
+    push( L, v );
+    return v->type;
+}
+
+
+///////////////////////////////
+// auxlib. argument errors end the test
+
+static FL_node* check( lua_State* L, int arg, int type )
+{
+    FL_node* v = at(L, arg);
+    if( !v || v->type != type ){
+        printf("fakelua: bad argument %d (expected type %d)\n", arg, type);
+        exit(1);
+    }
+    return v;
+}
+
+lua_Number luaL_checknumber( lua_State* L, int arg ){ return check(L, arg, LUA_TNUMBER)->n; }
+lua_Integer luaL_checkinteger( lua_State* L, int arg ){ return (lua_Integer)check(L, arg, LUA_TNUMBER)->n; }
+const char* luaL_checklstring( lua_State* L, int arg, size_t* l )
+{
+    const char* s = check(L, arg, LUA_TSTRING)->s;
+    if( l ){ *l = strlen(s); }
+    return s;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// a table-only lua, enough to hand casl_describe a description built in C
+// values are never freed. tests are short-lived
+
+#include "casl.h" // the lua headers casl.c is built with
+
+typedef struct FL_node FL_node;
+
+FL_node* fl_num( float n );
+FL_node* fl_bool( int b );
+FL_node* fl_str( const char* s );
+FL_node* fl_table( int count, ... ); // FL_node* elements, 1-based like lua
+void fl_append( FL_node* table, FL_node* elem );  // table.insert(t, elem)
+void fl_prepend( FL_node* table, FL_node* elem ); // table.insert(t, 1, elem)
+
+// a state with value at stack index 1, as casl_describe expects
+lua_State* fl_state( FL_node* value );
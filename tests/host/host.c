@@ -0,0 +1,41 @@
+#include "host.h"
+
+#include <time.h>
+
+#include "stm32f7xx.h"
+#include "caw.h"
+
+int host_failures = 0;
+
+double host_seconds( void )
+{
+    return (double)clock() / (double)CLOCKS_PER_SEC;
+}
+
+void host_bench( const char* name, double ops, double seconds )
+{
+    if( seconds <= 0.0 ){ seconds = 1e-9; }
+    printf("  %-36s %10.2f M/s\n", name, ops / seconds / 1e6);
+}
+
+int host_report( const char* name )
+{
+    if( host_failures ){
+        printf("%s: %d FAILED\n", name, host_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+
+// hardware & usb stand-ins
+
+static GPIO_TypeDef gpiob;
+GPIO_TypeDef* GPIOB = &gpiob;
+
+uint32_t HAL_GetTick( void ){ return 0; }
+void HAL_Delay( uint32_t ms ){}
+
+void Caw_printf( char* text, ... ){} // errors are also printf'd
+void Caw_send_luachunk( char* text ){}
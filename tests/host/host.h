@@ -0,0 +1,26 @@
+#pragma once
+
+// shared helpers for the host tests. each test_*.c is its own program
+// CHECK failures are counted & reported, and make the program exit non-zero
+
+#include <stdio.h>
+
+extern int host_failures;
+
+#define CHECK( cond, ... ) do{ \
+        if( !(cond) ){ \
+            host_failures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while(0)
+
+// processor time in seconds, for throughput benchmarks
+double host_seconds( void );
+
+// prints a benchmark result as millions of ops per second
+void host_bench( const char* name, double ops, double seconds );
+
+// call at the end of main
+int host_report( const char* name );
@@ -0,0 +1,14 @@
+#pragma once
+
+// host stand-in for the CMSIS device header
+// the tests are single threaded, so blocking interrupts is a no-op
+
+#include <stdint.h>
+
+#define __weak __attribute__((weak))
+
+#define BLOCK_IRQS(code) do{ \
+                            do{code} while(0); \
+                        } while(0);
+
+#include "stm32f7xx_hal.h"
@@ -0,0 +1,132 @@
+#pragma once
+
+// host stand-in for the HAL. just enough for the drivers under test to compile
+// peripheral setup calls do nothing, so only the DSP paths are exercised
+
+#include <stdint.h>
+
+typedef enum{ HAL_OK, HAL_ERROR } HAL_StatusTypeDef;
+
+uint32_t HAL_GetTick( void );
+void HAL_Delay( uint32_t ms );
+
+// gpio
+typedef struct{ int x; } GPIO_TypeDef;
+extern GPIO_TypeDef* GPIOB;
+typedef struct{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_9          (1<<9)
+#define GPIO_PIN_12         (1<<12)
+#define GPIO_PIN_13         (1<<13)
+#define GPIO_PIN_14         (1<<14)
+#define GPIO_PIN_15         (1<<15)
+#define GPIO_MODE_AF_PP     0
+#define GPIO_MODE_OUTPUT_PP 0
+#define GPIO_PULLUP         0
+#define GPIO_SPEED_FAST     0
+#define GPIO_AF5_SPI2       0
+
+#define HAL_GPIO_Init( port, init )         ((void)(port), (void)(init))
+#define HAL_GPIO_DeInit( port, pin )        ((void)(port), (void)(pin))
+#define HAL_GPIO_WritePin( port, pin, val ) ((void)(port), (void)(pin), (void)(val))
+
+// clocks
+typedef struct{
+    uint32_t PeriphClockSelection;
+    uint32_t I2sClockSelection;
+    struct{
+        uint32_t PLLI2SN;
+        uint32_t PLLI2SR;
+    } PLLI2S;
+} RCC_PeriphCLKInitTypeDef;
+
+#define RCC_PERIPHCLK_I2S       0
+#define RCC_I2SCLKSOURCE_PLLI2S 0
+
+#define HAL_RCCEx_PeriphCLKConfig( init ) ((void)(init))
+#define __HAL_RCC_GPIOB_CLK_ENABLE()
+#define __HAL_RCC_DMA1_CLK_ENABLE()
+#define __HAL_RCC_SPI2_CLK_ENABLE()
+#define __HAL_RCC_SPI2_FORCE_RESET()
+#define __HAL_RCC_SPI2_RELEASE_RESET()
+
+// dma
+typedef struct{
+    void* Instance;
+    struct{
+        uint32_t Channel;
+        uint32_t Direction;
+        uint32_t PeriphInc;
+        uint32_t MemInc;
+        uint32_t PeriphDataAlignment;
+        uint32_t MemDataAlignment;
+        uint32_t Mode;
+        uint32_t Priority;
+        uint32_t FIFOMode;
+        uint32_t FIFOThreshold;
+        uint32_t MemBurst;
+        uint32_t PeriphBurst;
+    } Init;
+} DMA_HandleTypeDef;
+
+#define DMA1_Stream4            ((void*)0)
+#define DMA_CHANNEL_0           0
+#define DMA_MEMORY_TO_PERIPH    0
+#define DMA_PINC_DISABLE        0
+#define DMA_MINC_ENABLE         0
+#define DMA_PDATAALIGN_HALFWORD 0
+#define DMA_MDATAALIGN_WORD     0
+#define DMA_CIRCULAR            0
+#define DMA_PRIORITY_LOW        0
+#define DMA_FIFOMODE_DISABLE    0
+#define DMA_FIFO_THRESHOLD_FULL 0
+#define DMA_MBURST_INC4         0
+#define DMA_PBURST_INC4         0
+
+#define HAL_DMA_Init( h )       ((void)(h))
+#define HAL_DMA_DeInit( h )     ((void)(h))
+#define HAL_DMA_IRQHandler( h ) ((void)(h))
+
+// i2s
+typedef struct{
+    void* Instance;
+    struct{
+        uint32_t Mode;
+        uint32_t Standard;
+        uint32_t DataFormat;
+        uint32_t MCLKOutput;
+        uint32_t AudioFreq;
+        uint32_t CPOL;
+        uint32_t ClockSource;
+    } Init;
+    DMA_HandleTypeDef* hdmatx;
+} I2S_HandleTypeDef;
+
+#define SPI2                   ((void*)0)
+#define I2S_MODE_MASTER_TX     0
+#define I2S_STANDARD_PCM_SHORT 0
+#define I2S_DATAFORMAT_24B     0
+#define I2S_MCLKOUTPUT_ENABLE  0
+#define I2S_AUDIOFREQ_192K     0
+#define I2S_CPOL_LOW           0
+#define I2S_CLOCK_PLL          0
+
+#define HAL_I2S_Init( h )                    ((void)(h), HAL_OK)
+#define HAL_I2S_Transmit_DMA( h, buf, size ) ((void)(h), (void)(buf), (void)(size), HAL_OK)
+#define HAL_I2S_IRQHandler( h )              ((void)(h))
+
+#define __HAL_LINKDMA( parent, field, dma ) do{ (parent)->field = &(dma); } while(0)
+
+// nvic
+#define SPI2_IRQn         0
+#define DMA1_Stream4_IRQn 0
+
+#define HAL_NVIC_SetPriority( irq, pre, sub ) ((void)(irq), (void)(pre), (void)(sub))
+#define HAL_NVIC_EnableIRQ( irq )             ((void)(irq))
+#define HAL_NVIC_DisableIRQ( irq )            ((void)(irq))
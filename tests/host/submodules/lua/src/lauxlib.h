@@ -0,0 +1,11 @@
+#pragma once
+
+// host stand-in for lauxlib.h. see lua.h
+
+#include "lua.h"
+
+lua_Number  luaL_checknumber( lua_State* L, int arg );
+lua_Integer luaL_checkinteger( lua_State* L, int arg );
+const char* luaL_checklstring( lua_State* L, int arg, size_t* l );
+
+#define luaL_checkstring(L,n) (luaL_checklstring(L, (n), NULL))
@@ -0,0 +1,38 @@
+#pragma once
+
+// host stand-in for the lua 5.3 api, as configured by LUA_32BITS
+// only what casl_describe uses to walk tables. tests/host/fakelua.c implements it
+// signatures & macros match lua.h, so a checkout with the lua submodule builds the same
+
+#include <stddef.h>
+
+typedef struct lua_State lua_State;
+
+typedef float lua_Number;
+typedef int   lua_Integer;
+
+#define LUA_TNONE     (-1)
+#define LUA_TNIL      0
+#define LUA_TBOOLEAN  1
+#define LUA_TNUMBER   3
+#define LUA_TSTRING   4
+#define LUA_TTABLE    5
+
+int         lua_gettop( lua_State* L );
+void        lua_settop( lua_State* L, int idx );
+int         lua_type( lua_State* L, int idx );
+int         lua_toboolean( lua_State* L, int idx );
+lua_Number  lua_tonumberx( lua_State* L, int idx, int* isnum );
+lua_Integer lua_tointegerx( lua_State* L, int idx, int* isnum );
+const char* lua_tolstring( lua_State* L, int idx, size_t* len );
+size_t      lua_rawlen( lua_State* L, int idx );
+void        lua_pushnumber( lua_State* L, lua_Number n );
+int         lua_gettable( lua_State* L, int idx );
+int         lua_rawgeti( lua_State* L, int idx, lua_Integer n );
+
+#define lua_pop(L,n)        lua_settop(L, -(n)-1)
+#define lua_tonumber(L,i)   lua_tonumberx(L,(i),NULL)
+#define lua_tointeger(L,i)  lua_tointegerx(L,(i),NULL)
+#define lua_tostring(L,i)   lua_tolstring(L, (i), NULL)
+#define lua_istable(L,n)    (lua_type(L, (n)) == LUA_TTABLE)
+#define lua_isnil(L,n)      (lua_type(L, (n)) == LUA_TNIL)
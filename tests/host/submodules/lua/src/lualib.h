@@ -0,0 +1,5 @@
+#pragma once
+
+// host stand-in for lualib.h. see lua.h
+
+#include "lua.h"
@@ -0,0 +1,13 @@
+#include "wrBlocks.h"
+
+float* b_add( float* io, float a, int size )
+{
+    for( int i=0; i<size; i++ ){ io[i] += a; }
+    return io;
+}
+
+float* b_mul( float* io, float m, int size )
+{
+    for( int i=0; i<size; i++ ){ io[i] *= m; }
+    return io;
+}
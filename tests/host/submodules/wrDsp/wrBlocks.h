@@ -0,0 +1,6 @@
+#pragma once
+
+// host stand-in for wrDsp's block functions used by lib/
+
+float* b_add( float* io, float a, int size );
+float* b_mul( float* io, float m, int size );
@@ -0,0 +1,23 @@
+#include "wrMeters.h"
+
+#include <stdlib.h>
+
+VU_meter_t* VU_init( void )
+{
+    VU_meter_t* self = malloc( sizeof( VU_meter_t ) );
+    self->time  = 0.1;
+    self->level = 0.0;
+    return self;
+}
+
+void VU_time( VU_meter_t* self, float seconds )
+{
+    self->time = seconds;
+}
+
+float VU_step( VU_meter_t* self, float in )
+{
+    float r = (in < 0.0) ? -in : in;
+    self->level += (r - self->level) * 0.1;
+    return self->level;
+}
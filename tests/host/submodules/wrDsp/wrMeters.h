@@ -0,0 +1,12 @@
+#pragma once
+
+// host stand-in for wrDsp's vu meter. a one-pole follower of the rectified input
+
+typedef struct{
+    float time;
+    float level;
+} VU_meter_t;
+
+VU_meter_t* VU_init( void );
+void VU_time( VU_meter_t* self, float seconds );
+float VU_step( VU_meter_t* self, float in );
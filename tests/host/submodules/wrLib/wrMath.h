@@ -0,0 +1,5 @@
+#pragma once
+
+// host stand-in for wrLib's math helpers
+
+float lim_f( float in, float min, float max );
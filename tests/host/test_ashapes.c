@@ -0,0 +1,263 @@
+// ashapes quantizer: bit-exact against the per-sample lookup it replaced, hysteresis, & throughput
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "ashapes.h"
+
+#define BLOCK 32
+
+// the original AShaper_v loop, on a copy of the shaper's settings
+typedef struct{
+    float divlist[MAX_DIV_LIST_LEN];
+    int   dlLen;
+    float modulo;
+    float scaling;
+    float offset;
+} Ref_t;
+
+static void ref_set( Ref_t* r, float* divlist, int dlLen, float modulo, float scaling )
+{
+    r->dlLen = (dlLen > 24) ? 24 : dlLen;
+    if( r->dlLen == 0 ){
+        r->dlLen = 1;
+        r->divlist[0] = 0.0;
+        r->modulo = 1.0;
+        r->scaling = scaling / modulo;
+    } else {
+        for( int i=0; i<r->dlLen; i++ ){ r->divlist[i] = divlist[i]; }
+        r->modulo = modulo;
+        r->scaling = scaling;
+    }
+    r->offset = 0.5 * r->scaling / r->modulo;
+}
+
+static void ref_v( Ref_t* r, float* out, int size )
+{
+    for( int i=0; i<size; i++ ){
+        float samp = out[i] + r->offset;
+        float n_samp = samp/r->scaling;
+        float divs = floorf(n_samp);
+        float phase = n_samp - divs;
+        int note = (int)(phase * r->dlLen);
+        // the old code indexed one past the list when phase rounded up to 1.0
+        if( note >= r->dlLen ){ note = r->dlLen - 1; }
+        float note_map = r->divlist[note];
+        note_map /= r->modulo;
+        out[i] = r->scaling * (divs + note_map);
+    }
+}
+
+static float frand( float lo, float hi ){ return lo + (hi - lo) * (float)rand() / (float)RAND_MAX; }
+
+// every input signal in the test, one block at a time
+typedef enum{ SIG_Slew, SIG_Noise, SIG_Edges, SIG_COUNT } Signal;
+
+static void signal_block( Signal s, float* buf, float* level, Ref_t* r )
+{
+    for( int i=0; i<BLOCK; i++ ){
+        switch( s ){
+            case SIG_Slew: // slow, mostly inside one note per block
+                *level += 0.0007;
+                if( *level > 10.0 ){ *level = -5.0; }
+                buf[i] = *level;
+                break;
+            case SIG_Noise:
+                buf[i] = frand( -5.0, 10.0 );
+                break;
+            case SIG_Edges:{ // on & either side of each note boundary
+                float w = r->scaling / (float)r->dlLen;
+                float edge = w * (float)(rand() % 200 - 70) - r->offset;
+                int side = rand() % 3;
+                buf[i] = (side == 0) ? edge
+                       : (side == 1) ? nextafterf( edge, -INFINITY )
+                                     : nextafterf( edge, INFINITY );
+                break;}
+            default: break;
+        }
+    }
+}
+
+static void matches_lookup( void )
+{
+    float chromatic[12] = { 0,1,2,3,4,5,6,7,8,9,10,11 };
+    float major[7]      = { 0,2,4,5,7,9,11 };
+    float penta[5]      = { 0,3,5,7,10 };
+    float bohlen[9]     = { 0,2,3,5,6,8,9,11,12 };
+    struct{ float* list; int len; float mod; float scaling; } scales[] =
+        { { chromatic, 12, 12.0, 1.0 }
+        , { major,      7, 12.0, 1.0 }
+        , { penta,      5, 12.0, 2.0 }
+        , { bohlen,     9, 13.0, 1.0 }
+        , { major,      7, 12.0, 0.5 }
+        , { NULL,       0, 12.0, 1.0 } // empty list is chromatic
+        , { NULL,       0,  7.0, 3.0 }
+        };
+    int count = sizeof(scales) / sizeof(scales[0]);
+    static float in[BLOCK], ref[BLOCK];
+    for( int s=0; s<count; s++ ){
+        AShaper_set_scale( 0, scales[s].list, scales[s].len, scales[s].mod, scales[s].scaling );
+        Ref_t r;
+        ref_set( &r, scales[s].list, scales[s].len, scales[s].mod, scales[s].scaling );
+        for( int sig=0; sig<SIG_COUNT; sig++ ){
+            float level = -5.0;
+            long mismatched = 0;
+            for( int b=0; b<20000; b++ ){
+                signal_block( (Signal)sig, in, &level, &r );
+                for( int i=0; i<BLOCK; i++ ){ ref[i] = in[i]; }
+                ref_v( &r, ref, BLOCK );
+                AShaper_v( 0, in, BLOCK );
+                for( int i=0; i<BLOCK; i++ ){
+                    if( in[i] != ref[i] ){ mismatched++; }
+                }
+            }
+            CHECK( mismatched == 0, "scale %d signal %d: %ld samples differ from the lookup"
+                 , s, sig, mismatched );
+        }
+    }
+    AShaper_unset_scale( 0 );
+}
+
+// noise straddling a note boundary chatters without hysteresis, & holds with it
+static int note_changes( float hysteresis )
+{
+    AShaper_set_scale( 1, NULL, 0, 12.0, 1.0 );
+    AShaper_set_hysteresis( 1, hysteresis );
+    float edge = 5.0 / 12.0 - 0.5 / 12.0; // between notes 4 & 5
+    float buf[BLOCK];
+    float last = 0.0;
+    int changes = 0;
+    srand( 1 );
+    for( int b=0; b<1000; b++ ){
+        for( int i=0; i<BLOCK; i++ ){ buf[i] = edge + frand( -0.002, 0.002 ); } // +/-2mV
+        AShaper_v( 1, buf, BLOCK );
+        for( int i=0; i<BLOCK; i++ ){
+            if( buf[i] != last ){ changes++; last = buf[i]; }
+        }
+    }
+    return changes;
+}
+
+static void hysteresis( void )
+{
+    int chatter = note_changes( 0.0 );
+    int held = note_changes( 0.005 );
+    printf("note changes from +/-2mV noise on an edge: %d, with 5mV hysteresis: %d\n", chatter, held);
+    CHECK( chatter > 1000, "only %d changes without hysteresis", chatter );
+    CHECK( held <= 1, "%d changes with hysteresis", held );
+
+    // hysteresis delays a change, but a real move still lands on the right note
+    float v = 7.0 / 12.0;
+    AShaper_v( 1, &v, 1 );
+    CHECK( fabsf( v - 7.0 / 12.0 ) < 1e-6, "moved to %g with hysteresis", v );
+    AShaper_set_hysteresis( 1, 0.0 );
+}
+
+// note events: rate-limited by NOTE_HOLDOFF, each carrying the note reached when it was raised
+
+#define NOTES_MAX 256
+
+typedef struct{
+    int   note;
+    int   octave;
+    float volts;
+    int   block;
+} Note;
+
+static Note notes[NOTES_MAX];
+static int  note_count;
+static int  block_now;
+
+static void record_note( int index, int note, int octave, float volts )
+{
+    if( note_count >= NOTES_MAX ){ return; }
+    notes[note_count++] = (Note){ note, octave, volts, block_now };
+}
+
+static void note_events( void )
+{
+    float major[7] = { 0,2,4,5,7,9,11 };
+    AShaper_set_scale( 3, major, 7, 12.0, 1.0 );
+    float buf[BLOCK];
+    for( int i=0; i<BLOCK; i++ ){ buf[i] = 0.0; }
+    AShaper_v( 3, buf, BLOCK );
+    AShaper_set_note_action( 3, record_note ); // reports changes from the current note
+    note_count = 0;
+
+    // a fast slew moves a note every block, from -2V for 50 blocks, then holds
+    Ref_t r;
+    ref_set( &r, major, 7, 12.0, 1.0 );
+    float expect[100];
+    int blocks = 100;
+    for( block_now=0; block_now<blocks; block_now++ ){
+        float level = -2.0 + (float)((block_now < 50) ? block_now : 50) / 12.0;
+        for( int i=0; i<BLOCK; i++ ){ buf[i] = level; }
+        expect[block_now] = level;
+        ref_v( &r, &expect[block_now], 1 );
+        AShaper_v( 3, buf, BLOCK );
+    }
+    CHECK( note_count > 2, "%d note events from a fast slew", note_count );
+    int wrong = 0;
+    int early = 0;
+    for( int n=0; n<note_count; n++ ){
+        Note* e = &notes[n];
+        float v = 1.0 * ((float)e->octave + major[e->note] / 12.0);
+        if( e->volts != expect[e->block] || fabsf( v - e->volts ) > 1e-6 ){ wrong++; }
+        if( n && e->block - notes[n-1].block != NOTE_HOLDOFF + 1 ){ early++; }
+    }
+    CHECK( wrong == 0, "%d of %d events reported another note than the output's", wrong, note_count );
+    CHECK( early == 0, "%d events not exactly %d blocks after the last", early, NOTE_HOLDOFF + 1 );
+    CHECK( notes[0].block == 0, "first event waited until block %d", notes[0].block );
+    Note* last = &notes[note_count-1];
+    CHECK( last->volts == expect[blocks-1] && last->note == 1 && last->octave == 2 // D at 2V
+         , "final note %d octave %d (%gV), expected 1 octave 2 (%gV)"
+         , last->note, last->octave, last->volts, expect[blocks-1] );
+    CHECK( last->block <= 50 + NOTE_HOLDOFF, "final note reported %d blocks after it was reached", last->block - 50 );
+
+    // a negative octave survives
+    note_count = 0;
+    for( int i=0; i<BLOCK; i++ ){ buf[i] = -2.9; }
+    for( block_now=0; block_now<NOTE_HOLDOFF + 1; block_now++ ){ AShaper_v( 3, buf, BLOCK ); }
+    CHECK( note_count == 1 && notes[0].octave == -3 && notes[0].note == 0
+         , "%d events, note %d octave %d at -2.9V", note_count, notes[0].note, notes[0].octave );
+
+    AShaper_set_note_action( 3, NULL );
+    AShaper_unset_scale( 3 );
+}
+
+static void throughput( void )
+{
+    float major[7] = { 0,2,4,5,7,9,11 };
+    AShaper_set_scale( 2, major, 7, 12.0, 1.0 );
+    Ref_t r;
+    ref_set( &r, major, 7, 12.0, 1.0 );
+
+    int blocks = 400000;
+    static float buf[BLOCK];
+    float level = -5.0;
+    printf("slewing samples per second\n");
+    double t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        signal_block( SIG_Slew, buf, &level, &r );
+        ref_v( &r, buf, BLOCK );
+    }
+    host_bench( "per-sample lookup", (double)blocks * BLOCK, host_seconds() - t0 );
+    level = -5.0;
+    t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        signal_block( SIG_Slew, buf, &level, &r );
+        AShaper_v( 2, buf, BLOCK );
+    }
+    host_bench( "note window", (double)blocks * BLOCK, host_seconds() - t0 );
+}
+
+int main( void )
+{
+    AShaper_init( 4 );
+    matches_lookup();
+    hysteresis();
+    note_events();
+    throughput();
+    return host_report("ashapes");
+}
@@ -0,0 +1,883 @@
+// casl: the compiled ASL runtime, driven by descriptions built in C
+// slopes are replaced by stand-ins that record what the program asked for
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "fakelua.h"
+#include "casl.h"
+#include "shapes.h"
+
+#define CHANNELS 8
+
+// last request made of each slope
+typedef struct{
+    int        towards; // S_toward calls
+    float      dest;
+    float      ms;
+    Shape_t    shape;
+    Callback_t cb;
+    int        oscs;    // S_oscillate calls
+    float      freq;
+    float      level;
+    Wave_t     wave;
+} Record;
+
+static Record rec[CHANNELS];
+static int    done[CHANNELS];
+
+void S_toward( int index, float destination, float ms, Shape_t shape, Callback_t cb )
+{
+    Record* r = &rec[index];
+    r->towards++;
+    r->dest  = destination;
+    r->ms    = ms;
+    r->shape = shape;
+    r->cb    = (ms > 0.0) ? cb : NULL; // instant stages don't wait for a breakpoint
+}
+
+void S_oscillate( int index, float freq, float level, Wave_t wave )
+{
+    Record* r = &rec[index];
+    r->oscs++;
+    r->freq  = freq;
+    r->level = level;
+    r->wave  = wave;
+    r->cb    = NULL;
+}
+
+float S_get_state( int index ){ return rec[index].dest; }
+
+// a breakpoint can land while casl_describe is compiling. this fires one at the
+// nth shape parsed, which for a single to() is its compile (the scan is first)
+static int isr_channel = -1;
+static int isr_countdown;
+static void breakpoint( int ch );
+
+Shape_t S_str_to_shape( const char* s )
+{
+    if( isr_channel >= 0 && --isr_countdown == 0 ){
+        breakpoint( isr_channel );
+        isr_channel = -1;
+    }
+    switch( *s ){
+        case 's': return SHAPE_Sine;
+        case 'e': return SHAPE_Expo;
+        case 'n': return SHAPE_Now;
+        default:  return SHAPE_Linear;
+    }
+}
+
+Wave_t S_str_to_wave( const char* s )
+{
+    if( s[0] == 's' && s[1] == 'a' ){ return WAVE_Saw; }
+    if( s[0] == 't' ){ return WAVE_Tri; }
+    return WAVE_Sine;
+}
+
+void L_queue_asl_done( int id ){ done[id]++; }
+
+
+///////////////////////////////
+// descriptions, as lua/asl.lua builds them
+
+static FL_node* to( float volts, float time, const char* shape )
+{
+    return fl_table( 4, fl_str("TO"), fl_num(volts), fl_num(time), fl_str(shape) );
+}
+
+static void describe( int ch, FL_node* d )
+{
+    casl_describe( ch, fl_state( d ) );
+}
+
+// fire the pending breakpoint, as the slope would on reaching its destination
+static void breakpoint( int ch )
+{
+    Callback_t cb = rec[ch].cb;
+    rec[ch].cb = NULL;
+    if( cb ){ cb( ch ); }
+}
+
+static FL_node* loop( FL_node* t ){ fl_append( t, fl_table( 1, fl_str("RECUR") ) ); return t; }
+static FL_node* _if( FL_node* pred, FL_node* t ){ fl_prepend( t, fl_table( 2, fl_str("IF"), pred ) ); return t; }
+static FL_node* dyn( int ix ){ return fl_table( 2, fl_str("DYN"), fl_num( (float)ix ) ); }
+static FL_node* mut( float v ){ return fl_table( 2, fl_str("MUT"), fl_num( v ) ); }
+static FL_node* op( const char* o, FL_node* a, FL_node* b )
+{
+    return b ? fl_table( 3, fl_str(o), a, b ) : fl_table( 2, fl_str(o), a );
+}
+static FL_node* held( FL_node* t, int held_dyn )
+{
+    fl_prepend( t, fl_table( 1, fl_str("HELD") ) );
+    fl_append( t, fl_table( 1, fl_str("WAIT") ) );
+    fl_append( t, fl_table( 1, fl_str("UNHELD") ) );
+    return _if( dyn( held_dyn ), t );
+}
+static FL_node* lock( FL_node* t )
+{
+    fl_prepend( t, fl_table( 1, fl_str("LOCK") ) );
+    fl_append( t, fl_table( 1, fl_str("OPEN") ) );
+    return t;
+}
+static FL_node* times( int n, FL_node* t ){ return loop( _if( op( "-", mut( n+1 ), fl_num(1) ), t ) ); }
+
+// a sequence of stages to first, first+1, ..
+static FL_node* stages( int count, float first )
+{
+    FL_node* t = fl_table( 0 );
+    for( int i=0; i<count; i++ ){ fl_append( t, to( first + (float)i, 0.1, "linear" ) ); }
+    return t;
+}
+
+// starts the program & checks it visits each stage of stages(count, first) in order
+static bool runs_stages( int ch, int count, float first )
+{
+    casl_action( ch, 1 );
+    for( int i=0; i<count; i++ ){
+        if( rec[ch].dest != first + (float)i ){ return false; }
+        breakpoint( ch );
+    }
+    return true;
+}
+
+static int total_usage( PoolType pool )
+{
+    int sum = 0;
+    for( int ch=0; ch<CHANNELS; ch++ ){ sum += casl_usage( ch, pool ); }
+    return sum;
+}
+
+
+///////////////////////////////
+// casl_volts
+
+static void volts( void )
+{
+    int ch = 0;
+    casl_setslew( ch, 0.25 );
+    casl_setshape( ch, SHAPE_Expo );
+    CHECK( casl_getslew( ch ) == 0.25, "slew %g", casl_getslew( ch ) );
+
+    // same request of the slope as describing & calling to(volts, slew, shape)
+    casl_volts( ch, 4.5 );
+    Record direct = rec[ch];
+    describe( ch, to( 4.5, 0.25, "expo" ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == direct.dest && rec[ch].ms == direct.ms && rec[ch].shape == direct.shape
+         , "casl_volts gave to(%g,%g,%d), to() gave (%g,%g,%d)"
+         , direct.dest, direct.ms, direct.shape, rec[ch].dest, rec[ch].ms, rec[ch].shape );
+    CHECK( direct.dest == 4.5 && direct.ms == 250.0 && direct.shape == SHAPE_Expo
+         , "casl_volts gave to(%g,%g,%d)", direct.dest, direct.ms, direct.shape );
+
+    // repeat updates retarget with the current slew, & don't grow the pools
+    int code = casl_usage( -1, POOL_Code );
+    for( int i=0; i<100; i++ ){ casl_volts( ch, (float)i ); }
+    CHECK( casl_usage( -1, POOL_Code ) <= code, "code pool grew to %d", casl_usage( -1, POOL_Code ) );
+    CHECK( rec[ch].dest == 99.0, "last update went to %g", rec[ch].dest );
+    casl_setslew( ch, 0.0 );
+    casl_volts( ch, -2.0 );
+    CHECK( rec[ch].dest == -2.0 && rec[ch].ms == 0.0, "instant update to(%g,%g)", rec[ch].dest, rec[ch].ms );
+
+    // completing the slew raises the done event once
+    casl_setslew( ch, 0.1 );
+    done[ch] = 0;
+    casl_volts( ch, 1.0 );
+    breakpoint( ch );
+    CHECK( done[ch] == 1, "%d done events", done[ch] );
+
+    // other channels are untouched
+    rec[1].towards = 0;
+    casl_volts( 1, 3.0 );
+    casl_volts( ch, 2.0 );
+    CHECK( rec[1].towards == 1 && rec[1].dest == 3.0, "channel 1 went to %g", rec[1].dest );
+
+    // out of range channels are ignored
+    casl_volts( -1, 1.0 );
+    casl_volts( CHANNELS, 1.0 );
+}
+
+///////////////////////////////
+// program semantics, as tests/casl.lua & lua/asl.lua describe them
+
+// runs the program for up to count stages, recording where each went
+static int run( int ch, float* dests, int count )
+{
+    int n = 0;
+    while( n < count && rec[ch].cb ){
+        breakpoint( ch );
+        dests[n++] = rec[ch].dest;
+    }
+    return n;
+}
+
+static bool same( const float* a, const float* b, int n )
+{
+    for( int i=0; i<n; i++ ){ if( a[i] != b[i] ){ return false; } }
+    return true;
+}
+
+#define EXPECT_RUN( ch, ... ) do{ \
+        float want[] = { __VA_ARGS__ }; \
+        int   count  = sizeof(want) / sizeof(want[0]); \
+        float got[64]; \
+        got[0] = rec[ch].dest; \
+        int n = 1 + run( ch, &got[1], count-1 ); \
+        CHECK( n == count && same( got, want, count ), "stages went to %g %g %g %g .. (%d of %d)" \
+             , got[0], got[1], got[2], got[3], n, count ); \
+    } while(0)
+
+static void semantics( void )
+{
+    int ch = 4;
+    casl_cleardynamics( ch );
+
+    // to() waits for its breakpoint, then the sequence completes
+    describe( ch, to( 3.0, 4.2, "linear" ) );
+    done[ch] = 0;
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 3.0 && rec[ch].ms == 4200.0, "to(3,4.2) went to (%g,%g)", rec[ch].dest, rec[ch].ms );
+    CHECK( done[ch] == 0, "done before the breakpoint" );
+    breakpoint( ch );
+    CHECK( done[ch] == 1, "%d done events", done[ch] );
+
+    // sequences, loops & shapes
+    describe( ch, fl_table( 2, to( -3, 3, "linear" ), to( 3, 3, "linear" ) ) );
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, -3, 3 );
+    describe( ch, loop( fl_table( 2, to( -3, 3, "sine" ), to( 3, 3, "expo" ) ) ) );
+    done[ch] = 0;
+    casl_action( ch, 1 );
+    CHECK( rec[ch].shape == SHAPE_Sine, "loop starts with shape %d", rec[ch].shape );
+    EXPECT_RUN( ch, -3, 3, -3, 3, -3, 3, -3 );
+    CHECK( rec[ch].shape == SHAPE_Sine && done[ch] == 0, "loop ended" );
+
+    // instant stages run back to back
+    describe( ch, fl_table( 3, to( 1, 0, "now" ), to( 2, 0, "now" ), to( 3, 1, "linear" ) ) );
+    rec[ch].towards = 0;
+    casl_action( ch, 1 );
+    CHECK( rec[ch].towards == 3 && rec[ch].dest == 3.0, "%d instant stages, at %g", rec[ch].towards, rec[ch].dest );
+
+    // a loop of instant stages yields to the DSP rather than spinning
+    describe( ch, loop( fl_table( 2, to( 1, 0, "now" ), to( 2, 0, "now" ) ) ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].cb && rec[ch].ms > 0.0, "instant loop didn't yield" );
+    int before = rec[ch].towards;
+    breakpoint( ch ); // resumes
+    CHECK( rec[ch].towards > before && rec[ch].cb, "instant loop didn't resume" );
+
+    // if skips the rest of its sequence
+    describe( ch, fl_table( 2, _if( fl_bool(0), fl_table( 1, to( 9, 1, "linear" ) ) ), to( 3, 1, "linear" ) ) );
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, 3 );
+    describe( ch, fl_table( 2, _if( fl_bool(1), fl_table( 1, to( 9, 1, "linear" ) ) ), to( 3, 1, "linear" ) ) );
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, 9, 3 );
+    describe( ch, fl_table( 3, to( 1, 1, "linear" )
+                             , loop( fl_table( 2, to( 2, 1, "linear" )
+                                                , _if( fl_num(0), fl_table( 1, to( 9, 1, "linear" ) ) ) ) )
+                             , to( 3, 1, "linear" ) ) );
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, 1, 2, 2, 2, 2 );
+
+    // held{} waits at its end until released
+    casl_cleardynamics( ch );
+    int h = casl_defdynamic( ch );
+    describe( ch, fl_table( 2, held( fl_table( 1, to( 5, 1, "linear" ) ), h ), to( 0, 0, "linear" ) ) );
+    casl_setdynamic( ch, h, 1 );
+    done[ch] = 0;
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 5.0, "held started at %g", rec[ch].dest );
+    breakpoint( ch );
+    CHECK( rec[ch].dest == 5.0 && !rec[ch].cb && done[ch] == 0, "held didn't wait" );
+    casl_setdynamic( ch, h, 0 );
+    casl_action( ch, 0 );
+    CHECK( rec[ch].dest == 0.0 && done[ch] == 1, "release went to %g", rec[ch].dest );
+
+    // released before reaching the wait
+    describe( ch, fl_table( 2, held( fl_table( 2, to( 5, 1, "linear" ), to( 4, 1, "linear" ) ), h )
+                             , to( 0, 2, "linear" ) ) );
+    casl_setdynamic( ch, h, 1 );
+    casl_action( ch, 1 );
+    casl_setdynamic( ch, h, 0 );
+    casl_action( ch, 0 );
+    CHECK( rec[ch].dest == 0.0 && rec[ch].ms == 2000.0, "early release went to %g", rec[ch].dest );
+
+    // lock{} ignores actions until it completes, or is unlocked
+    describe( ch, lock( fl_table( 2, to( 1, 1, "linear" ), to( 2, 1, "linear" ) ) ) );
+    casl_action( ch, 1 );
+    rec[ch].towards = 0;
+    casl_action( ch, 1 );
+    CHECK( rec[ch].towards == 0, "restarted while locked" );
+    EXPECT_RUN( ch, 1, 2 );
+    breakpoint( ch ); // open again
+    casl_action( ch, 1 );
+    CHECK( rec[ch].towards == 2 && rec[ch].dest == 1.0, "couldn't restart after the lock" );
+    casl_action( ch, 2 ); // unlock
+    casl_action( ch, 1 );
+    CHECK( rec[ch].towards == 3 && rec[ch].dest == 1.0, "couldn't restart after unlocking" );
+    EXPECT_RUN( ch, 1, 2 );
+    breakpoint( ch ); // the lock outlives a re-describe, so let it open
+
+    // times() repeats exactly n times
+    describe( ch, times( 3, fl_table( 2, to( 1, 1, "linear" ), to( 0, 1, "linear" ) ) ) );
+    done[ch] = 0;
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, 1, 0, 1, 0, 1, 0 );
+    breakpoint( ch );
+    CHECK( done[ch] == 1 && !rec[ch].cb, "times(3) didn't complete" );
+
+    // dynamics are read each time a stage runs
+    casl_cleardynamics( ch );
+    int l = casl_defdynamic( ch );
+    int t = casl_defdynamic( ch );
+    casl_setdynamic( ch, l, 2.0 );
+    casl_setdynamic( ch, t, 0.5 );
+    describe( ch, loop( fl_table( 2
+        , fl_table( 4, fl_str("TO"), op( "*", dyn(l), fl_num(2) ), op( "/", dyn(t), fl_num(2) ), fl_str("linear") )
+        , fl_table( 4, fl_str("TO"), op( "~", dyn(l), NULL ), op( "+", dyn(t), fl_num(0.25) ), fl_str("linear") )
+        ) ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 4.0 && rec[ch].ms == 250.0, "dyn math went to (%g,%g)", rec[ch].dest, rec[ch].ms );
+    breakpoint( ch );
+    CHECK( rec[ch].dest == -2.0 && rec[ch].ms == 750.0, "dyn math went to (%g,%g)", rec[ch].dest, rec[ch].ms );
+    casl_setdynamic( ch, l, 3.0 );
+    casl_setdynamic( ch, t, 1.0 );
+    breakpoint( ch );
+    CHECK( rec[ch].dest == 6.0 && rec[ch].ms == 500.0, "updated dyns went to (%g,%g)", rec[ch].dest, rec[ch].ms );
+
+    // mutables keep what's written back to them
+    describe( ch, loop( fl_table( 1
+        , fl_table( 4, fl_str("TO"), op( "#", op( "+", mut(0), fl_num(1) ), NULL ), fl_num(1), fl_str("linear") ) ) ) );
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, 1, 2, 3, 4 );
+
+    // nesting isn't limited by the evaluator
+    FL_node* deep = to( 5, 1, "linear" );
+    for( int i=0; i<40; i++ ){ deep = fl_table( 1, deep ); }
+    describe( ch, deep );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 5.0, "40 deep sequence went to %g", rec[ch].dest );
+
+    // expressions deeper than the value stack fail to compile, & leave nothing to run
+    FL_node* e = fl_num(1);
+    for( int i=0; i<EVAL_DEPTH; i++ ){ e = op( "+", fl_num(1), e ); }
+    printf("(an expression too complex error is expected)\n");
+    describe( ch, fl_table( 4, fl_str("TO"), e, fl_num(1), fl_str("linear") ) );
+    CHECK( casl_usage( ch, POOL_Code ) == 0, "too complex expression left %d ops", casl_usage( ch, POOL_Code ) );
+    rec[ch].towards = 0;
+    casl_action( ch, 1 );
+    CHECK( rec[ch].towards == 0, "ran a failed program" );
+
+    // a breakpoint from the old program while describing mustn't run either program
+    describe( ch, loop( fl_table( 2, to( 1, 1, "linear" ), to( 2, 1, "linear" ) ) ) );
+    casl_action( ch, 1 );
+    rec[ch].towards = 0;
+    done[ch] = 0;
+    isr_channel = ch;
+    isr_countdown = 2;
+    describe( ch, to( 7, 1, "linear" ) );
+    CHECK( isr_channel < 0, "breakpoint didn't fire during describe" );
+    CHECK( rec[ch].towards == 0 && done[ch] == 0, "a program ran while busy" );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 7.0, "new program went to %g", rec[ch].dest );
+}
+
+
+///////////////////////////////
+// describe cache
+
+static FL_node* vco( float freq, float level, const char* wave )
+{
+    return fl_table( 4, fl_str("VCO"), fl_num(freq), fl_num(level), fl_str(wave) );
+}
+
+// ar() from lua/asllib.lua
+static FL_node* ar( float a, float r, float level )
+{
+    return fl_table( 2, to( level, a, "log" ), to( 0, r, "log" ) );
+}
+
+static void cache( void )
+{
+    int ch = 5;
+    casl_cleardynamics( ch );
+
+    // re-describing the same structure runs the new numbers
+    describe( ch, ar( 0.1, 0.5, 7.0 ) );
+    int ops = casl_usage( ch, POOL_Code );
+    describe( ch, ar( 0.2, 1.5, 3.0 ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 3.0 && rec[ch].ms == 200.0, "patched ar() went to (%g,%g)", rec[ch].dest, rec[ch].ms );
+    breakpoint( ch );
+    CHECK( rec[ch].dest == 0.0 && rec[ch].ms == 1500.0, "patched ar() went to (%g,%g)", rec[ch].dest, rec[ch].ms );
+    CHECK( casl_usage( ch, POOL_Code ) == ops, "re-describe grew from %d to %d ops", ops, casl_usage( ch, POOL_Code ) );
+
+    // a different structure is recompiled
+    describe( ch, fl_table( 3, to( 1, 1, "linear" ), to( 2, 1, "linear" ), to( 3, 1, "linear" ) ) );
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, 1, 2, 3 );
+
+    // so is a different wave, which is compiled into the op rather than a literal
+    describe( ch, vco( 110, 3, "sine" ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].wave == WAVE_Sine, "vco wave %d", rec[ch].wave );
+    describe( ch, vco( 110, 3, "saw" ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].wave == WAVE_Saw, "re-described vco kept wave %d", rec[ch].wave );
+    describe( ch, vco( 220, 3, "tri" ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].wave == WAVE_Tri && rec[ch].freq == 220.0, "vco went to %gHz, wave %d", rec[ch].freq, rec[ch].wave );
+
+    // mutables restart from their described value
+    FL_node* counter = loop( fl_table( 1
+        , fl_table( 4, fl_str("TO"), op( "#", op( "+", mut(0), fl_num(1) ), NULL ), fl_num(1), fl_str("linear") ) ) );
+    describe( ch, counter );
+    casl_action( ch, 1 );
+    EXPECT_RUN( ch, 1, 2, 3 );
+    describe( ch, counter );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 1.0, "re-described mutable started at %g", rec[ch].dest );
+
+    // describes per second: retriggering ar() with new times, against alternating structures
+    int n = 200000;
+    static lua_State* hits[64];
+    static lua_State* misses[64];
+    for( int i=0; i<64; i++ ){
+        hits[i] = fl_state( ar( 0.01 * (float)(i+1), 0.5, 5.0 ) );
+        misses[i] = fl_state( (i & 1) ? ar( 0.01 * (float)(i+1), 0.5, 5.0 )
+                                      : fl_table( 1, to( (float)i, 0.5, "log" ) ) );
+    }
+    printf("describes per second\n");
+    double t0 = host_seconds();
+    for( int i=0; i<n; i++ ){ casl_describe( ch, misses[i & 63] ); }
+    host_bench( "recompiled", n, host_seconds() - t0 );
+    t0 = host_seconds();
+    for( int i=0; i<n; i++ ){ casl_describe( ch, hits[i & 63] ); }
+    host_bench( "cached, literals patched", n, host_seconds() - t0 );
+}
+
+
+///////////////////////////////
+// sharing. a channel describing a program another runs uses that channel's code
+
+static void sharing( void )
+{
+    for( int ch=0; ch<4; ch++ ){ casl_cleardynamics( ch ); }
+
+    // waves & shapes are compiled into the ops, so they must never share
+    describe( 0, vco( 110, 3, "sine" ) );
+    describe( 1, vco( 110, 3, "saw" ) );
+    describe( 2, vco( 110, 3, "sine" ) );
+    describe( 3, vco( 110, 3, "saw" ) );
+    CHECK( casl_usage( 1, POOL_Code ) > 0, "saw vco shared the sine program" );
+    CHECK( casl_usage( 2, POOL_Code ) == 0 && casl_usage( 3, POOL_Code ) == 0
+         , "identical vcos didn't share (%d & %d ops)", casl_usage( 2, POOL_Code ), casl_usage( 3, POOL_Code ) );
+    Wave_t waves[4] = { WAVE_Sine, WAVE_Saw, WAVE_Sine, WAVE_Saw };
+    for( int ch=0; ch<4; ch++ ){
+        casl_action( ch, 1 );
+        CHECK( rec[ch].wave == waves[ch], "ch%d vco ran wave %d, expected %d", ch, rec[ch].wave, waves[ch] );
+    }
+
+    // the owner moving on hands the code to the channel sharing it
+    describe( 0, to( 1, 1, "linear" ) );
+    casl_action( 2, 1 );
+    CHECK( rec[2].wave == WAVE_Sine && casl_usage( 2, POOL_Code ) > 0
+         , "inherited vco ran wave %d from %d ops", rec[2].wave, casl_usage( 2, POOL_Code ) );
+
+    describe( 1, to( 1, 1, "linear" ) );
+    describe( 2, to( 1, 1, "expo" ) );
+    describe( 3, to( 1, 1, "linear" ) );
+    CHECK( casl_usage( 2, POOL_Code ) > 0, "expo to() shared the linear program" );
+    CHECK( casl_usage( 1, POOL_Code ) == 0 && casl_usage( 3, POOL_Code ) == 0
+         , "identical to()s didn't share" );
+    Shape_t shapes[4] = { SHAPE_Linear, SHAPE_Linear, SHAPE_Expo, SHAPE_Linear };
+    for( int ch=0; ch<4; ch++ ){
+        casl_action( ch, 1 );
+        CHECK( rec[ch].shape == shapes[ch], "ch%d to() ran shape %d, expected %d", ch, rec[ch].shape, shapes[ch] );
+    }
+}
+
+
+///////////////////////////////
+// user curves are referenced by the programs & output shapes using them
+
+static FL_node* to_curve( float volts, int curve )
+{
+    return fl_table( 4, fl_str("TO"), fl_num(volts), fl_num(1), fl_table( 2, fl_str("CURVE"), fl_num(curve) ) );
+}
+
+static void curves( void )
+{
+    shapes_curve_clear();
+    float levels[3] = { 0.0, 1.0, 0.5 };
+    int a = shapes_curve_define( NULL, levels, 3 );
+    levels[1] = 0.25;
+    int b = shapes_curve_define( NULL, levels, 3 );
+
+    describe( 0, to_curve( 1, a ) );
+    describe( 1, to_curve( 1, a ) ); // shares ch0's code, so no new reference
+    CHECK( shapes_curve_refs( a ) == 1, "curve used by a shared program has %d refs", shapes_curve_refs( a ) );
+    casl_action( 1, 1 );
+    CHECK( rec[1].shape == SHAPE_Curve + a, "ran shape %d, expected curve %d", rec[1].shape, a );
+
+    describe( 0, to( 1, 1, "linear" ) ); // hands the code to ch1
+    CHECK( shapes_curve_refs( a ) == 1, "handing over the code left %d refs", shapes_curve_refs( a ) );
+    describe( 1, to_curve( 2, b ) ); // same structure, so the literals are patched
+    CHECK( shapes_curve_refs( a ) == 0 && shapes_curve_refs( b ) == 1
+         , "patched curve refs %d & %d, expected 0 & 1", shapes_curve_refs( a ), shapes_curve_refs( b ) );
+    describe( 1, to( 1, 1, "linear" ) );
+    CHECK( shapes_curve_refs( b ) == 0, "re-describing left %d refs", shapes_curve_refs( b ) );
+
+    // output shape & volts
+    casl_setshape( 2, SHAPE_Curve + a );
+    casl_volts( 2, 1.0 );
+    casl_volts( 2, 2.0 ); // updates the literals in place
+    CHECK( shapes_curve_refs( a ) == 2, "shape & volts program hold %d refs", shapes_curve_refs( a ) );
+    casl_setshape( 2, SHAPE_Linear );
+    casl_volts( 2, 3.0 );
+    CHECK( shapes_curve_refs( a ) == 0, "resetting the shape left %d refs", shapes_curve_refs( a ) );
+
+    // a live-coded curve is redefined every describe, & never runs out of slots
+    int failed = 0;
+    for( int i=0; i<4 * CURVE_COUNT; i++ ){
+        levels[1] = 0.01 * (float)i; // a new curve each time
+        int c = shapes_curve_define( NULL, levels, 3 );
+        if( c < 0 ){ failed++; continue; }
+        describe( 3, to_curve( 1, c ) );
+    }
+    CHECK( failed == 0, "%d of %d curves found no slot", failed, 4 * CURVE_COUNT );
+    describe( 3, to( 1, 1, "linear" ) );
+    for( int i=0; i<CURVE_COUNT; i++ ){
+        CHECK( shapes_curve_refs( i ) == 0, "curve %d kept %d refs", i, shapes_curve_refs( i ) );
+    }
+}
+
+
+///////////////////////////////
+// sequins. the expected values are asserted against lua/sequins.lua in tests/sequins.lua
+// where lua returns 'skip' or 'dead' the previous value is held
+
+#define SEQ_STAGES 10
+
+static FL_node* seq( int len, const float* vals, int step, int every, int times, int count )
+{
+    FL_node* data = fl_table( 0 );
+    for( int i=0; i<len; i++ ){ fl_append( data, fl_num( vals[i] ) ); }
+    return fl_table( 6, fl_str("SEQ"), data, fl_num(step), fl_num(every), fl_num(times), fl_num(count) );
+}
+
+static void sequins( void )
+{
+    struct{
+        const char* name;
+        int   len;
+        float vals[4];
+        int   step, every, times, count;
+        float expect[SEQ_STAGES];
+    } t[] =
+        { { "step(2)",          3, {0,3,7},   2, 0, 0, 0, {0,7,3,0,7,3,0,7,3,0} }
+        , { "step(-1)",         4, {1,2,3,4},-1, 0, 0, 0, {1,4,3,2,1,4,3,2,1,4} }
+        , { "every(2)",         3, {1,2,3},   1, 2, 0, 0, {1,1,1,2,2,3,3,1,1,2} }
+        , { "times(4)",         3, {1,2,3},   1, 0, 4, 0, {1,2,3,1,1,1,1,1,1,1} }
+        , { "every(3):count(2)",4, {1,2,3,4}, 1, 3, 0, 2, {1,1,1,2,2,2,3,4,4,4} }
+        , { "every(2):times(2)",2, {5,6},     1, 2, 2, 0, {5,5,5,6,6,6,6,6,6,6} }
+        };
+    int ch = 6;
+    casl_cleardynamics( ch );
+    for( int i=0; i<(int)(sizeof(t)/sizeof(t[0])); i++ ){
+        describe( ch, loop( fl_table( 1, fl_table( 4, fl_str("TO")
+            , seq( t[i].len, t[i].vals, t[i].step, t[i].every, t[i].times, t[i].count )
+            , fl_num(1), fl_str("linear") ) ) ) );
+        float got[SEQ_STAGES];
+        casl_action( ch, 1 );
+        got[0] = rec[ch].dest;
+        run( ch, &got[1], SEQ_STAGES-1 );
+        CHECK( same( got, t[i].expect, SEQ_STAGES )
+             , "sequins %s went %g %g %g %g %g %g %g %g %g %g", t[i].name
+             , got[0], got[1], got[2], got[3], got[4], got[5], got[6], got[7], got[8], got[9] );
+
+        // restarts when described again
+        describe( ch, loop( fl_table( 1, fl_table( 4, fl_str("TO")
+            , seq( t[i].len, t[i].vals, t[i].step, t[i].every, t[i].times, t[i].count )
+            , fl_num(1), fl_str("linear") ) ) ) );
+        casl_action( ch, 1 );
+        CHECK( rec[ch].dest == t[i].expect[0], "re-described sequins %s started at %g", t[i].name, rec[ch].dest );
+    }
+}
+
+
+///////////////////////////////
+// shared pools
+
+static void pools( void )
+{
+    casl_init( CHANNELS ); // fresh, empty pools
+    CHECK( casl_usage( -1, POOL_Code ) == 0, "new pools hold %d ops", casl_usage( -1, POOL_Code ) );
+
+    // one output borrows far beyond the average budget while the others run a to()
+    for( int ch=1; ch<4; ch++ ){ describe( ch, to( (float)ch, 1.0, "linear" ) ); }
+    describe( 0, stages( 40, 100.0 ) );
+    CHECK( casl_usage( 0, POOL_Code ) > CODE_COUNT, "40 stages used only %d ops", casl_usage( 0, POOL_Code ) );
+    CHECK( runs_stages( 0, 40, 100.0 ), "40 stage sequence didn't run in order" );
+
+    // re-describing channels in the middle of the pool, bigger then smaller, keeps
+    // the pool packed & every other program intact
+    for( int round=0; round<20; round++ ){
+        int ch = 1 + round % 3;
+        int n  = (round & 1) ? 1 : 12 + round;
+        describe( ch, stages( n, (float)(10 * ch) ) );
+        CHECK( casl_usage( -1, POOL_Code ) == total_usage( POOL_Code )
+             , "round %d: pool holds %d ops, channels own %d"
+             , round, casl_usage( -1, POOL_Code ), total_usage( POOL_Code ) );
+        CHECK( runs_stages( ch, n, (float)(10 * ch) ), "round %d: ch%d lost its program", round, ch );
+    }
+    CHECK( runs_stages( 0, 40, 100.0 ), "40 stage sequence damaged by compaction" );
+
+    // dynamics are pooled the same way
+    int d0 = casl_defdynamic( 0 );
+    casl_setdynamic( 0, d0, 1.5 );
+    for( int i=0; i<5; i++ ){ casl_defdynamic( 1 ); }
+    int d2 = casl_defdynamic( 2 );
+    casl_setdynamic( 2, d2, 2.5 );
+    casl_cleardynamics( 1 );
+    CHECK( casl_usage( -1, POOL_Dyn ) == 2, "%d dynamics after clearing ch1", casl_usage( -1, POOL_Dyn ) );
+    CHECK( casl_getdynamic( 0, d0 ) == 1.5 && casl_getdynamic( 2, d2 ) == 2.5
+         , "dynamics moved to %g %g", casl_getdynamic( 0, d0 ), casl_getdynamic( 2, d2 ) );
+
+    // growing a block when there's no room to copy it rotates it in place instead
+    int cap  = casl_capacity( POOL_Dyn );
+    int fill = (cap - casl_usage( -1, POOL_Dyn )) / 2 - 1;
+    int wide[2] = { casl_defdynamic( 0 ), casl_defdynamic( 2 ) };
+    for( int i=1; i<fill; i++ ){ casl_defdynamic( 0 ); casl_defdynamic( 2 ); }
+    for( int i=0; i<2; i++ ){ casl_setdynamic( i * 2, wide[i], 7.0 + i ); }
+    int grew = casl_defdynamic( 0 ); // ch0 is before ch2, & all but a slot or two is used
+    CHECK( grew >= 0 && casl_getdynamic( 0, d0 ) == 1.5 && casl_getdynamic( 0, wide[0] ) == 7.0
+         && casl_getdynamic( 2, d2 ) == 2.5 && casl_getdynamic( 2, wide[1] ) == 8.0
+         , "rotating a full pool lost dynamics" );
+    casl_cleardynamics( 0 );
+    casl_cleardynamics( 2 );
+    d0 = casl_defdynamic( 0 );
+    d2 = casl_defdynamic( 2 );
+
+    // a failed describe frees the mutables it allocated, but keeps the named dynamics
+    FL_node* e = mut(1);
+    for( int i=0; i<EVAL_DEPTH; i++ ){ e = op( "+", fl_num(1), e ); }
+    printf("(an expression too complex error is expected)\n");
+    describe( 2, fl_table( 2, to( 1, 1, "linear" ), fl_table( 4, fl_str("TO"), e, fl_num(1), fl_str("linear") ) ) );
+    CHECK( casl_usage( 2, POOL_Code ) == 0 && casl_usage( 2, POOL_Dyn ) == 1
+         , "failed describe kept %d ops & %d dynamics", casl_usage( 2, POOL_Code ), casl_usage( 2, POOL_Dyn ) );
+
+    // a description that doesn't fit fails alone, & leaves its channel empty
+    int code = casl_usage( -1, POOL_Code );
+    int room = casl_capacity( POOL_Code ) - code + casl_usage( 3, POOL_Code );
+    int fits = (room - 1) / 4; // stages of 4 ops, after the sequence's Enter
+    printf("(an ASL too long error is expected)\n");
+    describe( 3, stages( fits + 1, 0.0 ) );
+    CHECK( casl_usage( 3, POOL_Code ) == 0, "failed describe kept %d ops", casl_usage( 3, POOL_Code ) );
+    CHECK( runs_stages( 0, 40, 100.0 ), "failed describe damaged another channel" );
+
+    // the freed space is usable again, up to capacity
+    describe( 3, stages( fits, 0.0 ) );
+    CHECK( runs_stages( 3, fits, 0.0 ), "ch3 couldn't use the remaining %d ops", room );
+
+    // resetting every channel to a to() leaves just those in the pools
+    for( int ch=0; ch<CHANNELS; ch++ ){
+        describe( ch, to( (float)ch, 1.0, "linear" ) ); // 3 literals & a To
+        casl_cleardynamics( ch );
+    }
+    CHECK( casl_usage( -1, POOL_Code ) == 4 * CHANNELS && casl_usage( -1, POOL_Dyn ) == 0
+         , "%d ops & %d dynamics remain after reset"
+         , casl_usage( -1, POOL_Code ), casl_usage( -1, POOL_Dyn ) );
+}
+
+///////////////////////////////
+// batched dynamics apply together, or not at all
+
+static void batches( void )
+{
+    int ch = 7;
+    casl_cleardynamics( ch );
+    int f = casl_defdynamic( ch );
+    int l = casl_defdynamic( ch );
+    int x = casl_defdynamic( ch );
+    casl_setdynamic( ch, f, 100 );
+    casl_setdynamic( ch, l, 2 );
+    describe( ch, fl_table( 4, fl_str("VCO"), dyn(f), dyn(l), fl_str("sine") ) );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].freq == 100.0 && rec[ch].level == 2.0, "vco started at %gHz %gV", rec[ch].freq, rec[ch].level );
+
+    // the running vco is retuned once, with every new value
+    int oscs = rec[ch].oscs;
+    int   ixs[3]  = { f, l, x };
+    float vals[3] = { 220, 3, 7 };
+    CHECK( casl_setdynamics( ch, ixs, vals, 3 ), "valid batch refused" );
+    CHECK( rec[ch].oscs == oscs + 1, "retuned %d times for one batch", rec[ch].oscs - oscs );
+    CHECK( rec[ch].freq == 220.0 && rec[ch].level == 3.0 && casl_getdynamic( ch, x ) == 7.0
+         , "batch retuned to %gHz %gV", rec[ch].freq, rec[ch].level );
+
+    // one bad index & nothing is written or retuned, wherever it is in the batch
+    int bad[3][3] = { { 3, l, x }, { f, -1, x }, { f, l, 99 } };
+    float news[3] = { 440, 4, 8 };
+    for( int b=0; b<3; b++ ){
+        oscs = rec[ch].oscs;
+        CHECK( !casl_setdynamics( ch, bad[b], news, 3 ), "batch %d with a bad index accepted", b );
+        CHECK( rec[ch].oscs == oscs && casl_getdynamic( ch, f ) == 220.0 && casl_getdynamic( ch, l ) == 3.0
+             && casl_getdynamic( ch, x ) == 7.0, "batch %d with a bad index was partly applied", b );
+    }
+    CHECK( !casl_setdynamics( CHANNELS, ixs, vals, 3 ), "batch for a missing channel accepted" );
+    casl_cleardynamics( ch );
+    CHECK( !casl_setdynamics( ch, ixs, vals, 1 ), "batch accepted after clearing the dynamics" );
+}
+
+
+///////////////////////////////
+// random operators. seeded, so a sequence of draws is repeatable
+
+#define DRAWS 50000
+
+// fills out[] with the destinations of a looping to(expr)
+static void draw( int ch, FL_node* expr, uint32_t seed, float* out, int n )
+{
+    describe( ch, loop( fl_table( 1, fl_table( 4, fl_str("TO"), expr, fl_num(1), fl_str("linear") ) ) ) );
+    casl_seed( seed );
+    casl_action( ch, 1 );
+    for( int i=0; i<n; i++ ){
+        out[i] = rec[ch].dest;
+        breakpoint( ch );
+    }
+}
+
+static void randoms( void )
+{
+    int ch = 6;
+    static float a[DRAWS], b[DRAWS];
+
+    // the same seed repeats, another seed doesn't
+    draw( ch, op( "RAND", fl_num(-2), fl_num(3) ), 1234, a, DRAWS );
+    draw( ch, op( "RAND", fl_num(-2), fl_num(3) ), 1234, b, DRAWS );
+    CHECK( memcmp( a, b, sizeof(a) ) == 0, "rand with the same seed gave another sequence" );
+    draw( ch, op( "RAND", fl_num(-2), fl_num(3) ), 1235, b, DRAWS );
+    int same = 0;
+    for( int i=0; i<DRAWS; i++ ){ if( a[i] == b[i] ){ same++; } }
+    CHECK( same < 10, "seeds 1234 & 1235 agree on %d of %d draws", same, DRAWS );
+
+    // draws stay in [lo, hi), & fill it evenly
+    int bins[10] = { 0 };
+    int outside = 0;
+    for( int i=0; i<DRAWS; i++ ){
+        if( a[i] < -2.0 || a[i] >= 3.0 ){ outside++; continue; }
+        bins[(int)((a[i] + 2.0) * 2.0)]++;
+    }
+    CHECK( outside == 0, "%d of %d rand draws outside [-2, 3)", outside, DRAWS );
+    for( int i=0; i<10; i++ ){
+        CHECK( abs( bins[i] - DRAWS/10 ) < DRAWS/100, "rand bin %d holds %d of %d", i, bins[i], DRAWS );
+    }
+
+    // a dynamic range is read at each draw, & may be reversed
+    int lo = casl_defdynamic( ch );
+    casl_setdynamic( ch, lo, 5.0 );
+    draw( ch, op( "RAND", dyn(lo), fl_num(1) ), 99, a, 0 );
+    outside = 0;
+    for( int i=0; i<1000; i++ ){
+        if( rec[ch].dest <= 1.0 || rec[ch].dest > 5.0 ){ outside++; }
+        breakpoint( ch );
+    }
+    CHECK( outside == 0, "%d of 1000 draws outside (1, 5]", outside );
+    casl_cleardynamics( ch );
+
+    // gaussian mean, deviation & shape
+    draw( ch, op( "GAUSS", fl_num(1), fl_num(2) ), 42, a, DRAWS );
+    draw( ch, op( "GAUSS", fl_num(1), fl_num(2) ), 42, b, DRAWS );
+    CHECK( memcmp( a, b, sizeof(a) ) == 0, "gauss with the same seed gave another sequence" );
+    double sum = 0.0, sq = 0.0;
+    int within = 0;
+    for( int i=0; i<DRAWS; i++ ){
+        sum += a[i];
+        sq  += (double)a[i] * a[i];
+        if( fabs( a[i] - 1.0 ) < 2.0 ){ within++; }
+    }
+    double mean = sum / DRAWS;
+    double dev  = sqrt( sq / DRAWS - mean * mean );
+    printf("gauss(1, 2) over %d draws: mean %.4f, deviation %.4f, %.4f within 1 deviation\n"
+          , DRAWS, mean, dev, (double)within / DRAWS);
+    CHECK( fabs( mean - 1.0 ) < 0.04, "gauss mean %g, expected 1", mean ); // ~4 standard errors
+    CHECK( fabs( dev - 2.0 ) < 0.04, "gauss deviation %g, expected 2", dev );
+    CHECK( fabs( (double)within / DRAWS - 0.6827 ) < 0.01, "%g of draws within 1 deviation, expected 0.683"
+         , (double)within / DRAWS );
+}
+
+// wrong types in a description fail its compile, without raising a lua error
+// (which would longjmp past the cleanup, leaving the channel busy & half written)
+static void malformed( void )
+{
+    int ch = 5;
+    casl_cleardynamics( ch );
+    casl_defdynamic( ch );
+    FL_node* one = fl_table( 1, fl_num(1) );
+    FL_node* mixed = fl_table( 3, fl_num(1), fl_str("a"), fl_num(3) );
+    FL_node* bad[] =
+        { fl_table( 6, fl_str("SEQ"), one, fl_str("x"), fl_num(0), fl_num(0), fl_num(0) ) // step
+        , fl_table( 6, fl_str("SEQ"), mixed, fl_num(1), fl_num(0), fl_num(0), fl_num(0) ) // a value
+        , fl_table( 6, fl_str("SEQ"), fl_num(5), fl_num(1), fl_num(0), fl_num(0), fl_num(0) ) // no values
+        , fl_table( 2, fl_str("DYN"), fl_str("x") )
+        , fl_table( 2, fl_str("NAMED"), fl_bool(1) )
+        , fl_table( 2, fl_str("CURVE"), fl_str("x") )
+        , fl_table( 2, fl_num(7), fl_num(1) ) // no op char
+        };
+    int count = sizeof(bad) / sizeof(bad[0]);
+    printf("(%d ASL type errors are expected)\n", count + 1);
+    for( int i=0; i<count; i++ ){
+        describe( ch, fl_table( 2, to( 1, 1, "linear" ) // compiled before the error
+                                 , fl_table( 4, fl_str("TO"), op( "+", mut(2), bad[i] ), fl_num(1), fl_str("linear") ) ) );
+        CHECK( casl_usage( ch, POOL_Code ) == 0 && casl_usage( ch, POOL_Seq ) == 0 && casl_usage( ch, POOL_Dyn ) == 1
+             , "bad element %d left %d ops, %d sequins & %d dynamics", i
+             , casl_usage( ch, POOL_Code ), casl_usage( ch, POOL_Seq ), casl_usage( ch, POOL_Dyn ) );
+    }
+    describe( ch, fl_table( 1, fl_num(3) ) ); // a stage that isn't a table or op
+    CHECK( casl_usage( ch, POOL_Code ) == 0, "number stage left %d ops", casl_usage( ch, POOL_Code ) );
+
+    // & the channel isn't left busy
+    describe( ch, to( 4, 1, "linear" ) );
+    rec[ch].towards = 0;
+    casl_action( ch, 1 );
+    CHECK( rec[ch].towards == 1 && rec[ch].dest == 4.0, "channel didn't run after the errors" );
+    casl_cleardynamics( ch );
+}
+
+static void volts_throughput( void )
+{
+    int n = 200000;
+    static lua_State* descs[1024]; // built up front, so only casl is timed
+    for( int i=0; i<1024; i++ ){ descs[i] = fl_state( to( (float)i / 100.0, 0.01, "linear" ) ); }
+    printf("output.volts updates per second\n");
+    double t0 = host_seconds();
+    for( int i=0; i<n; i++ ){
+        casl_describe( 2, descs[i & 1023] );
+        casl_action( 2, 1 );
+    }
+    host_bench( "describe + action", n, host_seconds() - t0 );
+    casl_setslew( 2, 0.01 );
+    t0 = host_seconds();
+    for( int i=0; i<n; i++ ){ casl_volts( 2, (float)(i & 1023) / 100.0 ); }
+    host_bench( "casl_volts", n, host_seconds() - t0 );
+}
+
+int main( void )
+{
+    casl_init( CHANNELS );
+    volts();
+    pools();
+    semantics();
+    cache();
+    sequins();
+    sharing();
+    curves();
+    malformed();
+    randoms();
+    batches();
+    volts_throughput();
+    return host_report("casl");
+}
@@ -0,0 +1,163 @@
+// dac8565 pickler: the fused pass against the chain it replaced, held channels, & cycles per block
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "dac8565.h"
+#include "adda.h"
+
+#define BLOCK ADDA_BLOCK_SIZE
+#define CHANS ADDA_DAC_CHAN_COUNT
+
+extern uint32_t* samples; // the DMA buffer from DAC_Init()
+extern float dac_calibrated_offset[];
+extern float dac_calibrated_scalar[];
+int32_t lim_i32_u16( int32_t v );
+
+// driven by the DMA callbacks on hardware
+void ADDA_BlockProcess( uint32_t* dac_pickle_ptr ){}
+void Debug_Pin_Set( uint8_t state ){}
+
+#define DAC_ZERO_VOLTS ((uint16_t)(((uint32_t)0xFFFF * 2)/3))
+
+// the original DAC_PickleBlock: calibrate in place, clamp & interleave, then pack bytes
+static void old_pickle( uint32_t* dac_pickle_ptr, float* unpickled_data, uint16_t bsize )
+{
+    for( uint8_t j=0; j<4; j++ ){
+        float* d = &unpickled_data[j*bsize];
+        for( int i=0; i<bsize; i++ ){ d[i] = d[i] + dac_calibrated_offset[j]; }
+    }
+    for( uint8_t j=0; j<4; j++ ){
+        float* d = &unpickled_data[j*bsize];
+        for( int i=0; i<bsize; i++ ){ d[i] = d[i] * dac_calibrated_scalar[j]; }
+    }
+
+    uint16_t usixteens[bsize * 4];
+    uint16_t* usixp = usixteens;
+    for( uint16_t i=0; i<bsize; i++ ){
+        for( uint8_t j=0; j<4; j++ ){
+            *usixp++ = (uint16_t)lim_i32_u16( DAC_ZERO_VOLTS
+                                            - (int32_t)(unpickled_data[i+j*bsize])
+                                            );
+        }
+    }
+
+    uint8_t* insert_p = (uint8_t*)dac_pickle_ptr;
+    usixp = usixteens;
+    for( uint16_t i=0; i<(bsize*4); i++ ){
+        *insert_p = *usixp>>8;
+        insert_p += 3;
+        *insert_p++ = *usixp++ & 0xFF;
+    }
+}
+
+// volts beyond both rails, so the clamp is exercised
+static void fill( float* out, int n )
+{
+    for( int i=0; i<n; i++ ){ out[i] = -7.0 + 19.0 * (float)rand() / (float)RAND_MAX; }
+}
+
+static void matches_old_chain( void )
+{
+    float cal_scale[CHANS]  = { 1.0, 0.997, 1.0031, 0.9912 };
+    float cal_offset[CHANS] = { 0.0, -0.013, 0.0072, 0.021 };
+    for( int j=0; j<CHANS; j++ ){
+        DAC_CalibrateScalar( j, cal_scale[j] );
+        DAC_CalibrateOffset( j, cal_offset[j] );
+    }
+
+    uint32_t ref[BLOCK * CHANS];
+    memcpy( ref, samples, sizeof(ref) ); // headers & 0v from DAC_Start()
+
+    float volts[BLOCK * CHANS];
+    float scratch[BLOCK * CHANS];
+    int mismatches = 0;
+    for( int b=0; b<2000; b++ ){
+        fill( volts, BLOCK * CHANS );
+        if( b == 0 ){ // exact rail & zero crossings
+            volts[0] = 0.0; volts[1] = 10.0; volts[2] = -5.0; volts[3] = 5.0;
+        }
+        memcpy( scratch, volts, sizeof(volts) );
+        old_pickle( ref, scratch, BLOCK );
+        DAC_PickleBlock( samples, volts, BLOCK, 0 );
+        for( int i=0; i<BLOCK * CHANS; i++ ){
+            if( samples[i] != ref[i] ){ mismatches++; }
+        }
+    }
+    CHECK( mismatches == 0, "%d packed words differ from the old chain", mismatches );
+}
+
+// held channels only provide their level in out[n][0], & are packed once per half
+static void held_channels( void )
+{
+    uint32_t* halves[2] = { samples, &samples[BLOCK * CHANS] };
+    float levels[CHANS] = { 1.25, -3.0, 7.5, 0.0 };
+    float block[BLOCK * CHANS];
+    uint32_t expect[BLOCK * CHANS];
+
+    for( int j=0; j<CHANS; j++ ){
+        for( int i=0; i<BLOCK; i++ ){ block[j*BLOCK + i] = levels[j]; }
+    }
+    DAC_PickleBlock( halves[0], block, BLOCK, 0 );
+    memcpy( expect, halves[0], sizeof(expect) );
+
+    float held[BLOCK * CHANS];
+    fill( held, BLOCK * CHANS ); // only [n*BLOCK] may be read
+    for( int j=0; j<CHANS; j++ ){ held[j*BLOCK] = levels[j]; }
+    for( int b=0; b<4; b++ ){
+        DAC_PickleBlock( halves[b & 1], held, BLOCK, 0xF );
+        CHECK( !memcmp( halves[b & 1], expect, sizeof(expect) )
+             , "held block %d differs from the same level packed in full", b );
+    }
+
+    // a cached half isn't rewritten
+    halves[1][0] = 0;
+    DAC_PickleBlock( halves[1], held, BLOCK, 0xF );
+    CHECK( halves[1][0] == 0, "held channel repacked while cached" );
+
+    // recalibrating a held channel repacks it in both halves
+    DAC_CalibrateOffset( 0, 0.5 );
+    for( int i=0; i<BLOCK; i++ ){ block[i] = levels[0]; }
+    DAC_PickleBlock( halves[0], block, BLOCK, 0 );
+    memcpy( expect, halves[0], sizeof(expect) );
+    for( int h=0; h<2; h++ ){
+        DAC_PickleBlock( halves[h], held, BLOCK, 0xF );
+        CHECK( !memcmp( halves[h], expect, sizeof(expect) )
+             , "half %d kept its stale level after calibration", h );
+    }
+    DAC_CalibrateOffset( 0, 0.0 );
+}
+
+static double time_pickle( int fused, uint8_t held, int blocks )
+{
+    static float volts[BLOCK * CHANS];
+    static uint32_t out[BLOCK * CHANS];
+    fill( volts, BLOCK * CHANS );
+    double t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        volts[b & (BLOCK * CHANS - 1)] += 1e-4; // keep the compiler honest
+        if( fused ){ DAC_PickleBlock( &samples[(b & 1) * BLOCK * CHANS], volts, BLOCK, held ); }
+        else{ old_pickle( out, volts, BLOCK ); }
+    }
+    return host_seconds() - t0;
+}
+
+static void throughput( void )
+{
+    int blocks = 500000;
+    printf("blocks per second\n");
+    host_bench( "separate passes", blocks, time_pickle( 0, 0, blocks ) );
+    host_bench( "fused", blocks, time_pickle( 1, 0, blocks ) );
+    host_bench( "fused, 4 channels held", blocks, time_pickle( 1, 0xF, blocks ) );
+}
+
+int main( void )
+{
+    DAC_Init( BLOCK, CHANS );
+    DAC_Start();
+    matches_old_chain();
+    held_channels();
+    throughput();
+    return host_report("dac");
+}
@@ -0,0 +1,374 @@
+// input detectors: edges found anywhere in the ADC block, at their exact sample
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "detect.h"
+
+#define BLOCK 32
+#define MAX_EVENTS 4096
+
+typedef struct{
+    float value;
+    long  at; // absolute sample index
+} Event;
+
+static Event events[MAX_EVENTS];
+static int   event_count;
+static long  block_start; // absolute index of the block being processed
+
+static void record( int channel, float value, int offset )
+{
+    if( event_count >= MAX_EVENTS ){ return; }
+    events[event_count].value = value;
+    events[event_count].at    = block_start + offset;
+    event_count++;
+}
+
+// runs a signal through input 0 in whole blocks
+static void feed( float* sig, int len )
+{
+    event_count = 0;
+    for( block_start=0; block_start + BLOCK <= len; block_start += BLOCK ){
+        Detect_process( 0, &sig[block_start], BLOCK );
+    }
+}
+
+
+///////////////////////////////
+// change
+
+#define PULSE_PERIOD 45 // not a multiple of the block, so edges land everywhere
+#define PULSES       384 // a whole number of blocks
+
+static float pulses[PULSE_PERIOD * PULSES];
+
+// pulses 1 to 5 samples wide, so many are shorter than a block & some straddle one
+static void build_pulses( void )
+{
+    for( int i=0; i<PULSE_PERIOD * PULSES; i++ ){
+        int p = i / PULSE_PERIOD;
+        pulses[i] = (i % PULSE_PERIOD < 1 + p % 5) ? 5.0 : 0.0;
+    }
+}
+
+static long rise_at( int p ){ return (long)p * PULSE_PERIOD; }
+static long fall_at( int p ){ return (long)p * PULSE_PERIOD + 1 + p % 5; }
+
+static void change( void )
+{
+    Detect_t* d = Detect_ix_to_p( 0 );
+
+    // both edges, in order, at the sample they happen
+    d->state = 0;
+    Detect_change( d, record, 1.0, 0.1, 0 );
+    feed( pulses, PULSE_PERIOD * PULSES );
+    CHECK( event_count == 2 * PULSES, "%d edges from %d pulses", event_count, PULSES );
+    int wrong = 0;
+    for( int p=0; p<PULSES; p++ ){
+        Event* r = &events[2*p];
+        Event* f = &events[2*p + 1];
+        if( r->value != 1.0 || r->at != rise_at(p) ){ wrong++; }
+        if( f->value != 0.0 || f->at != fall_at(p) ){ wrong++; }
+    }
+    CHECK( wrong == 0, "%d edges misplaced, e.g. rise at %ld, expected %ld"
+         , wrong, events[2].at, rise_at(1) );
+
+    // direction filters keep the same timing
+    d->state = 0;
+    Detect_change( d, record, 1.0, 0.1, Detect_str_to_dir("rising") );
+    feed( pulses, PULSE_PERIOD * PULSES );
+    wrong = 0;
+    for( int p=0; p<event_count; p++ ){
+        if( events[p].value != 1.0 || events[p].at != rise_at(p) ){ wrong++; }
+    }
+    CHECK( event_count == PULSES && wrong == 0, "%d rising edges, %d misplaced", event_count, wrong );
+
+    d->state = 0;
+    Detect_change( d, record, 1.0, 0.1, Detect_str_to_dir("falling") );
+    feed( pulses, PULSE_PERIOD * PULSES );
+    wrong = 0;
+    for( int p=0; p<event_count; p++ ){
+        if( events[p].value != 0.0 || events[p].at != fall_at(p) ){ wrong++; }
+    }
+    CHECK( event_count == PULSES && wrong == 0, "%d falling edges, %d misplaced", event_count, wrong );
+
+    // inside the hysteresis band is no edge at all
+    static float wobble[BLOCK * 8];
+    for( int i=0; i<BLOCK * 8; i++ ){ wobble[i] = (i & 1) ? 1.09 : 0.91; }
+    d->state = 0;
+    Detect_change( d, record, 1.0, 0.1, 0 );
+    feed( wobble, BLOCK * 8 );
+    CHECK( event_count == 0, "%d edges inside the hysteresis band", event_count );
+
+    Detect_none( d );
+}
+
+
+///////////////////////////////
+// window & scale. a ramp reports each boundary at the first sample past it
+
+static void ramp_boundaries( void )
+{
+    Detect_t* d = Detect_ix_to_p( 0 );
+    static float ramp[BLOCK * 64];
+    int len = BLOCK * 64;
+    for( int i=0; i<len; i++ ){ ramp[i] = -1.0 + 5.0 * (float)i / (float)len; }
+
+    float windows[3] = { 0.0, 1.0, 2.0 };
+    Detect_window( d, record, windows, 3, 0.0 );
+    feed( ramp, len );
+    CHECK( event_count == 4 && events[0].at == 0 && events[0].value == 1.0
+         , "%d window events, first %g at %ld", event_count, events[0].value, events[0].at );
+    for( int w=0; w<3 && w+1<event_count; w++ ){
+        Event* e = &events[w+1];
+        long expect = 0;
+        while( ramp[expect] < windows[w] ){ expect++; }
+        CHECK( e->value == (float)(w+2) && e->at == expect
+             , "entered window %g at %ld, expected %d at %ld", e->value, e->at, w+2, expect );
+    }
+
+    // a chromatic 1V/oct scale sees every semitone, each in its own block or not
+    Detect_scale( d, record, NULL, 0, 12.0, 1.0 );
+    feed( ramp, len );
+    CHECK( event_count == 5 * 12 + 1, "%d notes over 5 octaves", event_count );
+    long last = -1;
+    int disordered = 0;
+    for( int i=0; i<event_count; i++ ){
+        if( events[i].at <= last ){ disordered++; }
+        last = events[i].at;
+    }
+    CHECK( disordered == 0, "%d notes reported out of order", disordered );
+    // each crossing carries its own note's volts, not the latest of the block
+    int off_note = 0;
+    for( int i=0; i<event_count; i++ ){
+        float v = events[i].value;
+        if( fabsf( v - ramp[events[i].at] ) > 0.5 / 12.0 + 1e-5
+         || fabsf( v * 12.0 - roundf( v * 12.0 ) ) > 1e-4
+         || (i && fabsf( v - events[i-1].value - 1.0 / 12.0 ) > 1e-5) ){ off_note++; }
+    }
+    CHECK( off_note == 0, "%d notes carried another note's volts, e.g. %g at %g"
+         , off_note, events[1].value, ramp[events[1].at] );
+
+    // a fast slew crosses several notes in each block, & every one is distinct
+    static float fast[BLOCK * 4];
+    for( int i=0; i<BLOCK * 4; i++ ){ fast[i] = 2.0 * (float)i / (float)(BLOCK * 4); }
+    feed( fast, BLOCK * 4 );
+    off_note = 0;
+    for( int i=1; i<event_count; i++ ){
+        if( fabsf( events[i].value - events[i-1].value - 1.0 / 12.0 ) > 1e-5 ){ off_note++; }
+    }
+    CHECK( event_count >= 24 && off_note == 0, "%d notes from a 2V slew, %d not a semitone apart", event_count, off_note );
+
+    Detect_none( d );
+}
+
+
+///////////////////////////////
+// window hysteresis & search
+
+static uint32_t rand_state = 1;
+static float noise( float amp ) // uniform in [-amp, amp]
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return amp * ((float)(rand_state >> 8) / (float)(1 << 23) - 1.0);
+}
+
+// reference: 1-based window of level, by counting the boundaries at or below it
+static int window_of( float* sorted, int len, float level )
+{
+    int w = 1;
+    for( int i=0; i<len; i++ ){ if( level >= sorted[i] ){ w++; } }
+    return w;
+}
+
+static void windows( void )
+{
+    Detect_t* d = Detect_ix_to_p( 0 );
+
+    // a slow ramp with +/-10mV of noise, through boundaries given out of order
+    static float ramp[BLOCK * 1500];
+    int len = BLOCK * 1500;
+    rand_state = 1;
+    for( int i=0; i<len; i++ ){ ramp[i] = -1.0 + 5.0 * (float)i / (float)len + noise( 0.01 ); }
+    float bounds[4] = { 3.0, 0.0, 2.0, 1.0 };
+
+    Detect_window( d, record, bounds, 4, 0.0 );
+    feed( ramp, len );
+    int storm = event_count;
+    CHECK( storm > 5, "no chatter without hysteresis (%d events)", storm );
+
+    Detect_window( d, record, bounds, 4, 0.05 );
+    feed( ramp, len );
+    printf("window events on a noisy ramp: %d without hysteresis, %d with 50mV\n", storm, event_count);
+    CHECK( event_count == 5, "%d window events with hysteresis, expected 5", event_count );
+    for( int i=0; i<event_count; i++ ){
+        CHECK( events[i].value == (float)(i+1), "event %d entered window %g", i, events[i].value );
+    }
+    // each boundary is crossed once the noisy ramp is past it by the hysteresis
+    float sorted[4] = { 0.0, 1.0, 2.0, 3.0 };
+    for( int b=0; b<4 && b+1<event_count; b++ ){
+        long at = events[b+1].at;
+        CHECK( ramp[at] >= sorted[b] + 0.05 && (at == 0 || ramp[at-1] < sorted[b] + 0.05)
+             , "boundary %g crossed at %g (sample %ld)", sorted[b], ramp[at], at );
+    }
+
+    // falling back through, the sign reports the direction
+    for( int i=0; i<len/2; i++ ){
+        float t = ramp[i]; ramp[i] = ramp[len-1-i]; ramp[len-1-i] = t;
+    }
+    feed( ramp, len ); // carries on from the top window
+    CHECK( event_count == 4, "%d window events falling, expected 4", event_count );
+    for( int i=0; i<event_count; i++ ){
+        CHECK( events[i].value == -(float)(4-i), "falling event %d entered window %g", i, events[i].value );
+    }
+
+    // random jumps across the maximum count of windows land in the right one
+    float many[WINDOW_MAX_COUNT];
+    float many_sorted[WINDOW_MAX_COUNT];
+    for( int i=0; i<WINDOW_MAX_COUNT; i++ ){
+        many_sorted[i] = -3.2 + 0.1 * (float)i;
+        many[(i * 37) % WINDOW_MAX_COUNT] = many_sorted[i]; // scrambled
+    }
+    Detect_window( d, record, many, WINDOW_MAX_COUNT, 0.0 );
+    event_count = 0;
+    block_start = 0;
+    int current = 0;
+    int wrong   = 0;
+    rand_state  = 7;
+    for( int i=0; i<20000; i++ ){
+        float v = (i % 3 == 0) ? noise( 4.0 )                                    // far
+                : (i % 3 == 1) ? (float)current * 0.1 - 3.25 + noise( 0.12 )      // near
+                : many_sorted[(rand_state >> 8) % WINDOW_MAX_COUNT];              // on a boundary
+        int expect = window_of( many_sorted, WINDOW_MAX_COUNT, v );
+        event_count = 0;
+        Detect_process( 0, &v, 1 );
+        if( expect != current ){
+            float signed_expect = (expect > current) ? expect : -expect;
+            if( event_count != 1 || events[0].value != signed_expect ){ wrong++; }
+            current = expect;
+        } else if( event_count ){ wrong++; }
+    }
+    CHECK( wrong == 0, "%d of 20000 jumps across %d windows reported wrongly", wrong, WINDOW_MAX_COUNT );
+
+    Detect_none( d );
+}
+
+
+///////////////////////////////
+// chains: each slot runs its own mode & params over the same block
+
+static int streams;
+static void record_stream( int channel, float value, int offset ){ streams++; }
+
+static int highs;
+static void record_high( int channel, float value, int offset ){ highs++; }
+
+static void chains( void )
+{
+    Detect_t* edge   = Detect_chain_to_p( 0, 0 );
+    Detect_t* stream = Detect_chain_to_p( 0, 1 );
+    Detect_t* high   = Detect_chain_to_p( 0, 2 );
+    CHECK( edge == Detect_ix_to_p( 0 ) && stream && high && !Detect_chain_to_p( 0, DETECT_CHAIN )
+         , "chain slots not found" );
+
+    edge->state = 0;
+    high->state = 0;
+    Detect_change( edge, record, 1.0, 0.1, Detect_str_to_dir("rising") );
+    Detect_stream( stream, record_stream, 0.01 ); // every 15 blocks
+    Detect_change( high, record_high, 4.0, 0.1, 0 ); // a higher threshold, still crossed by the 5V pulses
+    streams = 0;
+    highs   = 0;
+    feed( pulses, PULSE_PERIOD * PULSES );
+    int blocks = PULSE_PERIOD * PULSES / BLOCK;
+    CHECK( event_count == PULSES, "%d rising edges with a chain, expected %d", event_count, PULSES );
+    CHECK( streams == blocks / 15, "%d streams over %d blocks, expected %d", streams, blocks, blocks / 15 );
+    CHECK( highs == 2 * PULSES, "%d edges at the chained 4V threshold, expected %d", highs, 2 * PULSES );
+    CHECK( edge->change.threshold == 1.0 && edge->change.direction == 1
+         , "chaining changed the first slot's params" );
+
+    // the first active slot with the callback is found
+    CHECK( Detect_find_action( 0, record_stream ) == stream, "stream slot not found by its action" );
+    CHECK( Detect_find_action( 0, record_high ) == high, "high slot not found by its action" );
+    CHECK( Detect_find_action( 1, record_stream ) == NULL, "input 1 found input 0's stream" );
+    Detect_stream( Detect_chain_to_p( 0, 3 ), record, 0.01 ); // record in slots 0 & 3
+    CHECK( Detect_find_action( 0, record ) == edge, "a later slot found before the first" );
+    Detect_none( edge );
+    CHECK( Detect_find_action( 0, record ) == Detect_chain_to_p( 0, 3 ), "cleared slot found by its stale action" );
+
+    // a cleared slot stops, & the rest of the chain runs on
+    Detect_none( stream );
+    streams = 0;
+    highs   = 0;
+    feed( pulses, PULSE_PERIOD * PULSES );
+    CHECK( streams == 0 && highs == 2 * PULSES, "after clearing: %d streams, %d high edges", streams, highs );
+    CHECK( Detect_find_action( 0, record_stream ) == NULL, "cleared stream still found" );
+
+    for( int i=0; i<DETECT_CHAIN; i++ ){ Detect_none( Detect_chain_to_p( 0, i ) ); }
+}
+
+
+///////////////////////////////
+// cost of scanning every sample
+
+static void throughput( void )
+{
+    Detect_t* d = Detect_ix_to_p( 0 );
+    int blocks = 200000;
+    int span   = PULSE_PERIOD * PULSES / BLOCK;
+    float windows[8] = { -4, -2, -1, 0, 1, 2, 3, 4 };
+    printf("blocks per second\n");
+
+    Detect_change( d, record, 1.0, 0.1, 0 );
+    double t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        event_count = 0;
+        Detect_process( 0, &pulses[(b % span) * BLOCK], BLOCK );
+    }
+    host_bench( "change", blocks, host_seconds() - t0 );
+
+    Detect_window( d, record, windows, 8, 0.05 );
+    t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        event_count = 0;
+        Detect_process( 0, &pulses[(b % span) * BLOCK], BLOCK );
+    }
+    host_bench( "window", blocks, host_seconds() - t0 );
+
+    // a noisy signal jumping about 64 windows, without & with hysteresis
+    static float jumpy[BLOCK * 256];
+    rand_state = 3;
+    for( int i=0; i<BLOCK * 256; i++ ){ jumpy[i] = 3.0 * sinf( (float)i * 0.01 ) + noise( 0.02 ); }
+    float many[WINDOW_MAX_COUNT];
+    for( int i=0; i<WINDOW_MAX_COUNT; i++ ){ many[i] = -3.2 + 0.1 * (float)i; }
+    Detect_window( d, record, many, WINDOW_MAX_COUNT, 0.0 );
+    t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        event_count = 0;
+        Detect_process( 0, &jumpy[(b & 255) * BLOCK], BLOCK );
+    }
+    host_bench( "64 windows", blocks, host_seconds() - t0 );
+    Detect_window( d, record, many, WINDOW_MAX_COUNT, 0.03 );
+    t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        event_count = 0;
+        Detect_process( 0, &jumpy[(b & 255) * BLOCK], BLOCK );
+    }
+    host_bench( "64 windows, 30mV hysteresis", blocks, host_seconds() - t0 );
+
+    Detect_none( d );
+}
+
+int main( void )
+{
+    Detect_init( 2 );
+    build_pulses();
+    change();
+    ramp_boundaries();
+    windows();
+    chains();
+    throughput();
+    Detect_deinit();
+    return host_report("detect");
+}
@@ -0,0 +1,130 @@
+// event queue: capture times are stamped when an event is posted, & survive the queue
+
+#include <stdlib.h>
+
+#include "host.h"
+#include "events.h"
+
+// the sample clock, advanced by hand
+static uint32_t now;
+uint32_t IO_GetTime( void ){ return now; }
+
+#define SEEN_MAX 64
+
+static uint32_t seen_time[SEEN_MAX];
+static int      seen_index[SEEN_MAX];
+static int      seen_count;
+
+static void handler( event_t* e )
+{
+    if( seen_count >= SEEN_MAX ){ return; }
+    seen_time[seen_count]  = e->time;
+    seen_index[seen_count] = e->index.i;
+    seen_count++;
+}
+
+static uint8_t post( int index ) // stamped by event_post
+{
+    event_t e = { .handler = handler
+                , .index.i = index
+                };
+    return event_post( &e );
+}
+
+static uint8_t post_at( int index, uint32_t time )
+{
+    event_t e = { .handler = handler
+                , .index.i = index
+                , .time    = time
+                , .timed   = true
+                };
+    return event_post( &e );
+}
+
+static void drain( void )
+{
+    seen_count = 0;
+    for( int i=0; i<SEEN_MAX; i++ ){ event_next(); }
+}
+
+// events posted as the clock advances keep their own time, however late they're handled
+static void stamped( void )
+{
+    events_clear();
+    now = 1000;
+    for( int i=0; i<10; i++ ){
+        post( i );
+        now += 37 * (i+1); // uneven gaps
+    }
+    now += 48000; // a second of main loop latency
+    drain();
+    CHECK( seen_count == 10, "%d of 10 events handled", seen_count );
+    uint32_t expect = 1000;
+    for( int i=0; i<seen_count; i++ ){
+        CHECK( seen_index[i] == i && seen_time[i] == expect
+             , "event %d (index %d) stamped %u, expected %u", i, seen_index[i], seen_time[i], expect );
+        expect += 37 * (i+1);
+    }
+}
+
+// a time from the source (eg. a detector's block time + offset) is kept as-is
+// including 0, which the clock passes through every ~24hrs
+static void explicit_times( void )
+{
+    events_clear();
+    now = 5000;
+    post_at( 0, 4321 );
+    post( 1 );
+    post_at( 2, 4999 );
+    post_at( 3, 0 );
+    now = 9000;
+    drain();
+    CHECK( seen_count == 4, "%d of 4 events handled", seen_count );
+    CHECK( seen_time[0] == 4321 && seen_time[1] == 5000 && seen_time[2] == 4999 && seen_time[3] == 0
+         , "times %u %u %u %u, expected 4321 5000 4999 0"
+         , seen_time[0], seen_time[1], seen_time[2], seen_time[3] );
+}
+
+// the clock wraps after ~24hrs. intervals measured by subtraction stay correct
+static void wrapping( void )
+{
+    events_clear();
+    now = 0xFFFFFFFF - 100;
+    post( 0 );
+    now += 250; // wraps to 149
+    post( 1 );
+    now += 1000;
+    drain();
+    CHECK( seen_count == 2 && seen_time[1] - seen_time[0] == 250
+         , "interval across the wrap measured %u", seen_time[1] - seen_time[0] );
+}
+
+// a full queue drops the new event, without disturbing those waiting
+static void full( void )
+{
+    events_clear();
+    now = 10;
+    int posted = 0;
+    printf("(event queue full messages are expected)\n");
+    for( int i=0; i<SEEN_MAX; i++ ){
+        if( post( i ) ){ posted++; }
+        now++;
+    }
+    CHECK( posted > 0 && posted < SEEN_MAX, "queue accepted %d of %d events", posted, SEEN_MAX );
+    drain();
+    int wrong = 0;
+    for( int i=0; i<seen_count; i++ ){
+        if( seen_index[i] != i || seen_time[i] != (uint32_t)(10 + i) ){ wrong++; }
+    }
+    CHECK( seen_count == posted && wrong == 0, "%d of %d queued events handled, %d wrong", seen_count, posted, wrong );
+}
+
+int main( void )
+{
+    events_init();
+    stamped();
+    explicit_times();
+    wrapping();
+    full();
+    return host_report("events");
+}
@@ -0,0 +1,108 @@
+// fastmath: error against libm across each function's domain, & throughput
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "host.h"
+#include "fastmath.h"
+
+static float from_bits( uint32_t u ){ float f; memcpy( &f, &u, 4 ); return f; }
+static uint32_t to_bits( float f ){ uint32_t u; memcpy( &u, &f, 4 ); return u; }
+
+// distance in units of the last place of the correctly rounded result
+static double ulps( float got, double ref )
+{
+    float r = (float)ref;
+    double ulp = (double)nextafterf( fabsf(r), INFINITY ) - (double)fabsf(r);
+    return fabs( (double)got - ref ) / ulp;
+}
+
+static void exp2_sweep( void )
+{
+    double worst = 0.0;
+    float  at = 0.0;
+    // every 61st float of each sign, within the normal result range
+    for( uint32_t u=0; u<0x7F800000; u+=61 ){
+        for( int sign=0; sign<2; sign++ ){
+            float x = from_bits( u | (sign ? 0x80000000 : 0) );
+            if( x <= -126.0 || x >= 128.0 ){ continue; }
+            double e = ulps( fast_exp2f(x), exp2( (double)x ) );
+            if( e > worst ){ worst = e; at = x; }
+        }
+    }
+    printf("  fast_exp2f  %.2f ulp (at %g)\n", worst, at);
+    CHECK( worst <= 3.0, "fast_exp2f is %g ulp out at %g", worst, at );
+}
+
+static void log2_sweep( void )
+{
+    double worst = 0.0, near_one = 0.0;
+    float  at = 0.0;
+    for( uint32_t u=to_bits(1.17549435e-38); u<0x7F800000; u+=61 ){ // normal x > 0
+        float x = from_bits( u );
+        double ref = log2( (double)x );
+        float got = fast_log2f(x);
+        if( ref != 0.0 ){
+            double e = ulps( got, ref );
+            if( e > worst ){ worst = e; at = x; }
+        }
+        if( x >= 0.5 && x <= 2.0 ){
+            double a = fabs( (double)got - ref );
+            if( a > near_one ){ near_one = a; }
+        }
+    }
+    // just intonation is log2 of a ratio near 1, at 1V/octave
+    printf("  fast_log2f  %.2f ulp (at %g), %.2e mV in [0.5,2]\n", worst, at, near_one * 1000.0);
+    CHECK( worst <= 4.0, "fast_log2f is %g ulp out at %g", worst, at );
+    CHECK( near_one <= 1.5e-7, "fast_log2f is %g out in [0.5,2]", near_one );
+    CHECK( isinf( fast_log2f(0.0) ) && fast_log2f(0.0) < 0.0, "log2(0) is %g", fast_log2f(0.0) );
+    CHECK( isinf( fast_log2f(-1.0) ) && fast_log2f(-1.0) < 0.0, "log2(-1) is %g", fast_log2f(-1.0) );
+}
+
+static void cos_sweep( void )
+{
+    double worst = 0.0;
+    float  at = 0.0;
+    for( int i=-10000000; i<=10000000; i++ ){
+        float x = (float)i * 1e-4; // |x| < 1000
+        double e = fabs( (double)fast_cosf(x) - cos( (double)x ) );
+        if( e > worst ){ worst = e; at = x; }
+    }
+    printf("  fast_cosf   %.2e absolute (at %g)\n", worst, at);
+    CHECK( worst <= 2.6e-7, "fast_cosf is %g out at %g", worst, at );
+}
+
+static volatile float sink;
+
+#define TIME( name, fn, count, arg ) do{ \
+        float acc = 0.0; \
+        double t0 = host_seconds(); \
+        for( int i=1; i<=(count); i++ ){ acc += fn( arg ); } \
+        host_bench( name, (count), host_seconds() - t0 ); \
+        sink = acc; \
+    } while(0)
+
+static float powf2( float x ){ return powf( 2.0, x ); }
+
+static void throughput( void )
+{
+    int n = 20000000;
+    printf("calls per second\n");
+    TIME( "fast_exp2f", fast_exp2f, n, (float)i * 1e-6 );
+    TIME( "powf(2,x)", powf2, n, (float)i * 1e-6 );
+    TIME( "fast_log2f", fast_log2f, n, (float)i * 1e-3 );
+    TIME( "logf", logf, n, (float)i * 1e-3 );
+    TIME( "fast_cosf", fast_cosf, n, (float)i * 1e-6 );
+    TIME( "cosf", cosf, n, (float)i * 1e-6 );
+}
+
+int main( void )
+{
+    printf("max error vs libm\n");
+    exp2_sweep();
+    log2_sweep();
+    cos_sweep();
+    throughput();
+    return host_report("fastmath");
+}
@@ -0,0 +1,181 @@
+// frequency tracking from ADC samples: error & settling time on synthetic tones
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "ftrack.h"
+
+#define BLOCK 32
+#define SR    48000.0
+#define PI    3.14159265358979323846
+
+typedef enum{ TONE_Sine, TONE_Square } Tone;
+
+typedef struct{
+    double phase; // cycles
+    double freq;
+    Tone   tone;
+    float  level; // peak volts
+    float  offset;
+} Osc;
+
+static void render( Osc* o, float* out, int size )
+{
+    for( int i=0; i<size; i++ ){
+        out[i] = o->offset + o->level * ((o->tone == TONE_Sine)
+                                            ? (float)sin( 2.0 * PI * o->phase )
+                                            : ((o->phase < 0.5) ? 1.0 : -1.0));
+        o->phase += o->freq / SR;
+        if( o->phase >= 1.0 ){ o->phase -= 1.0; }
+    }
+}
+
+// runs o for secs. returns the relative error at the end, & the latency until
+// the reading came within 1% & stayed there
+static double track( FTrack_t* f, Osc* o, double secs, double* latency )
+{
+    float buf[BLOCK];
+    int blocks = (int)(secs * SR / BLOCK);
+    *latency = -1.0;
+    double err = 1.0;
+    for( int b=0; b<blocks; b++ ){
+        render( o, buf, BLOCK );
+        FTrack_process( f, buf, BLOCK );
+        err = fabs( FTrack_get( f ) - o->freq ) / o->freq;
+        if( err < 1e-2 ){
+            if( *latency < 0.0 ){ *latency = (double)((b+1) * BLOCK) / SR; }
+        } else {
+            *latency = -1.0;
+        }
+    }
+    return err;
+}
+
+static void tones( void )
+{
+    // a naive square's edges land on whole samples, so at audio rates each
+    // period jitters by up to a sample & only the smoothing narrows it
+    struct{ double freq; Tone tone; float level; float offset; double bound; } t[] =
+        { {    0.5, TONE_Square, 5.0,  0.0, 1e-4 } // clocks & lfos
+        , {    2.0, TONE_Square, 2.5,  2.5, 1e-4 } // a 0-5V gate
+        , {    2.0, TONE_Sine,   5.0,  0.0, 1e-4 }
+        , {   13.7, TONE_Sine,   1.0, -3.0, 1e-4 }
+        , {   55.0, TONE_Sine,   5.0,  0.0, 1e-4 } // audio
+        , {  440.0, TONE_Sine,   1.0,  0.0, 1e-4 }
+        , { 1234.5, TONE_Square, 5.0,  0.0, 5e-3 }
+        , { 4000.0, TONE_Sine,   5.0,  0.0, 1e-4 }
+        };
+    printf("tone error & latency (within 1%%)\n");
+    for( int i=0; i<(int)(sizeof(t)/sizeof(t[0])); i++ ){
+        FTrack_t f;
+        FTrack_init( &f );
+        Osc o = { .phase = 0.3, .freq = t[i].freq, .tone = t[i].tone
+                , .level = t[i].level, .offset = t[i].offset };
+        double period = 1.0 / t[i].freq;
+        double secs   = 12.0 * period + 0.1; // a dozen cycles
+        double latency;
+        double err = track( &f, &o, secs, &latency );
+        printf("  %-6s %7.1fHz  error %.2e  latency %7.2fms  confidence %.2f\n"
+              , (t[i].tone == TONE_Sine) ? "sine" : "square"
+              , t[i].freq, err, latency * 1000.0, FTrack_get_confidence( &f ));
+        CHECK( err < t[i].bound, "%gHz tracked with error %g", t[i].freq, err );
+        // the first crossing may be mid-cycle, & the first whole cycle re-centers.
+        // the period after is within the 1%, though smoothing takes longer to reach 1e-4
+        double limit = 3.0 * period + 2.0 * BLOCK / SR;
+        CHECK( latency >= 0.0 && latency <= limit
+             , "%gHz settled after %gms, expected within %gms", t[i].freq, latency * 1000.0, limit * 1000.0 );
+        CHECK( FTrack_get_confidence( &f ) > 0.9, "%gHz confidence %g", t[i].freq, FTrack_get_confidence( &f ) );
+    }
+}
+
+// a new pitch is followed within a period, & silence drops confidence then the reading
+static void changes( void )
+{
+    FTrack_t f;
+    FTrack_init( &f );
+    Osc o = { .freq = 100.0, .tone = TONE_Sine, .level = 3.0 };
+    double latency;
+    track( &f, &o, 0.2, &latency );
+
+    o.freq = 300.0;
+    double err = track( &f, &o, 0.1, &latency );
+    CHECK( err < 1e-4 && latency <= 1.0 / 100.0 + 2.0 * BLOCK / SR
+         , "100 to 300Hz step settled after %gms, error %g", latency * 1000.0, err );
+
+    // an offset jump that no longer crosses the old center
+    o.offset = 4.0;
+    o.level  = 0.5;
+    err = track( &f, &o, 0.2, &latency );
+    CHECK( err < 1e-4, "after an offset jump error is %g", err );
+
+    // stopped
+    float buf[BLOCK] = { 0 };
+    for( int b=0; b<(int)(0.1 * SR / BLOCK); b++ ){ FTrack_process( &f, buf, BLOCK ); }
+    CHECK( FTrack_get_confidence( &f ) == 0.0, "confidence %g after 100ms of silence", FTrack_get_confidence( &f ) );
+    for( int b=0; b<(int)((FTRACK_TIMEOUT + 1.0) * SR / BLOCK); b++ ){ FTrack_process( &f, buf, BLOCK ); }
+    CHECK( FTrack_get( &f ) == 0.0, "reads %gHz after the timeout", FTrack_get( &f ) );
+
+    // small noise on a silent input is never a pitch
+    FTrack_init( &f );
+    uint32_t r = 1;
+    int reported = 0;
+    for( int b=0; b<(int)(2.0 * SR / BLOCK); b++ ){
+        for( int i=0; i<BLOCK; i++ ){
+            r = r * 1664525 + 1013904223;
+            buf[i] = 0.05 * ((float)(r >> 8) / (float)(1 << 23) - 1.0); // +/-50mV
+        }
+        FTrack_process( &f, buf, BLOCK );
+        if( FTrack_get( &f ) != 0.0 ){ reported++; }
+    }
+    CHECK( reported == 0, "noise read as a pitch for %d blocks", reported );
+}
+
+// signals under twice the hysteresis aren't tracked, until it's lowered
+static void small( void )
+{
+    FTrack_t f;
+    FTrack_init( &f );
+    Osc o = { .freq = 100.0, .tone = TONE_Sine, .level = 0.05, .offset = 1.0 }; // 100mVpp
+    double latency;
+    track( &f, &o, 0.5, &latency );
+    CHECK( FTrack_get( &f ) == 0.0, "100mVpp read as %gHz with the default hysteresis", FTrack_get( &f ) );
+
+    // the 1V offset doesn't cross the reset center, so it's found by the 50ms seek first
+    FTrack_set_hysteresis( &f, 0.01 );
+    double err = track( &f, &o, 0.5, &latency );
+    CHECK( err < 1e-4 && latency >= 0.0 && latency <= 0.05 + 3.0 / o.freq + 2.0 * BLOCK / SR
+         , "100mVpp with 10mV hysteresis: error %g, settled after %gms", err, latency * 1000.0 );
+
+    // a hysteresis of 0 would chatter on the smallest noise, so it's clamped
+    FTrack_set_hysteresis( &f, 0.0 );
+    CHECK( f.hysteresis == FTRACK_HYSTERESIS_MIN, "hysteresis clamped to %g", f.hysteresis );
+}
+
+// cost per block of an audio tone, crossing every few blocks
+static void throughput( void )
+{
+    FTrack_t f;
+    FTrack_init( &f );
+    static float buf[BLOCK * 64];
+    Osc o = { .freq = 750.0, .tone = TONE_Sine, .level = 5.0 }; // whole cycles in the buffer
+    render( &o, buf, BLOCK * 64 );
+    int blocks = 1000000;
+    printf("blocks per second\n");
+    volatile float sink = 0.0;
+    double t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        FTrack_process( &f, &buf[(b & 63) * BLOCK], BLOCK );
+        sink += FTrack_get( &f );
+    }
+    host_bench( "750Hz tone", blocks, host_seconds() - t0 );
+}
+
+int main( void )
+{
+    tones();
+    changes();
+    small();
+    throughput();
+    return host_report("ftrack");
+}
@@ -0,0 +1,121 @@
+// slope oscillator mode: aliasing floor of the band-limited waves against naive ones
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "slopes.h"
+
+#define N     16384   // fft size
+#define RATE  48000.0
+#define GUARD 8       // bins either side of a harmonic that belong to it
+#define BAND  12000.0 // aliases are measured below this. a 2 sample blep leaves some near nyquist
+#define FLOOR -90.0   // dB. the measurement's own floor, with float window & phase
+#define PI    3.14159265358979
+
+// in-place radix-2 fft
+static void fft( double* re, double* im, int n )
+{
+    for( int i=1, j=0; i<n; i++ ){
+        int bit = n >> 1;
+        for( ; j & bit; bit >>= 1 ){ j ^= bit; }
+        j ^= bit;
+        if( i < j ){
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for( int len=2; len<=n; len<<=1 ){
+        double a = -2.0 * PI / len;
+        for( int i=0; i<n; i+=len ){
+            for( int k=0; k<len/2; k++ ){
+                double wr = cos(a*k), wi = sin(a*k);
+                double* ur = &re[i+k];      double* ui = &im[i+k];
+                double* vr = &re[i+k+len/2]; double* vi = &im[i+k+len/2];
+                double xr = *vr * wr - *vi * wi;
+                double xi = *vr * wi + *vi * wr;
+                *vr = *ur - xr; *vi = *ui - xi;
+                *ur += xr;      *ui += xi;
+            }
+        }
+    }
+}
+
+// loudest component below max_hz that isn't a harmonic of freq, in dB relative to the fundamental
+static double alias_floor( const float* x, double freq, double max_hz )
+{
+    static double re[N], im[N];
+    for( int i=0; i<N; i++ ){ // blackman-harris window, sidelobes below -92dB
+        double p = 2.0 * PI * i / (N - 1);
+        double w = 0.35875 - 0.48829*cos(p) + 0.14128*cos(2*p) - 0.01168*cos(3*p);
+        re[i] = x[i] * w;
+        im[i] = 0.0;
+    }
+    fft( re, im, N );
+    double bin_hz = RATE / N;
+    double fund = 0.0, alias = 0.0;
+    for( int b=1; b<N/2; b++ ){
+        double p = re[b]*re[b] + im[b]*im[b];
+        double h = b * bin_hz / freq; // in harmonics
+        double off = fabs( h - floor( h + 0.5 ) ) * freq / bin_hz; // bins from nearest harmonic
+        if( off <= GUARD && h > 0.5 ){
+            if( h < 1.5 && p > fund ){ fund = p; }
+        } else if( p > alias && b * bin_hz < max_hz ){ alias = p; }
+    }
+    return 10.0 * log10( alias / fund );
+}
+
+static float wrap1( float t ){ return (t >= 1.0) ? t - 1.0 : t; }
+
+// the same waves without band-limiting, phase aligned with osc_v
+static void naive( Wave_t wave, double freq, float* out )
+{
+    float ph = 0.0, dt = freq / RATE;
+    for( int i=0; i<N; i++ ){
+        switch( wave ){
+            case WAVE_Saw:    out[i] = 2.0 * wrap1( ph + 0.5 ) - 1.0; break;
+            case WAVE_Square: out[i] = (ph < 0.5) ? 1.0 : -1.0; break;
+            case WAVE_Tri:    out[i] = 1.0 - 4.0 * fabsf( wrap1( ph + 0.25 ) - 0.5 ); break;
+            default:          out[i] = sinf( 6.2831853 * ph ); break;
+        }
+        ph = wrap1( ph + dt );
+    }
+}
+
+static void render( Wave_t wave, double freq, float* out )
+{
+    S_init( 1 );
+    S_oscillate( 0, freq, 1.0, wave );
+    for( int i=0; i<N; i+=32 ){ S_step_v( 0, &out[i], 32 ); }
+}
+
+static void aliasing( void )
+{
+    static float buf[N];
+    const char* names[] = { "saw", "square", "tri" };
+    Wave_t waves[] = { WAVE_Saw, WAVE_Square, WAVE_Tri };
+    double freqs[] = { 440.3, 1234.5, 3520.7 };
+    printf("alias floor below %gHz, dB re fundamental (naive -> band-limited)\n", BAND);
+    for( int i=0; i<3; i++ ){
+        for( int f=0; f<3; f++ ){
+            naive( waves[i], freqs[f], buf );
+            double before = alias_floor( buf, freqs[f], BAND );
+            render( waves[i], freqs[f], buf );
+            double after = alias_floor( buf, freqs[f], BAND );
+            printf("  %-6s %7.1fHz  %6.1f -> %6.1f\n", names[i], freqs[f], before, after);
+            CHECK( after < before - 20.0 || after < FLOOR, "%s at %gHz: alias floor %.1fdB, naive %.1fdB"
+                 , names[i], freqs[f], after, before );
+        }
+    }
+    // sine isn't band-limited, so this is the floor of fast_cosf & the measurement
+    render( WAVE_Sine, 1234.5, buf );
+    double sine = alias_floor( buf, 1234.5, RATE / 2.0 );
+    printf("  sine   %7.1fHz  %6.1f\n", 1234.5, sine);
+    CHECK( sine < FLOOR, "sine has components at %.1fdB", sine );
+}
+
+int main( void )
+{
+    aliasing();
+    return host_report("osc");
+}
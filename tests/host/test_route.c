@@ -0,0 +1,272 @@
+// routes: input edges & levels applied to casl channels from the DSP block
+// casl is real. slopes are replaced by stand-ins that record what the program asked for
+
+#include <string.h>
+
+#include "host.h"
+#include "fakelua.h"
+#include "casl.h"
+#include "route.h"
+
+#define INPUTS   2
+#define CHANNELS 4
+#define BLOCK    32
+
+// last request made of each slope
+typedef struct{
+    int        towards; // S_toward calls
+    float      dest;
+    Callback_t cb;
+} Record;
+
+static Record rec[CHANNELS];
+
+void S_toward( int index, float destination, float ms, Shape_t shape, Callback_t cb )
+{
+    Record* r = &rec[index];
+    r->towards++;
+    r->dest = destination;
+    r->cb   = (ms > 0.0) ? cb : NULL;
+}
+void S_oscillate( int index, float freq, float level, Wave_t wave ){ rec[index].cb = NULL; }
+float S_get_state( int index ){ return rec[index].dest; }
+Wave_t S_str_to_wave( const char* s ){ return WAVE_Sine; }
+void L_queue_asl_done( int id ){}
+
+// the DSP can run a block while casl_describe is compiling. this processes one
+// on input isr_input at the nth shape parsed
+static int    isr_input = -1;
+static int    isr_countdown;
+static float* isr_block;
+
+Shape_t S_str_to_shape( const char* s )
+{
+    if( isr_input >= 0 && --isr_countdown == 0 ){
+        Route_process( isr_input, isr_block, BLOCK );
+        isr_input = -1;
+    }
+    return (*s == 'n') ? SHAPE_Now : SHAPE_Linear;
+}
+
+static FL_node* to( float volts, float time, const char* shape )
+{
+    return fl_table( 4, fl_str("TO"), fl_num(volts), fl_num(time), fl_str(shape) );
+}
+
+static void describe( int ch, FL_node* d )
+{
+    casl_describe( ch, fl_state( d ) );
+}
+
+static FL_node* dyn( int ix ){ return fl_table( 2, fl_str("DYN"), fl_num( (float)ix ) ); }
+
+// held{} as lua/asl.lua builds it
+static FL_node* held( FL_node* t, int held_dyn )
+{
+    fl_prepend( t, fl_table( 1, fl_str("HELD") ) );
+    fl_append( t, fl_table( 1, fl_str("WAIT") ) );
+    fl_append( t, fl_table( 1, fl_str("UNHELD") ) );
+    fl_prepend( t, fl_table( 2, fl_str("IF"), dyn( held_dyn ) ) );
+    return t;
+}
+
+static float block[BLOCK];
+
+static void level( int input, float v )
+{
+    for( int i=0; i<BLOCK; i++ ){ block[i] = v; }
+    Route_process( input, block, BLOCK );
+}
+
+// n pulses of width samples, every period samples, through input in whole blocks
+// returns the number of restarts of ch
+static int pulses( int input, int ch, int n, int width, int period )
+{
+    int before = rec[ch].towards;
+    int len = n * period;
+    for( int b=0; b<len; b+=BLOCK ){
+        for( int i=0; i<BLOCK; i++ ){
+            int at = b + i;
+            block[i] = (at < len && at % period < width) ? 3.0 : 0.0;
+        }
+        Route_process( input, block, BLOCK );
+    }
+    return rec[ch].towards - before;
+}
+
+
+///////////////////////////////
+// triggers
+
+static void triggers( void )
+{
+    int ch = 0;
+    describe( ch, to( 5, 1, "linear" ) ); // each restart is one S_toward
+    level( 0, 0.0 );
+
+    // pulses shorter than a block are each seen once
+    Route_trigger( 0, ch, 1.0, 0.1, 1, -1 );
+    int n = pulses( 0, ch, 20, 3, 45 );
+    CHECK( n == 20, "rising: %d restarts from 20 pulses", n );
+    Route_clear( 0 );
+
+    Route_trigger( 0, ch, 1.0, 0.1, -1, -1 );
+    n = pulses( 0, ch, 20, 3, 45 );
+    CHECK( n == 20, "falling: %d restarts from 20 pulses", n );
+    int before = rec[ch].towards;
+    level( 0, 3.0 ); // a rise alone isn't a falling edge
+    CHECK( rec[ch].towards == before, "falling trigger fired on a rise" );
+    level( 0, 0.0 );
+    Route_clear( 0 );
+
+    // without held{} there's nothing for a falling edge to release
+    Route_trigger( 0, ch, 1.0, 0.1, 0, -1 );
+    n = pulses( 0, ch, 20, 3, 45 );
+    CHECK( n == 20, "both without held{}: %d restarts from 20 pulses", n );
+
+    // inside the hysteresis band is no edge
+    for( int i=0; i<BLOCK; i++ ){ block[i] = (i & 1) ? 1.09 : 0.91; }
+    before = rec[ch].towards;
+    for( int b=0; b<10; b++ ){ Route_process( 0, block, BLOCK ); }
+    CHECK( rec[ch].towards == before, "%d triggers inside the hysteresis band", rec[ch].towards - before );
+    Route_clear( 0 );
+
+    // gate: the rise sets held{} & restarts, the fall clears it & releases
+    int h = casl_defdynamic( ch );
+    describe( ch, fl_table( 2, held( fl_table( 1, to( 5, 1, "linear" ) ), h ), to( 0, 1, "linear" ) ) );
+    Route_trigger( 0, ch, 1.0, 0.1, 0, h );
+    level( 0, 3.0 );
+    CHECK( casl_getdynamic( ch, h ) == 1.0 && rec[ch].dest == 5.0
+         , "gate on: held %g, heading to %g", casl_getdynamic( ch, h ), rec[ch].dest );
+    level( 0, 0.0 );
+    CHECK( casl_getdynamic( ch, h ) == 0.0 && rec[ch].dest == 0.0
+         , "gate off: held %g, heading to %g", casl_getdynamic( ch, h ), rec[ch].dest );
+
+    // a rising trigger still sets held{}, as Asl:action does
+    Route_clear( 0 );
+    Route_trigger( 0, ch, 1.0, 0.1, 1, h );
+    level( 0, 3.0 );
+    level( 0, 0.0 );
+    CHECK( casl_getdynamic( ch, h ) == 1.0 && rec[ch].dest == 5.0
+         , "rising with held{}: held %g, heading to %g", casl_getdynamic( ch, h ), rec[ch].dest );
+
+    Route_clear( -1 );
+    casl_cleardynamics( ch );
+}
+
+
+///////////////////////////////
+// cv
+
+static void cv( void )
+{
+    int ch = 1;
+    int d = casl_defdynamic( ch );
+    Route_cv( 1, ch, d, 2.0, -1.0 );
+    for( int i=0; i<BLOCK; i++ ){ block[i] = (float)i; } // only the block's last sample is used
+    block[BLOCK-1] = 1.5;
+    Route_process( 1, block, BLOCK );
+    CHECK( casl_getdynamic( ch, d ) == 2.0, "cv 1.5 * 2 - 1 wrote %g", casl_getdynamic( ch, d ) );
+    level( 1, -4.0 );
+    CHECK( casl_getdynamic( ch, d ) == -9.0, "cv -4 * 2 - 1 wrote %g", casl_getdynamic( ch, d ) );
+    level( 0, 4.0 ); // another input
+    CHECK( casl_getdynamic( ch, d ) == -9.0, "input 1 route followed input 0" );
+
+    // the dynamic feeds the program at its next stage
+    describe( ch, fl_table( 1, fl_table( 4, fl_str("TO"), dyn( d ), fl_num(1), fl_str("linear") ) ) );
+    level( 1, 0.75 );
+    casl_action( ch, 1 );
+    CHECK( rec[ch].dest == 0.5, "program read %g from the routed dynamic", rec[ch].dest );
+
+    Route_clear( -1 );
+    casl_cleardynamics( ch );
+}
+
+
+///////////////////////////////
+// clearing keeps the remaining routes packed & working
+
+static void clearing( void )
+{
+    for( int ch=0; ch<CHANNELS; ch++ ){ describe( ch, to( 5, 1, "linear" ) ); }
+    level( 0, 0.0 );
+    level( 1, 0.0 );
+    // interleaved routes, input 0 to channels 0 & 2, input 1 to channels 1 & 3
+    for( int ch=0; ch<CHANNELS; ch++ ){
+        CHECK( Route_trigger( ch & 1, ch, 1.0, 0.1, 1, -1 ) == ch, "route %d not packed", ch );
+    }
+    Route_clear( 0 );
+    int fired[CHANNELS];
+    for( int ch=0; ch<CHANNELS; ch++ ){ fired[ch] = rec[ch].towards; }
+    pulses( 0, 0, 5, 3, 45 );
+    pulses( 1, 1, 5, 3, 45 );
+    for( int ch=0; ch<CHANNELS; ch++ ){
+        int expect = (ch & 1) ? 5 : 0;
+        CHECK( rec[ch].towards - fired[ch] == expect, "after clearing input 0, ch%d fired %d times, expected %d"
+             , ch, rec[ch].towards - fired[ch], expect );
+    }
+
+    // the freed routes are reused, up to ROUTE_COUNT
+    int added = 0;
+    printf("(no routes left & route out of range messages are expected)\n");
+    while( Route_cv( 0, 0, 0, 1.0, 0.0 ) >= 0 ){ added++; }
+    CHECK( added == ROUTE_COUNT - 2, "%d routes added after clearing, expected %d", added, ROUTE_COUNT - 2 );
+    for( int ch=0; ch<CHANNELS; ch++ ){ fired[ch] = rec[ch].towards; }
+    pulses( 1, 1, 5, 3, 45 );
+    CHECK( rec[1].towards - fired[1] == 5 && rec[3].towards - fired[3] == 5, "input 1 routes lost by clearing" );
+
+    Route_clear( -1 );
+    int before = rec[1].towards;
+    pulses( 1, 1, 5, 3, 45 );
+    CHECK( rec[1].towards == before, "routes fired after clearing all" );
+    CHECK( Route_trigger( 2, 0, 1.0, 0.1, 1, -1 ) == -1 && Route_cv( 0, CHANNELS, 0, 1.0, 0.0 ) == -1
+         , "out of range routes accepted" );
+}
+
+
+///////////////////////////////
+// a trigger while the program is being rewritten doesn't run it half compiled
+
+static void busy( void )
+{
+    int ch = 2;
+    describe( ch, to( 1, 1, "linear" ) );
+    level( 0, 0.0 );
+    Route_trigger( 0, ch, 1.0, 0.1, 1, -1 );
+    for( int i=0; i<BLOCK; i++ ){ block[i] = 3.0; }
+
+    // fires after the first of three stages has compiled
+    int before = rec[ch].towards;
+    isr_input     = 0;
+    isr_block     = block;
+    isr_countdown = 3 + 1; // the scan parses each shape first
+    describe( ch, fl_table( 3, to( 7, 1, "linear" ), to( 8, 1, "linear" ), to( 9, 1, "linear" ) ) );
+    CHECK( isr_input == -1, "the block didn't run during the describe" );
+    CHECK( rec[ch].towards == before, "trigger ran the program while it was compiling (dest %g)", rec[ch].dest );
+
+    // the edge was consumed. the next one runs the whole new program
+    level( 0, 0.0 );
+    level( 0, 3.0 );
+    CHECK( rec[ch].towards == before + 1 && rec[ch].dest == 7.0, "next trigger went to %g", rec[ch].dest );
+    int stages_run = 1;
+    while( rec[ch].cb && stages_run < 5 ){
+        Callback_t cb = rec[ch].cb;
+        rec[ch].cb = NULL;
+        cb( ch );
+        if( rec[ch].cb ){ stages_run++; }
+    }
+    CHECK( stages_run == 3 && rec[ch].dest == 9.0, "ran %d stages ending at %g", stages_run, rec[ch].dest );
+
+    Route_clear( -1 );
+}
+
+int main( void )
+{
+    casl_init( CHANNELS );
+    Route_init( INPUTS, CHANNELS );
+    triggers();
+    cv();
+    clearing();
+    busy();
+    return host_report("route");
+}
@@ -0,0 +1,203 @@
+// shape kernels: accuracy against the libm shapers they replaced, user curves, & throughput
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "shapes.h"
+
+#define BLOCK 32
+
+// the original per-sample libm shapers
+static float libm_sin( float in ){ return -0.5 * (cosf( 3.141592653589793 * in ) - 1.0); }
+static float libm_exp( float in ){ return powf(2.0, 10.0 * (in - 1.0)); }
+static float libm_log( float in ){ return 1.0 - powf(2.0, -10.0 * in); }
+
+typedef float* (*Kernel_t)( float* in, int size );
+
+// max error of a kernel over a dense sweep of (0,1)
+static float sweep_error( Kernel_t kernel, float (*ref)(float) )
+{
+    float err = 0.0;
+    float buf[BLOCK];
+    for( int b=0; b<(1<<16); b+=BLOCK ){
+        for( int i=0; i<BLOCK; i++ ){ buf[i] = (float)(b+i) / (float)(1<<16); }
+        kernel( buf, BLOCK );
+        for( int i=0; i<BLOCK; i++ ){
+            float e = fabsf( buf[i] - ref( (float)(b+i) / (float)(1<<16) ) );
+            if( e > err ){ err = e; }
+        }
+    }
+    return err;
+}
+
+static void accuracy( void )
+{
+    printf("max error vs libm\n");
+    struct{ const char* name; Kernel_t k; float (*ref)(float); float bound; } t[] =
+        { { "sine", shapes_v_sin, libm_sin, 1e-5 }
+        , { "expo", shapes_v_exp, libm_exp, 3e-5 }
+        , { "log",  shapes_v_log, libm_log, 3e-5 }
+        };
+    for( int i=0; i<3; i++ ){
+        float e = sweep_error( t[i].k, t[i].ref );
+        printf("  %-6s %.3g\n", t[i].name, e);
+        CHECK( e < t[i].bound, "%s error %g", t[i].name, e );
+    }
+
+    // the polynomial shapes aren't tabled, so must match their scalar versions
+    struct{ const char* name; Kernel_t k; float (*ref)(float); } p[] =
+        { { "now",     shapes_v_step_now,         shapes_step_now         }
+        , { "wait",    shapes_v_step_wait,        shapes_step_wait        }
+        , { "under",   shapes_v_ease_in_back,     shapes_ease_in_back     }
+        , { "over",    shapes_v_ease_out_back,    shapes_ease_out_back    }
+        , { "rebound", shapes_v_ease_out_rebound, shapes_ease_out_rebound }
+        };
+    for( int i=0; i<5; i++ ){
+        float e = sweep_error( p[i].k, p[i].ref );
+        CHECK( e == 0.0, "%s differs from its scalar shaper by %g", p[i].name, e );
+    }
+
+    // ends of the range are exact
+    float ends[2] = { 0.0, 1.0 };
+    shapes_v_sin( ends, 2 );
+    CHECK( ends[0] == 0.0 && ends[1] == 1.0, "sine ends %g %g", ends[0], ends[1] );
+}
+
+
+// a user curve, rendered at the given points
+static float curve_at( int curve, float in )
+{
+    shapes_v_curve( curve, &in, 1 );
+    return in;
+}
+
+static void curves( void )
+{
+    shapes_curve_clear();
+
+    // a short level list is used as-is: evenly spaced, linear between levels
+    float levels[4] = { 0.0, 1.0, 0.25, 0.5 };
+    int c = shapes_curve_define( NULL, levels, 4 );
+    CHECK( c == 0, "first curve got index %d", c );
+    for( int i=0; i<4; i++ ){
+        float v = curve_at( c, (float)i / 3.0 );
+        CHECK( fabsf( v - levels[i] ) < 1e-6, "level %d rendered %g", i, v );
+    }
+    CHECK( fabsf( curve_at( c, 1.0/6.0 ) - 0.5 ) < 1e-6, "between levels %g", curve_at( c, 1.0/6.0 ) );
+    CHECK( curve_at( c, -0.5 ) == 0.0 && curve_at( c, 1.5 ) == 0.5, "out of range input isn't clamped" );
+
+    // the same list again reuses the curve
+    CHECK( shapes_curve_define( NULL, levels, 4 ) == c, "identical curve took a new slot" );
+
+    // a long level list is resampled, & still spans the whole list
+    float ramp[1000];
+    for( int i=0; i<1000; i++ ){ ramp[i] = (float)i / 999.0; ramp[i] *= ramp[i]; }
+    int r = shapes_curve_define( NULL, ramp, 1000 );
+    float err = 0.0;
+    for( int i=0; i<=4096; i++ ){
+        float in = (float)i / 4096.0;
+        float e = fabsf( curve_at( r, in ) - in * in );
+        if( e > err ){ err = e; }
+    }
+    CHECK( err < 1e-5, "1000 level curve is %g from its levels", err );
+    CHECK( curve_at( r, 1.0 ) == 1.0, "1000 level curve ends at %g", curve_at( r, 1.0 ) );
+
+    // {x,y} breakpoints
+    float x[3] = { 0.0, 0.25, 1.0 };
+    float y[3] = { 0.0, 0.8, 1.0 };
+    int b = shapes_curve_define( x, y, 3 );
+    float ins[4]    = { 0.125, 0.25, 0.625, 1.0 };
+    float expect[4] = { 0.4, 0.8, 0.9, 1.0 };
+    for( int i=0; i<4; i++ ){
+        float v = curve_at( b, ins[i] );
+        CHECK( fabsf( v - expect[i] ) < 1e-6, "breakpoint curve at %g is %g, expected %g"
+             , ins[i], v, expect[i] );
+    }
+
+    CHECK( shapes_curve_define( NULL, levels, 1 ) == -1, "a single level was accepted" );
+
+    // unreferenced curves are recycled, least recently used first
+    shapes_curve_clear();
+    int slot[CURVE_COUNT];
+    for( int i=0; i<CURVE_COUNT; i++ ){
+        levels[0] = (float)i + 2.0; // distinct curves
+        slot[i] = shapes_curve_define( NULL, levels, 4 );
+    }
+    levels[0] = 2.0;
+    CHECK( shapes_curve_define( NULL, levels, 4 ) == slot[0], "redefining didn't find the curve" );
+    levels[0] = 100.0;
+    int n = shapes_curve_define( NULL, levels, 4 );
+    CHECK( n == slot[1], "recycled slot %d, expected the oldest unused %d", n, slot[1] );
+
+    // referenced curves are kept until released
+    for( int i=0; i<CURVE_COUNT; i++ ){ shapes_curve_retain( i ); }
+    shapes_curve_retain( n );
+    CHECK( shapes_curve_refs( n ) == 2, "%d refs after 2 retains", shapes_curve_refs( n ) );
+    printf("(no curve slots messages are expected)\n");
+    CHECK( shapes_curve_define( NULL, ramp, 2 ) == -1, "defined over %d referenced curves", CURVE_COUNT );
+    shapes_curve_release( n );
+    CHECK( shapes_curve_define( NULL, ramp, 2 ) == -1, "recycled a curve still referenced" );
+    shapes_curve_release( n );
+    shapes_curve_release( n ); // extra releases are ignored
+    CHECK( shapes_curve_refs( n ) == 0, "%d refs after releasing", shapes_curve_refs( n ) );
+    int m = shapes_curve_define( NULL, ramp, 2 );
+    CHECK( m == n, "released slot %d wasn't recycled (got %d)", n, m );
+    CHECK( fabsf( curve_at( m, 0.5 ) - ramp[1] * 0.5 ) < 1e-9, "recycled slot renders %g", curve_at( m, 0.5 ) );
+
+    // empty slots are ignored, so any shape offset can be passed
+    shapes_curve_retain( -1 );
+    shapes_curve_release( CURVE_COUNT );
+    shapes_curve_clear();
+    shapes_curve_retain( 3 );
+    CHECK( shapes_curve_refs( 3 ) == 0, "an empty slot took a reference" );
+    CHECK( shapes_curve_define( NULL, ramp, 2 ) == 0, "clear didn't free the slots" );
+}
+
+
+// throughput of the old b_map chains against the tables
+
+static float* libm_v_sin( float* in, int size )
+{
+    for( int i=0; i<size; i++ ){ in[i] = libm_sin( in[i] ); }
+    return in;
+}
+static float* libm_v_exp( float* in, int size )
+{
+    for( int i=0; i<size; i++ ){ in[i] = libm_exp( in[i] ); }
+    return in;
+}
+
+static double time_kernel( Kernel_t k, int blocks )
+{
+    static float buf[BLOCK];
+    volatile float sink = 0.0;
+    double t0 = host_seconds();
+    for( int b=0; b<blocks; b++ ){
+        for( int i=0; i<BLOCK; i++ ){ buf[i] = (float)((b+i) & 1023) / 1024.0; }
+        k( buf, BLOCK );
+        sink += buf[BLOCK-1];
+    }
+    return host_seconds() - t0;
+}
+
+static void throughput( void )
+{
+    int blocks = 200000;
+    double samples = (double)blocks * BLOCK;
+    printf("samples per second\n");
+    host_bench( "sine libm", samples, time_kernel( libm_v_sin, blocks ) );
+    host_bench( "sine table", samples, time_kernel( shapes_v_sin, blocks ) );
+    host_bench( "expo libm", samples, time_kernel( libm_v_exp, blocks ) );
+    host_bench( "expo table", samples, time_kernel( shapes_v_exp, blocks ) );
+    host_bench( "rebound", samples, time_kernel( shapes_v_ease_out_rebound, blocks ) );
+}
+
+int main( void )
+{
+    shapes_init();
+    accuracy();
+    curves();
+    throughput();
+    return host_report("shapes");
+}
@@ -0,0 +1,227 @@
+// slopes: breakpoint timing, idle channels, the 4-wide kernel, & channel count / rate
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "slopes.h"
+#include "ashapes.h"
+
+#define BLOCK 32
+
+static int   callbacks[64];
+static float seg_ms;
+
+// triangle between -1 & 1, one segment per callback
+static void bounce( int ch )
+{
+    callbacks[ch]++;
+    S_toward( ch, (callbacks[ch] & 1) ? -1.0 : 1.0, seg_ms, SHAPE_Linear, bounce );
+}
+
+static void start_bounce( int ch, float samples )
+{
+    seg_ms = samples / SAMPLES_PER_MS;
+    callbacks[ch] = 0;
+    S_toward( ch, -1.0, 0.0, SHAPE_Linear, NULL ); // start at the bottom
+    S_toward( ch, 1.0, seg_ms, SHAPE_Linear, bounce );
+}
+
+// period of a loop of short segments, from interpolated rising zero crossings
+// segment lengths aren't whole samples, so any phase lost at a breakpoint shows up here
+static void loop_period( float seg_samples )
+{
+    start_bounce( 0, seg_samples );
+    float out[BLOCK];
+    float last = -1.0;
+    double first = -1.0, prev = 0.0;
+    int crossings = 0;
+    long t = 0;
+    for( int b=0; b<4000; b++ ){
+        S_step_v( 0, out, BLOCK );
+        for( int i=0; i<BLOCK; i++, t++ ){
+            if( last < 0.0 && out[i] >= 0.0 ){
+                double c = (double)t - 1.0 + (double)(-last / (out[i] - last));
+                if( first < 0.0 ){ first = c; }
+                prev = c;
+                crossings++;
+            }
+            last = out[i];
+        }
+    }
+    double period = (prev - first) / (double)(crossings - 1);
+    double err = fabs( period - 2.0 * seg_samples ) / (2.0 * seg_samples);
+    printf("  %6.2f sample segments: period %.5f, error %.2e\n", seg_samples, period, err);
+    CHECK( err < 1e-6, "period error %g for %g sample segments", err, seg_samples );
+}
+
+static void breakpoints( void )
+{
+    printf("loop period\n");
+    loop_period( 7.3 );
+    loop_period( 20.55 );
+    loop_period( 100.5 );
+
+    // several breakpoints land in one sample, then one block
+    float out[BLOCK];
+    start_bounce( 0, 0.4 );
+    for( int b=0; b<100; b++ ){ S_step_v( 0, out, BLOCK ); }
+    int expect = (int)(100 * BLOCK / 0.4);
+    CHECK( abs( callbacks[0] - expect ) <= 1
+         , "%d callbacks for 0.4 sample segments, expected %d", callbacks[0], expect );
+
+    // the output still reaches each destination exactly
+    start_bounce( 0, 40.0 );
+    S_step_v( 0, out, BLOCK );
+    S_step_v( 0, out, 8 );
+    CHECK( out[7] == 1.0, "reached %g at the breakpoint", out[7] );
+}
+
+// a slope at its destination settles, & held lanes cost nothing to step
+static void idle( void )
+{
+    float out[BLOCK];
+    S_toward( 1, 3.0, 1.0, SHAPE_Linear, NULL );
+    int blocks = 0;
+    while( !S_is_settled(1) && blocks < 1000 ){
+        S_step_v( 1, out, BLOCK );
+        blocks++;
+    }
+    // 1ms of motion, then the 1024 sample phase-carry window
+    int limit = (SAMPLES_PER_MS + 1024) / BLOCK + 2;
+    CHECK( blocks <= limit, "settled after %d blocks, expected within %d", blocks, limit );
+    CHECK( S_get_state(1) == 3.0 && out[BLOCK-1] == 3.0, "settled at %g", S_get_state(1) );
+
+    S_toward( 1, 3.0, 1.0, SHAPE_Linear, NULL );
+    CHECK( !S_is_settled(1), "still settled after S_toward" );
+
+    // 4 channels at rest, refilled every block vs held
+    static float bufs[4][BLOCK];
+    float* outs[4] = { bufs[0], bufs[1], bufs[2], bufs[3] };
+    for( int c=0; c<4; c++ ){ S_toward( c, 1.0, 0.0, SHAPE_Linear, NULL ); }
+    for( int b=0; b<100; b++ ){ S_step4_v( 0, outs, 0, BLOCK ); }
+    for( int c=0; c<4; c++ ){ CHECK( S_is_settled(c), "channel %d not settled", c ); }
+
+    int n = 1000000;
+    printf("idle blocks of 4 channels per second\n");
+    double t0 = host_seconds();
+    for( int b=0; b<n; b++ ){ S_step4_v( 0, outs, 0, BLOCK ); }
+    host_bench( "refilled", n, host_seconds() - t0 );
+    t0 = host_seconds();
+    for( int b=0; b<n; b++ ){ S_step4_v( 0, outs, 0xF, BLOCK ); }
+    host_bench( "held", n, host_seconds() - t0 );
+}
+
+// channels 0-3 step through S_step4_v, & their twins 4-7 through S_step_v
+// the same segments must render identically, breakpoints, shapes & all
+static const float twin_segs[4] = { 7.3, 100.5, 3000.0, 1.2 };
+static unsigned    twin_count[8];
+
+static void twin( int ch )
+{
+    unsigned n = ++twin_count[ch];
+    S_toward( ch
+            , (n & 1) ? -3.0 : 4.0
+            , twin_segs[ch % 4] / SAMPLES_PER_MS * (float)(1 + n % 3)
+            , (Shape_t)(n % 9)
+            , (n % 50 == 0) ? NULL : twin // sometimes stop, so lanes go static
+            );
+}
+
+static void kernel( void )
+{
+    S_init( 8 );
+    for( int c=0; c<8; c++ ){
+        twin_count[c] = 0;
+        S_toward( c, 1.0, twin_segs[c % 4] / SAMPLES_PER_MS, SHAPE_Sine, twin );
+    }
+    static float a[4][BLOCK], b[4][BLOCK];
+    float* outs[4] = { a[0], a[1], a[2], a[3] };
+    long mismatched = 0;
+    for( long blk=0; blk<200000; blk++ ){
+        S_step4_v( 0, outs, 0, BLOCK );
+        for( int c=0; c<4; c++ ){ S_step_v( 4+c, b[c], BLOCK ); }
+        if( memcmp( a, b, sizeof(a) ) ){ mismatched++; }
+        if( blk % 5000 == 0 ){ // restart the stopped ones
+            for( int c=0; c<8; c++ ){
+                if( twin_count[c] % 50 == 0 ){ twin( c ); }
+            }
+        }
+    }
+    CHECK( mismatched == 0, "%ld blocks differ between S_step4_v & S_step_v", mismatched );
+    CHECK( twin_count[0] == twin_count[4], "%u vs %u breakpoints", twin_count[0], twin_count[4] );
+
+    // throughput with every lane mid-segment
+    for( int c=0; c<4; c++ ){ S_toward( c, 1.0, 1e9, SHAPE_Linear, NULL ); }
+    int n = 500000;
+    printf("channels x blocks per second\n");
+    double t0 = host_seconds();
+    for( int i=0; i<n; i++ ){
+        for( int c=0; c<4; c++ ){ S_step_v( c, a[c], BLOCK ); }
+    }
+    host_bench( "S_step_v per channel", 4.0 * n, host_seconds() - t0 );
+    t0 = host_seconds();
+    for( int i=0; i<n; i++ ){ S_step4_v( 0, outs, 0, BLOCK ); }
+    host_bench( "S_step4_v", 4.0 * n, host_seconds() - t0 );
+}
+
+// any number of channels, each at its own rate
+static void channel_counts( void )
+{
+    int counts[] = { 4, 8, 16, 32 };
+    for( int n=0; n<4; n++ ){
+        int chans = counts[n];
+        S_init( chans );
+        AShaper_init( chans );
+        for( int j=0; j<chans; j++ ){
+            S_set_sample_rate( j, 48000.0 / (float)(1 + j % 4) ); // 48k down to 12k
+            S_toward( j, (float)(j+1), 10.0, SHAPE_Linear, NULL );
+        }
+        // 10ms takes 480/(1 + j%4) samples
+        for( int j=0; j<chans; j++ ){
+            int expect = 480 / (1 + j % 4);
+            float out;
+            int samples = 0;
+            while( S_get_state(j) != (float)(j+1) && samples < 1000 ){
+                S_step_v( j, &out, 1 );
+                samples++;
+            }
+            CHECK( samples == expect, "%d channels: ch%d arrived after %d samples, expected %d"
+                 , chans, j, samples, expect );
+        }
+
+        // the last channel quantizes like any other
+        float chromatic[12] = { 0,1,2,3,4,5,6,7,8,9,10,11 };
+        float v = 0.49 / 12.0;
+        AShaper_set_scale( chans-1, chromatic, 12, 12.0, 1.0 );
+        AShaper_v( chans-1, &v, 1 );
+        CHECK( v == 0.0, "%d channels: last channel quantized to %g", chans, v );
+
+        // one past the end is ignored
+        S_toward( chans, 1.0, 0.0, SHAPE_Linear, NULL );
+        CHECK( S_get_state( chans ) == 0.0, "%d channels: stepped a missing channel", chans );
+        CHECK( AShaper_get_state( chans ) == 0.0, "%d channels: read a missing ashaper", chans );
+    }
+
+    // a bus rendering 1 sample per block, retargeted from lua long after arriving
+    // must start its new segment from scratch, not skip the time it spent at rest
+    S_init( 4 );
+    S_set_sample_rate( 3, 48000.0 / BLOCK );
+    S_toward( 3, 5.0, 100.0, SHAPE_Linear, NULL );
+    float v;
+    for( int i=0; i<150 + 750; i++ ){ S_step_v( 3, &v, 1 ); } // arrive, then rest 0.5s
+    S_toward( 3, 10.0, 1000.0, SHAPE_Linear, NULL );
+    for( int i=0; i<750; i++ ){ S_step_v( 3, &v, 1 ); } // half way
+    CHECK( fabsf( v - 7.5 ) < 0.01, "bus retarget at %g after 500ms, expected 7.5", v );
+}
+
+int main( void )
+{
+    S_init( 4 );
+    breakpoints();
+    idle();
+    kernel();
+    channel_counts();
+    return host_report("slopes");
+}
@@ -432,3 +432,22 @@ sd(); sd();
 eq(tostring(sd), 's[1]{1}:map(fn,s[2]{2,3})')
 sd:settable(s{1}+s{3,4})
 eq(tostring(sd), 's[1]{1}:map(fn,s[2]{3,4})')
+
+-- casl steps sequins in C (see tests/host/test_casl.c, which expects these same values)
+-- a slope can't skip a stage, so where lua returns 'skip' or 'dead' casl holds the last value
+local function held(seq, n)
+    local out, last = {}, seq.data[1]
+    for i=1,n do
+        local v = seq()
+        if type(v) == 'number' then last = v end
+        out[i] = last
+    end
+    return table.concat(out, ',')
+end
+
+eq(held(s{0,3,7}:step(2), 10), '0,7,3,0,7,3,0,7,3,0')
+eq(held(s{1,2,3,4}:step(-1), 10), '1,4,3,2,1,4,3,2,1,4')
+eq(held(s{1,2,3}:every(2), 10), '1,1,1,2,2,3,3,1,1,2')
+eq(held(s{1,2,3}:times(4), 10), '1,2,3,1,1,1,1,1,1,1')
+eq(held(s{1,2,3,4}:every(3):count(2), 10), '1,1,1,2,2,2,3,4,4,4')
+eq(held(s{5,6}:every(2):times(2), 10), '5,5,5,6,6,6,6,6,6,6')